@@ -21,6 +21,7 @@
 #include <QUrl>
 #include <QFile>
 #include <QFileInfo>
+#include <QDir>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkProxy>
@@ -72,6 +73,8 @@ struct CmdOptions
     bool nonShib;
     QString exclude;
     QString unsyncedfolders;
+    QStringList paths;
+    SyncMode syncMode;
     QString davPath;
     int restartTimes;
     int downlimit;
@@ -176,6 +179,9 @@ void help()
     std::cout << "  --trust                Trust the SSL certification." << std::endl;
     std::cout << "  --exclude [file]       Exclude list file" << std::endl;
     std::cout << "  --unsyncedfolders [file]    File containing the list of unsynced remote folders (selective sync)" << std::endl;
+    std::cout << "  --path [path]          Only sync [path], relative to <source_dir>. Can be repeated" << std::endl;
+    std::cout << "  --download-only        Mirror the server, local changes are undone" << std::endl;
+    std::cout << "  --upload-only          Upload local changes, ignore remote changes" << std::endl;
     std::cout << "  --user, -u [name]      Use [name] as the login name" << std::endl;
     std::cout << "  --password, -p [pass]  Use [pass] as password" << std::endl;
     std::cout << "  -n                     Use netrc (5) for login" << std::endl;
@@ -255,6 +261,21 @@ void parseOptions(const QStringList &app_args, CmdOptions *options)
             options->exclude = it.next();
         } else if (option == "--unsyncedfolders" && !it.peekNext().startsWith("-")) {
             options->unsyncedfolders = it.next();
+        } else if (option == "--path" && !it.peekNext().startsWith("-")) {
+            const QString path = QDir::cleanPath(it.next());
+            if (path == ".." || path.startsWith("../") || QDir::isAbsolutePath(path)) {
+                std::cerr << "Path '" << qPrintable(path) << "' must be relative to the source dir." << std::endl;
+                exit(1);
+            }
+            if (path != ".")
+                options->paths.append(path);
+        } else if (option == "--download-only" || option == "--upload-only") {
+            const auto mode = option == "--download-only" ? SyncMode::DownloadOnly : SyncMode::UploadOnly;
+            if (options->syncMode != SyncMode::Bidirectional && options->syncMode != mode) {
+                std::cerr << "--download-only and --upload-only can't be combined." << std::endl;
+                exit(1);
+            }
+            options->syncMode = mode;
         } else if (option == "--nonshib") {
             options->nonShib = true;
         } else if (option == "--davpath" && !it.peekNext().startsWith("-")) {
@@ -324,6 +345,7 @@ int main(int argc, char **argv)
     options.restartTimes = 3;
     options.uplimit = 0;
     options.downlimit = 0;
+    options.syncMode = SyncMode::Bidirectional;
 
     parseOptions(app.arguments(), &options);
 
@@ -509,6 +531,9 @@ restart_sync:
     SyncEngine engine(account, options.source_dir, folder, &db);
     engine.setIgnoreHiddenFiles(options.ignoreHiddenFiles);
     engine.setNetworkLimits(options.uplimit, options.downlimit);
+    SyncOptions syncOptions;
+    syncOptions._syncMode = options.syncMode;
+    engine.setSyncOptions(syncOptions);
     QObject::connect(&engine, &SyncEngine::finished,
         [&app](bool result) { app.exit(result ? EXIT_SUCCESS : EXIT_FAILURE); });
     QObject::connect(&engine, &SyncEngine::transmissionProgress, &cmd, &Cmd::transmissionProgressSlot);
@@ -534,6 +559,13 @@ restart_sync:
     }
 
 
+    if (!options.paths.isEmpty()) {
+        std::set<QByteArray> scope;
+        for (const auto &path : qAsConst(options.paths))
+            scope.insert(path.toUtf8());
+        engine.setSyncScope(std::move(scope));
+    }
+
     // Have to be done async, else, an error before exec() does not terminate the event loop.
     QMetaObject::invokeMethod(&engine, "startSync", Qt::QueuedConnection);
 
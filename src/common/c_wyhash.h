@@ -0,0 +1,145 @@
+/*
+ * c_wyhash.h wyhash
+ *
+ * wyhash by Wang Yi <godspeed_china@yeah.net>, released into the public
+ * domain (The Unlicense). This is a C port of the "final4" variant.
+ *
+ * See https://github.com/wangyi-fudan/wyhash
+ */
+
+/**
+ * @file common/c_wyhash.h
+ *
+ * @brief Fast 64-bit hash for paths
+ *
+ * The values end up in the sync journal (phash), so the output must not
+ * change between versions or platforms: the input is always read as
+ * little endian and the secret is fixed.
+ *
+ * @defgroup cynWyHashInternals wyhash function
+ * @ingroup cynLibraryAPI
+ *
+ * @{
+ */
+#ifndef _C_WYHASH_H
+#define _C_WYHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+/* 64x64 -> 128 bit multiplication, low half in *A and high half in *B */
+static inline void _c_wymum(uint64_t *A, uint64_t *B) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = *A;
+  r *= *B;
+  *A = (uint64_t)r;
+  *B = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  *A = _umul128(*A, *B, B);
+#else
+  uint64_t ha = *A >> 32, hb = *B >> 32, la = (uint32_t)*A, lb = (uint32_t)*B;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *A = lo;
+  *B = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t _c_wymix(uint64_t A, uint64_t B) {
+  _c_wymum(&A, &B);
+  return A ^ B;
+}
+
+static inline uint64_t _c_wyr8(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline uint64_t _c_wyr4(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+static inline uint64_t _c_wyr3(const uint8_t *p, size_t k) {
+  return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+/**
+ * c_wyhash64 -- hash a variable-length key into a 64-bit value
+ *
+ * @param key    the key (the unaligned variable-length array of bytes)
+ * @param len    the length of the key, counting by bytes
+ * @param seed   can be any 8-byte value
+ *
+ * Paths are mostly between 16 and 100 bytes; those are hashed with one
+ * multiplication per 16 bytes, which makes this several times faster than
+ * c_jhash64() while having better distribution.
+ *
+ * @return a 64-bit value.
+ */
+static inline uint64_t c_wyhash64(const void *key, size_t len, uint64_t seed) {
+  static const uint64_t secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+    0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+  };
+  const uint8_t *p = (const uint8_t *)key;
+  uint64_t a, b;
+
+  seed ^= _c_wymix(seed ^ secret[0], secret[1]);
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (_c_wyr4(p) << 32) | _c_wyr4(p + ((len >> 3) << 2));
+      b = (_c_wyr4(p + len - 4) << 32) | _c_wyr4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = _c_wyr3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = _c_wymix(_c_wyr8(p) ^ secret[1], _c_wyr8(p + 8) ^ seed);
+        see1 = _c_wymix(_c_wyr8(p + 16) ^ secret[2], _c_wyr8(p + 24) ^ see1);
+        see2 = _c_wymix(_c_wyr8(p + 32) ^ secret[3], _c_wyr8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = _c_wymix(_c_wyr8(p) ^ secret[1], _c_wyr8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = _c_wyr8(p + i - 16);
+    b = _c_wyr8(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  _c_wymum(&a, &b);
+  return _c_wymix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+/**
+ * }@
+ */
+#endif /* _C_WYHASH_H */
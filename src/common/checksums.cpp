@@ -18,6 +18,8 @@
 #include "config.h"
 #include "filesystembase.h"
 #include "common/checksums.h"
+#include "common/iogovernor.h"
+#include "common/tracing.h"
 
 #include <QLoggingCategory>
 #include <qtconcurrentrun.h>
@@ -76,6 +78,9 @@
  *
  */
 
+OC_TRACE_SEMAPHORE(checksum_start);
+OC_TRACE_SEMAPHORE(checksum_end);
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcChecksums, "nextcloud.sync.checksums", QtInfoMsg)
@@ -187,21 +192,28 @@ QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray
         return QByteArray();
     }
 
+    // Runs in a thread of the global pool, or in the discovery thread
+    IoGovernor::ScopedBackgroundIo backgroundIo;
+    if (OC_TRACE_ENABLED(checksum_start))
+        OC_TRACE(checksum_start, filePath.toUtf8().constData(), checksumType.constData());
+
+    QByteArray checksum;
     if (checksumType == checkSumMD5C) {
-        return FileSystem::calcMd5(filePath);
+        checksum = FileSystem::calcMd5(filePath);
     } else if (checksumType == checkSumSHA1C) {
-        return FileSystem::calcSha1(filePath);
+        checksum = FileSystem::calcSha1(filePath);
     }
 #ifdef ZLIB_FOUND
     else if (checksumType == checkSumAdlerC) {
-        return FileSystem::calcAdler32(filePath);
+        checksum = FileSystem::calcAdler32(filePath);
     }
 #endif
     // for an unknown checksum or no checksum, we're done right now
-    if (!checksumType.isEmpty()) {
+    else if (!checksumType.isEmpty()) {
         qCWarning(lcChecksums) << "Unknown checksum type:" << checksumType;
     }
-    return QByteArray();
+    OC_TRACE(checksum_end, checksumType.constData(), checksum.size());
+    return checksum;
 }
 
 void ComputeChecksum::slotCalculationDone()
@@ -17,6 +17,7 @@
  */
 
 #include "filesystembase.h"
+#include "iogovernor.h"
 
 #include <QDateTime>
 #include <QDir>
@@ -28,6 +29,12 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#if defined Q_OS_UNIX && !defined Q_OS_MAC
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifdef ZLIB_FOUND
 #include <zlib.h>
 #endif
@@ -366,15 +373,22 @@ QString FileSystem::fileSystemForPath(const QString &path)
 static QByteArray readToCrypto( const QString& filename, QCryptographicHash::Algorithm algo )
  {
      QFile file(filename);
-     QByteArray arr;
      QCryptographicHash crypto( algo );
 
-     if (file.open(QIODevice::ReadOnly)) {
-         if (crypto.addData(&file)) {
-             arr = crypto.result().toHex();
-         }
+     if (!file.open(QIODevice::ReadOnly))
+         return QByteArray();
+
+     // Read in chunks so the reads can be accounted for by the governor
+     const qint64 bufSize = qMin(BUFSIZE, file.size() + 1);
+     QByteArray buf(bufSize, Qt::Uninitialized);
+     qint64 size = 0;
+     while ((size = file.read(buf.data(), bufSize)) > 0) {
+         IoGovernor::instance()->acquire(size);
+         crypto.addData(buf.constData(), size);
      }
-     return arr;
+     if (size < 0)
+         return QByteArray();
+     return crypto.result().toHex();
  }
 
 QByteArray FileSystem::calcMd5(const QString &filename)
@@ -399,8 +413,10 @@ QByteArray FileSystem::calcAdler32(const QString &filename)
         qint64 size = 0;
         while (!file.atEnd()) {
             size = file.read(buf.data(), bufSize);
-            if (size > 0)
+            if (size > 0) {
+                IoGovernor::instance()->acquire(size);
                 adler = adler32(adler, (const Bytef *)buf.data(), size);
+            }
         }
     }
 
@@ -427,79 +443,134 @@ bool FileSystem::remove(const QString &fileName, QString *errorString)
     return true;
 }
 
-bool FileSystem::moveToTrash(const QString &fileName, QString *errorString)
-{
 #if defined Q_OS_UNIX && !defined Q_OS_MAC
-    QString trashPath, trashFilePath, trashInfoPath;
+static QString trashPath()
+{
     QString xdgDataHome = QFile::decodeName(qgetenv("XDG_DATA_HOME"));
     if (xdgDataHome.isEmpty()) {
-        trashPath = QDir::homePath() + "/.local/share/Trash/"; // trash path that should exist
-    } else {
-        trashPath = xdgDataHome + "/Trash/";
+        return QDir::homePath() + "/.local/share/Trash/"; // trash path that should exist
     }
+    return xdgDataHome + "/Trash/";
+}
 
-    trashFilePath = trashPath + "files/"; // trash file path contain delete files
-    trashInfoPath = trashPath + "info/"; // trash info path contain delete files information
-
-    if (!(QDir().mkpath(trashFilePath) && QDir().mkpath(trashInfoPath))) {
-        *errorString = QCoreApplication::translate("FileSystem", "Could not make directories in trash");
-        return false; //mkpath will return true if path exists
-    }
+// Content of the .trashinfo file of a file that was at absoluteFilePath
+static QByteArray trashInfo(const QString &absoluteFilePath)
+{
+    QByteArray info = "[Trash Info]\n";
+    info += "Path=";
+    info += QUrl::toPercentEncoding(absoluteFilePath, "~_-./");
+    info += '\n';
+    info += "DeletionDate=";
+    info += QDateTime::currentDateTime().toString(Qt::ISODate).toLatin1();
+    info += '\n';
+    return info;
+}
 
-    QFileInfo f(fileName);
+namespace {
+    enum class TrashInfoResult {
+        Created,
+        NameTaken,
+        Failed
+    };
 
-    QDir file;
-    int suffix_number = 1;
-    if (file.exists(trashFilePath + f.fileName())) { //file in trash already exists, move to "filename.1"
-        QString path = trashFilePath + f.fileName() + ".";
-        while (file.exists(path + QString::number(suffix_number))) { //or to "filename.2" if "filename.1" exists, etc
-            suffix_number++;
-        }
-        if (!file.rename(f.absoluteFilePath(), path + QString::number(suffix_number))) { // rename(file old path, file trash path)
-            *errorString = QCoreApplication::translate("FileSystem", "Could not move '%1' to '%2'")
-                               .arg(f.absoluteFilePath(), path + QString::number(suffix_number));
-            return false;
-        }
-    } else {
-        if (!file.rename(f.absoluteFilePath(), trashFilePath + f.fileName())) { // rename(file old path, file trash path)
-            *errorString = QCoreApplication::translate("FileSystem", "Could not move '%1' to '%2'")
-                               .arg(f.absoluteFilePath(), trashFilePath + f.fileName());
-            return false;
+    // Creating the .trashinfo exclusively reserves the name in the trash,
+    // also against other processes, see the freedesktop.org trash spec
+    TrashInfoResult createTrashInfo(const QString &infoFilePath, const QByteArray &info)
+    {
+        const int fd = ::open(QFile::encodeName(infoFilePath).constData(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+            return errno == EEXIST ? TrashInfoResult::NameTaken : TrashInfoResult::Failed;
+        const bool written = ::write(fd, info.constData(), info.size()) == info.size();
+        if (::close(fd) != 0 || !written) {
+            QFile::remove(infoFilePath);
+            return TrashInfoResult::Failed;
         }
+        return TrashInfoResult::Created;
     }
+}
+#endif
 
-    // create file format for trash info file----- START
-    QFile infoFile;
-    if (file.exists(trashInfoPath + f.fileName() + ".trashinfo")) { //TrashInfo file already exists, create "filename.1.trashinfo"
-        QString filename = trashInfoPath + f.fileName() + "." + QString::number(suffix_number) + ".trashinfo";
-        infoFile.setFileName(filename); //filename+.trashinfo //  create file information file in /.local/share/Trash/info/ folder
-    } else {
-        QString filename = trashInfoPath + f.fileName() + ".trashinfo";
-        infoFile.setFileName(filename); //filename+.trashinfo //  create file information file in /.local/share/Trash/info/ folder
-    }
+bool FileSystem::moveToTrash(const QString &fileName, QString *errorString)
+{
+    Trash trash;
+    return trash.move(fileName, errorString);
+}
 
-    infoFile.open(QIODevice::ReadWrite);
+FileSystem::Trash::Trash() = default;
 
-    QTextStream stream(&infoFile); // for write data on open file
+FileSystem::Trash::~Trash() = default;
 
-    QByteArray info = "[Trash Info]\n";
-    info += "Path=";
-    info += QUrl::toPercentEncoding(f.absoluteFilePath(), "~_-./");
-    info += '\n';
-    info += "DeletionDate=";
-    info += QDateTime::currentDateTime().toString(Qt::ISODate).toLatin1();
-    info += '\n';
+bool FileSystem::Trash::init(QString *errorString)
+{
+#if defined Q_OS_UNIX && !defined Q_OS_MAC
+    const QString trashPath = OCC::trashPath();
+    _filesPath = trashPath + "files/";
+    _infoPath = trashPath + "info/";
+    if (!(QDir().mkpath(_filesPath) && QDir().mkpath(_infoPath))) {
+        *errorString = QCoreApplication::translate("FileSystem", "Could not make directories in trash");
+        return false;
+    }
 
-    stream << info;
+    // One listing of each directory instead of probing every candidate name
+    const auto filter = QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot;
+    for (const auto &name : QDir(_filesPath).entryList(filter, QDir::Unsorted))
+        _usedNames.insert(name);
+    for (auto name : QDir(_infoPath).entryList(filter, QDir::Unsorted)) {
+        if (name.endsWith(QLatin1String(".trashinfo")))
+            name.chop(10);
+        _usedNames.insert(name);
+    }
+    _initialized = true;
+    return true;
+#else
+    *errorString = QCoreApplication::translate("FileSystem", "Moving to the trash is not implemented on this platform");
+    return false;
+#endif
+}
 
-    infoFile.close();
+bool FileSystem::Trash::move(const QString &fileName, QString *errorString)
+{
+    if (!_initialized && !init(errorString))
+        return false;
 
-    // create info file format of trash file----- END
+#if defined Q_OS_UNIX && !defined Q_OS_MAC
+    const QFileInfo f(fileName);
+    const QString absoluteFilePath = f.absoluteFilePath();
+    const QByteArray info = trashInfo(absoluteFilePath);
+
+    // "filename", then "filename.1", "filename.2"... The listing from init()
+    // skips the known names, the exclusive .trashinfo creation decides.
+    QString trashName = f.fileName();
+    for (int suffixNumber = 1;; ++suffixNumber) {
+        if (!_usedNames.contains(trashName)) {
+            const QString infoFilePath = _infoPath + trashName + ".trashinfo";
+            const auto result = createTrashInfo(infoFilePath, info);
+            if (result == TrashInfoResult::Failed) {
+                *errorString = QCoreApplication::translate("FileSystem", "Could not write '%1'").arg(infoFilePath);
+                return false;
+            }
+            if (result == TrashInfoResult::Created) {
+                // An entry without .trashinfo would be overwritten by the rename
+                const QFileInfo existing(_filesPath + trashName);
+                if (!existing.exists() && !existing.isSymLink())
+                    break;
+                QFile::remove(infoFilePath);
+            }
+            _usedNames.insert(trashName);
+        }
+        trashName = f.fileName() + QLatin1Char('.') + QString::number(suffixNumber);
+    }
+    _usedNames.insert(trashName);
 
+    if (!QDir().rename(absoluteFilePath, _filesPath + trashName)) {
+        QFile::remove(_infoPath + trashName + ".trashinfo");
+        *errorString = QCoreApplication::translate("FileSystem", "Could not move '%1' to '%2'")
+                           .arg(absoluteFilePath, _filesPath + trashName);
+        return false;
+    }
     return true;
 #else
     Q_UNUSED(fileName)
-    *errorString = QCoreApplication::translate("FileSystem", "Moving to the trash is not implemented on this platform");
     return false;
 #endif
 }
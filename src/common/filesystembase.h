@@ -24,6 +24,7 @@
 #include <ctime>
 #include <QFileInfo>
 #include <QLoggingCategory>
+#include <QSet>
 
 #include <ocsynclib.h>
 
@@ -114,6 +115,32 @@ namespace FileSystem {
      */
     bool OCSYNC_EXPORT moveToTrash(const QString &filename, QString *errorString);
 
+    /**
+     * @brief Moves many files or folders to the trash (Only implemented on linux)
+     *
+     * Equivalent to calling moveToTrash() for each of them, but the trash
+     * directories are created and listed only once. Each name is reserved
+     * by creating its .trashinfo exclusively before the file is moved, as
+     * the freedesktop.org trash spec asks for.
+     */
+    class OCSYNC_EXPORT Trash
+    {
+    public:
+        Trash();
+        ~Trash();
+
+        bool move(const QString &fileName, QString *errorString);
+
+    private:
+        Q_DISABLE_COPY(Trash)
+        bool init(QString *errorString);
+
+        bool _initialized = false;
+        QString _filesPath;
+        QString _infoPath;
+        QSet<QString> _usedNames; // entries of files/ and info/ without .trashinfo
+    };
+
     /**
      * Replacement for QFile::open(ReadOnly) followed by a seek().
      * This version sets a more permissive sharing mode on Windows.
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "iogovernor.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QThread>
+
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <sys/resource.h>
+#endif
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcIoGovernor, "nextcloud.sync.iogovernor", QtInfoMsg)
+
+// Budgets used under I/O pressure when none is configured
+static const qint64 pressureBytesPerSecond = 10 * 1024 * 1024;
+static const qint64 pressureOperationsPerSecond = 250;
+
+// How much the budget may be overdrawn before the caller has to wait
+static const qint64 burstNsecs = 100 * 1000 * 1000;
+
+enum class IoPriority {
+    Normal,
+    Background,
+    Idle
+};
+
+static IoPriority configuredIoPriority()
+{
+    static const IoPriority priority = [] {
+        const QByteArray env = qgetenv("OWNCLOUD_IO_PRIORITY").toLower();
+        if (env == "normal")
+            return IoPriority::Normal;
+        if (env == "idle")
+            return IoPriority::Idle;
+        return IoPriority::Background;
+    }();
+    return priority;
+}
+
+#if defined(Q_OS_LINUX)
+// From linux/ioprio.h, which is not shipped everywhere
+enum {
+    IOPRIO_CLASS_NONE,
+    IOPRIO_CLASS_RT,
+    IOPRIO_CLASS_BE,
+    IOPRIO_CLASS_IDLE,
+};
+static const int IOPRIO_CLASS_SHIFT = 13;
+static const int IOPRIO_WHO_PROCESS = 1;
+
+// With IOPRIO_WHO_PROCESS and 0 the priority of the calling thread is used
+static int ioprioGet()
+{
+    return static_cast<int>(syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0));
+}
+
+static bool ioprioSet(int ioprio)
+{
+    return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio) == 0;
+}
+#endif
+
+IoGovernor::ScopedBackgroundIo::ScopedBackgroundIo()
+    : _previous(0)
+{
+    const auto priority = configuredIoPriority();
+    if (priority == IoPriority::Normal)
+        return;
+
+#if defined(Q_OS_LINUX)
+    _previous = ioprioGet();
+    if (_previous < 0)
+        return;
+    const int ioprio = priority == IoPriority::Idle
+        ? IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT
+        : (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 7;
+    _changed = ioprioSet(ioprio);
+#elif defined(Q_OS_WIN)
+    // Lowers the I/O and memory priority, there is no separate idle mode
+    _changed = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(Q_OS_MAC)
+    _previous = getiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD);
+    if (_previous < 0)
+        return;
+#ifdef IOPOL_UTILITY
+    const int policy = priority == IoPriority::Idle ? IOPOL_THROTTLE : IOPOL_UTILITY;
+#else
+    const int policy = IOPOL_THROTTLE;
+#endif
+    _changed = setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, policy) == 0;
+#endif
+    if (!_changed)
+        qCDebug(lcIoGovernor) << "Could not lower the I/O priority of the thread";
+}
+
+IoGovernor::ScopedBackgroundIo::~ScopedBackgroundIo()
+{
+    if (!_changed)
+        return;
+#if defined(Q_OS_LINUX)
+    ioprioSet(_previous);
+#elif defined(Q_OS_WIN)
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#elif defined(Q_OS_MAC)
+    setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, _previous);
+#endif
+}
+
+IoGovernor *IoGovernor::instance()
+{
+    static IoGovernor governor;
+    return &governor;
+}
+
+static IoGovernor::Clock monotonicClock()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return [timer] { return timer.nsecsElapsed(); };
+}
+
+static void threadSleep(qint64 nsecs)
+{
+    QThread::usleep(static_cast<unsigned long>(nsecs / 1000));
+}
+
+IoGovernor::IoGovernor(qint64 maxBytesPerSecond, qint64 maxOperationsPerSecond, const Clock &clock, const Sleep &sleep)
+    : _clock(clock)
+    , _sleep(sleep)
+    , _maxBytesPerSecond(qMax(0LL, maxBytesPerSecond))
+    , _maxOperationsPerSecond(qMax(0LL, maxOperationsPerSecond))
+{
+}
+
+IoGovernor::IoGovernor()
+    : IoGovernor(qEnvironmentVariableIntValue("OWNCLOUD_IO_READ_BANDWIDTH") * 1024LL,
+          qEnvironmentVariableIntValue("OWNCLOUD_IO_IOPS"),
+          monotonicClock(), &threadSleep)
+{
+    // Share of time in which some task waited for I/O, in percent, over the last 10s
+    bool ok = false;
+    _pressureThreshold = qEnvironmentVariableIntValue("OWNCLOUD_IO_PRESSURE_THRESHOLD", &ok);
+    if (!ok)
+        _pressureThreshold = 20;
+
+    if (_maxBytesPerSecond || _maxOperationsPerSecond) {
+        qCInfo(lcIoGovernor) << "Limiting discovery and checksum I/O to"
+                             << _maxBytesPerSecond / 1024 << "KiB/s and"
+                             << _maxOperationsPerSecond << "operations/s (0 is unlimited)";
+    }
+}
+
+void IoGovernor::updatePressure(qint64 now)
+{
+    if (_pressureThreshold <= 0)
+        return;
+    if (_lastPressureCheck >= 0 && now - _lastPressureCheck < 1000LL * 1000 * 1000)
+        return;
+    _lastPressureCheck = now;
+
+#if defined(Q_OS_LINUX)
+    // "some avg10=1.23 avg60=0.50 avg300=0.10 total=123456"
+    QFile file(QStringLiteral("/proc/pressure/io"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        // No PSI support in this kernel, don't try again
+        _pressureThreshold = 0;
+        return;
+    }
+    const QByteArray line = file.readLine();
+    const int start = line.indexOf("avg10=");
+    if (!line.startsWith("some") || start < 0)
+        return;
+    const int end = line.indexOf(' ', start);
+    const double avg10 = line.mid(start + 6, end - start - 6).toDouble();
+
+    const bool underPressure = avg10 >= _pressureThreshold;
+    if (underPressure != _underPressure) {
+        _underPressure = underPressure;
+        if (underPressure) {
+            ++_stats.pressureEpisodes;
+            qCInfo(lcIoGovernor) << "System is under I/O pressure:" << avg10 << "% avg10, backing off";
+        } else {
+            qCInfo(lcIoGovernor) << "I/O pressure is gone:" << avg10 << "% avg10";
+        }
+    }
+#endif
+}
+
+void IoGovernor::acquire(qint64 bytes, int operations)
+{
+    qint64 waitNsecs = 0;
+    {
+        QMutexLocker locker(&_mutex);
+        _stats.bytes += bytes;
+        _stats.operations += operations;
+
+        const qint64 now = _clock();
+        updatePressure(now);
+
+        qint64 bytesPerSecond = _maxBytesPerSecond;
+        qint64 operationsPerSecond = _maxOperationsPerSecond;
+        if (_underPressure) {
+            bytesPerSecond = bytesPerSecond ? qMax(1LL, bytesPerSecond / 4) : pressureBytesPerSecond;
+            operationsPerSecond = operationsPerSecond ? qMax(1LL, operationsPerSecond / 4) : pressureOperationsPerSecond;
+        }
+        if (!bytesPerSecond && !operationsPerSecond)
+            return;
+
+        // Each request pays for the time it would take at the budgeted rate,
+        // the caller waits once the paid time runs ahead of the clock by more
+        // than the allowed burst.
+        qint64 cost = 0;
+        if (bytesPerSecond)
+            cost = qMax(cost, bytes * 1000 * 1000 * 1000 / bytesPerSecond);
+        if (operationsPerSecond)
+            cost = qMax(cost, operations * 1000LL * 1000 * 1000 / operationsPerSecond);
+        _budgetTime = qMax(_budgetTime, now) + cost;
+        waitNsecs = _budgetTime - now - burstNsecs;
+        if (waitNsecs <= 0)
+            return;
+        _stats.throttledMsecs += waitNsecs / (1000 * 1000);
+    }
+    _sleep(waitNsecs);
+}
+
+IoGovernor::Stats IoGovernor::takeStats()
+{
+    QMutexLocker locker(&_mutex);
+    Stats stats = _stats;
+    _stats = Stats();
+    return stats;
+}
+
+QDebug operator<<(QDebug debug, const IoGovernor::Stats &stats)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "read " << stats.bytes / 1024 << " KiB in " << stats.operations
+                    << " operations, throttled for " << stats.throttledMsecs << " ms, "
+                    << stats.pressureEpisodes << " I/O pressure episodes";
+    return debug;
+}
+
+}
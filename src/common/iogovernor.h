@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QDebug>
+#include <QMutex>
+
+#include <functional>
+
+namespace OCC {
+
+/**
+ * @brief Limits the local disk I/O of the local discovery and of checksum computations
+ *
+ * Both run in the background and can read the whole sync folder. The governor
+ *  - lowers the I/O priority of the threads doing it, see ScopedBackgroundIo,
+ *  - enforces a read bandwidth and operations per second budget, see acquire(),
+ *  - backs off when the system reports I/O pressure (Linux PSI).
+ *
+ * Configured with the environment variables OWNCLOUD_IO_PRIORITY,
+ * OWNCLOUD_IO_READ_BANDWIDTH, OWNCLOUD_IO_IOPS and OWNCLOUD_IO_PRESSURE_THRESHOLD.
+ *
+ * @ingroup libsync
+ */
+class OCSYNC_EXPORT IoGovernor
+{
+public:
+    struct Stats
+    {
+        qint64 bytes = 0;
+        qint64 operations = 0;
+        qint64 throttledMsecs = 0;
+        int pressureEpisodes = 0;
+    };
+
+    /// Monotonic time in nanoseconds
+    using Clock = std::function<qint64()>;
+    /// Blocks the calling thread for the given nanoseconds
+    using Sleep = std::function<void(qint64)>;
+
+    static IoGovernor *instance();
+
+    /**
+     * A governor with the given budgets (0 is unlimited) and without the
+     * I/O pressure checks, mainly for tests. instance() is configured
+     * from the environment.
+     */
+    IoGovernor(qint64 maxBytesPerSecond, qint64 maxOperationsPerSecond, const Clock &clock, const Sleep &sleep);
+
+    /**
+     * Called before reading bytes or doing operations (opendir, stat...)
+     *
+     * Blocks the calling thread while the budget is exhausted, must not be
+     * called from the main thread.
+     */
+    void acquire(qint64 bytes, int operations = 1);
+
+    /// Returns the counters accumulated since the last call and resets them.
+    Stats takeStats();
+
+    /**
+     * Lowers the I/O priority of the current thread for its lifetime
+     * and restores the previous one afterwards.
+     */
+    class OCSYNC_EXPORT ScopedBackgroundIo
+    {
+    public:
+        ScopedBackgroundIo();
+        ~ScopedBackgroundIo();
+
+    private:
+        Q_DISABLE_COPY(ScopedBackgroundIo)
+        int _previous;
+        bool _changed = false;
+    };
+
+private:
+    IoGovernor();
+    void updatePressure(qint64 now);
+
+    QMutex _mutex;
+    Clock _clock;
+    Sleep _sleep;
+
+    // Configured budgets, 0 means unlimited
+    qint64 _maxBytesPerSecond = 0;
+    qint64 _maxOperationsPerSecond = 0;
+    double _pressureThreshold = 0;
+
+    // Virtual time at which the budget spent so far is paid off, in ns of _clock
+    qint64 _budgetTime = 0;
+
+    qint64 _lastPressureCheck = -1;
+    bool _underPressure = false;
+    Stats _stats;
+};
+
+OCSYNC_EXPORT QDebug operator<<(QDebug debug, const IoGovernor::Stats &stats);
+
+}
@@ -26,6 +26,7 @@
 #include "ownsql.h"
 #include "common/utility.h"
 #include "common/asserts.h"
+#include "common/tracing.h"
 #include <sqlite3.h>
 
 #define SQLITE_SLEEP_TIME_USEC 100000
@@ -39,6 +40,9 @@
         }                                                    \
     }
 
+OC_TRACE_SEMAPHORE(sql_exec_start);
+OC_TRACE_SEMAPHORE(sql_exec_end);
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcSql, "nextcloud.sync.database.sql", QtInfoMsg)
@@ -301,9 +305,9 @@ bool SqlQuery::exec()
         qCWarning(lcSql) << "Can't exec query, statement unprepared.";
         return false;
     }
-
     // Don't do anything for selects, that is how we use the lib :-|
     if (!isSelect() && !isPragma()) {
+        OC_TRACE(sql_exec_start, _sql.constData());
         int rc = 0, n = 0;
         do {
             rc = sqlite3_step(_stmt);
@@ -330,6 +334,7 @@ bool SqlQuery::exec()
         } else {
             qCDebug(lcSql) << "Last exec affected" << numRowsAffected() << "rows.";
         }
+        OC_TRACE(sql_exec_end, _sql.constData(), _errId);
         return (_errId == SQLITE_DONE); // either SQLITE_ROW or SQLITE_DONE
     }
 
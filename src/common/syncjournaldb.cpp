@@ -18,6 +18,7 @@
 
 #include <QCryptographicHash>
 #include <QFile>
+#include <QFileInfo>
 #include <QLoggingCategory>
 #include <QStringList>
 #include <QElapsedTimer>
@@ -33,6 +34,7 @@
 #include "common/checksums.h"
 
 #include "common/c_jhash.h"
+#include "common/c_wyhash.h"
 
 // SQL expression to check whether path.startswith(prefix + '/')
 // Note: '/' + 1 == '0'
@@ -45,6 +47,26 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcDb, "nextcloud.sync.database", QtInfoMsg)
 
+// WITHOUT ROWID tables need sqlite >= 3.8.2
+static bool sqliteSupportsWithoutRowid()
+{
+    return sqlite3_libversion_number() >= 3008002;
+}
+
+// The statement creating a metadata table with the given columns, keyed by phash
+static QByteArray createMetadataTableQuery(const QByteArray &table, const QByteArray &columns)
+{
+    return "CREATE TABLE IF NOT EXISTS " + table + "(" + columns + ", PRIMARY KEY(phash))"
+        + (sqliteSupportsWithoutRowid() ? " WITHOUT ROWID;" : ";");
+}
+
+// The indexes of the metadata table. Their columns exist after updateMetadataTableStructure()
+static const char *const metadataIndexes[] = {
+    "CREATE INDEX IF NOT EXISTS metadata_file_id ON metadata(fileid);",
+    "CREATE INDEX IF NOT EXISTS metadata_inode ON metadata(inode);",
+    "CREATE INDEX IF NOT EXISTS metadata_path ON metadata(path);",
+};
+
 #define GET_FILE_RECORD_QUERY \
         "SELECT path, inode, modtime, type, md5, fileid, remotePerm, filesize," \
         "  ignoredChildrenRemote, contentchecksumtype.name || ':' || contentChecksum, e2eMangledName " \
@@ -275,6 +297,10 @@ bool SyncJournalDb::sqlFail(const QString &log, const SqlQuery &query)
     commitTransaction();
     qCWarning(lcDb) << "SQL Error" << log << query.error();
     _db.close();
+    if (_discoverySpillMatchedCount > 0)
+        _discoverySpillLost = true;
+    _discoverySpillCount = 0;
+    _discoverySpillMatchedCount = 0;
     ASSERT(false);
     return false;
 }
@@ -318,6 +344,17 @@ bool SyncJournalDb::checkConnect()
         qCInfo(lcDb) << "sqlite3 version" << pragma1.stringValue(0);
     }
 
+    // These only take effect when the journal is created: larger pages fit
+    // more of the clustered metadata rows, and incremental auto-vacuum lets
+    // postSyncCleanup() give space back after large deletes.
+    // Note that pragmas are only stepped by next().
+    pragma1.prepare("PRAGMA page_size = 8192;");
+    pragma1.exec();
+    pragma1.next();
+    pragma1.prepare("PRAGMA auto_vacuum = INCREMENTAL;");
+    pragma1.exec();
+    pragma1.next();
+
     pragma1.prepare("PRAGMA journal_mode=" + _journalMode + ";");
     if (!pragma1.exec()) {
         return sqlFail("Set PRAGMA journal_mode", pragma1);
@@ -326,6 +363,25 @@ bool SyncJournalDb::checkConnect()
         qCInfo(lcDb) << "sqlite3 journal_mode=" << pragma1.stringValue(0);
     }
 
+    pragma1.prepare("PRAGMA cache_size = -16384;"); // in KiB
+    pragma1.exec();
+    pragma1.next();
+
+    // Memory map the journal, sized to the file with room to grow, so reads
+    // don't need a read() syscall per page.
+    static QByteArray env_mmap_size = qgetenv("OWNCLOUD_SQLITE_MMAP_SIZE");
+    qint64 mmapSize = 0;
+    if (!env_mmap_size.isEmpty()) {
+        mmapSize = env_mmap_size.toLongLong();
+    } else {
+        const qint64 maxMmapSize = sizeof(void *) >= 8 ? (1LL << 30) : (256LL << 20);
+        mmapSize = qBound<qint64>(64LL << 20, QFileInfo(_dbFile).size() * 2, maxMmapSize);
+    }
+    pragma1.prepare("PRAGMA mmap_size = " + QByteArray::number(mmapSize) + ";");
+    if (pragma1.exec() && pragma1.next()) {
+        qCInfo(lcDb) << "sqlite3 mmap_size =" << pragma1.int64Value(0);
+    }
+
     // For debugging purposes, allow temp_store to be set
     static QByteArray env_temp_store = qgetenv("OWNCLOUD_SQLITE_TEMP_STORE");
     if (!env_temp_store.isEmpty()) {
@@ -349,26 +405,26 @@ bool SyncJournalDb::checkConnect()
     startTransaction();
 
     SqlQuery createQuery(_db);
-    createQuery.prepare("CREATE TABLE IF NOT EXISTS metadata("
-                        "phash INTEGER(8),"
-                        "pathlen INTEGER,"
-                        "path VARCHAR(4096),"
-                        "inode INTEGER,"
-                        "uid INTEGER,"
-                        "gid INTEGER,"
-                        "mode INTEGER,"
-                        "modtime INTEGER(8),"
-                        "type INTEGER,"
-                        "md5 VARCHAR(32)," /* This is the etag.  Called md5 for compatibility */
-                        // updateDatabaseStructure() will add
-                        // fileid
-                        // remotePerm
-                        // filesize
-                        // ignoredChildrenRemote
-                        // contentChecksum
-                        // contentChecksumTypeId
-                        "PRIMARY KEY(phash)"
-                        ");");
+    createQuery.prepare(createMetadataTableQuery("metadata",
+        "phash INTEGER(8),"
+        "pathlen INTEGER,"
+        "path VARCHAR(4096),"
+        "inode INTEGER,"
+        "uid INTEGER,"
+        "gid INTEGER,"
+        "mode INTEGER,"
+        "modtime INTEGER(8),"
+        "type INTEGER,"
+        "md5 VARCHAR(32)" /* This is the etag.  Called md5 for compatibility */
+        // updateDatabaseStructure() will add
+        // fileid
+        // remotePerm
+        // filesize
+        // ignoredChildrenRemote
+        // contentChecksum
+        // contentChecksumTypeId
+        // e2eMangledName
+        ));
 
 #ifndef SQLITE_IOERR_SHMMAP
 // Requires sqlite >= 3.7.7 but old CentOS6 has sqlite-3.6.20
@@ -492,15 +548,25 @@ bool SyncJournalDb::checkConnect()
         return sqlFail("Create table version", createQuery);
     }
 
+    // The phash format of the metadata table, see updatePHashes()
+    if (!tableColumns("version").contains("phashVersion")) {
+        createQuery.prepare("ALTER TABLE version ADD COLUMN phashVersion INTEGER;");
+        if (!createQuery.exec()) {
+            return sqlFail("Add phashVersion to table version", createQuery);
+        }
+    }
+
     bool forceRemoteDiscovery = false;
 
-    SqlQuery versionQuery("SELECT major, minor, patch FROM version;", _db);
+    SqlQuery versionQuery("SELECT major, minor, patch, phashVersion FROM version;", _db);
     if (!versionQuery.next()) {
         // If there was no entry in the table, it means we are likely upgrading from 1.5
         qCInfo(lcDb) << "possibleUpgradeFromMirall_1_5 detected!";
         forceRemoteDiscovery = true;
+        _storedPHashVersion = 0;
+        _clientVersionChanged = true;
 
-        createQuery.prepare("INSERT INTO version VALUES (?1, ?2, ?3, ?4);");
+        createQuery.prepare("INSERT INTO version (major, minor, patch, custom) VALUES (?1, ?2, ?3, ?4);");
         createQuery.bindValue(1, MIRALL_VERSION_MAJOR);
         createQuery.bindValue(2, MIRALL_VERSION_MINOR);
         createQuery.bindValue(3, MIRALL_VERSION_PATCH);
@@ -513,6 +579,8 @@ bool SyncJournalDb::checkConnect()
         int major = versionQuery.intValue(0);
         int minor = versionQuery.intValue(1);
         int patch = versionQuery.intValue(2);
+        _storedPHashVersion = versionQuery.intValue(3);
+        _clientVersionChanged = !(major == MIRALL_VERSION_MAJOR && minor == MIRALL_VERSION_MINOR && patch == MIRALL_VERSION_PATCH);
 
         if (major == 1 && minor == 8 && (patch == 0 || patch == 1)) {
             qCInfo(lcDb) << "possibleUpgradeFromMirall_1_8_0_or_1 detected!";
@@ -528,7 +596,7 @@ bool SyncJournalDb::checkConnect()
         }
 
         // Not comparing the BUILD id here, correct?
-        if (!(major == MIRALL_VERSION_MAJOR && minor == MIRALL_VERSION_MINOR && patch == MIRALL_VERSION_PATCH)) {
+        if (_clientVersionChanged) {
             createQuery.prepare("UPDATE version SET major=?1, minor=?2, patch =?3, custom=?4 "
                                 "WHERE major=?5 AND minor=?6 AND patch=?7;");
             createQuery.bindValue(1, MIRALL_VERSION_MAJOR);
@@ -608,6 +676,12 @@ void SyncJournalDb::close()
     _db.close();
     clearEtagStorageFilter();
     _metadataTableIsEmpty = false;
+
+    // The temp table went away with the connection
+    if (_discoverySpillMatchedCount > 0)
+        _discoverySpillLost = true;
+    _discoverySpillCount = 0;
+    _discoverySpillMatchedCount = 0;
 }
 
 
@@ -617,6 +691,163 @@ bool SyncJournalDb::updateDatabaseStructure()
         return false;
     if (!updateErrorBlacklistTableStructure())
         return false;
+    if (!updateMetadataTableLayout())
+        return false;
+    if (!updatePHashes())
+        return false;
+    return true;
+}
+
+bool SyncJournalDb::updateMetadataTableLayout()
+{
+    if (!sqliteSupportsWithoutRowid())
+        return true;
+
+    SqlQuery query(_db);
+    query.prepare("SELECT sql FROM sqlite_master WHERE type='table' AND name='metadata';");
+    if (!query.exec() || !query.next()) {
+        return sqlFail("updateMetadataTableLayout: read schema", query);
+    }
+    if (query.baValue(0).toUpper().contains("WITHOUT ROWID"))
+        return true;
+
+    // Rebuild the table clustered on phash, so looking up a record by phash
+    // no longer needs a second probe into the rowid table. The new table gets
+    // the columns of the current one. As for updatePHashes() a failure keeps
+    // the old layout and is retried later.
+    QElapsedTimer timer;
+    timer.start();
+    QByteArrayList columnNames;
+    QByteArrayList columnDefinitions;
+    query.prepare("PRAGMA table_info('metadata');");
+    if (!query.exec()) {
+        return sqlFail("updateMetadataTableLayout: read columns", query);
+    }
+    while (query.next()) {
+        columnNames.append(query.baValue(1));
+        columnDefinitions.append(query.baValue(1) + ' ' + query.baValue(2));
+    }
+    const QByteArray columns = columnNames.join(", ");
+    QVector<QByteArray> steps = {
+        createMetadataTableQuery("metadata_clustered", columnDefinitions.join(", ")),
+        "INSERT INTO metadata_clustered (" + columns + ") SELECT " + columns + " FROM metadata;",
+        "DROP TABLE metadata;",
+        "ALTER TABLE metadata_clustered RENAME TO metadata;",
+    };
+    for (auto index : metadataIndexes)
+        steps.append(index);
+    query.prepare("SAVEPOINT relayout;");
+    query.exec();
+    for (const auto &step : steps) {
+        if (query.prepare(step, true) != SQLITE_OK || !query.exec()) {
+            qCWarning(lcDb) << "updateMetadataTableLayout: rebuilding the metadata table failed" << query.error();
+            query.prepare("ROLLBACK TO relayout;");
+            query.exec();
+            query.prepare("RELEASE relayout;");
+            query.exec();
+            return true;
+        }
+    }
+    query.prepare("RELEASE relayout;");
+    query.exec();
+    commitInternal("update database structure: cluster metadata on phash");
+    qCInfo(lcDb) << "Rebuilt the metadata table without rowid in" << timer.elapsed() << "ms";
+    return true;
+}
+
+/* The phash format, stored in the phashVersion column of the version table:
+ *   0: phash is the c_jhash64 of the path
+ *   1: phash is the c_wyhash64 of the path
+ */
+static const int phashVersion = 1;
+
+static qint64 getLegacyPHash(const QByteArray &file)
+{
+    if (file.isEmpty()) {
+        return -1;
+    }
+    return c_jhash64((uint8_t *)file.data(), file.length(), 0);
+}
+
+static void sqlitePHashFunction(sqlite3_context *context, int, sqlite3_value **argv)
+{
+    auto path = reinterpret_cast<const char *>(sqlite3_value_text(argv[0]));
+    int len = sqlite3_value_bytes(argv[0]);
+    sqlite3_result_int64(context, SyncJournalDb::getPHash(QByteArray::fromRawData(path, len)));
+}
+
+static void sqliteLegacyPHashFunction(sqlite3_context *context, int, sqlite3_value **argv)
+{
+    auto path = reinterpret_cast<const char *>(sqlite3_value_text(argv[0]));
+    int len = sqlite3_value_bytes(argv[0]);
+    sqlite3_result_int64(context, getLegacyPHash(QByteArray::fromRawData(path, len)));
+}
+
+bool SyncJournalDb::updatePHashes()
+{
+    _legacyPHash = _storedPHashVersion < phashVersion;
+    if (!_legacyPHash && !_clientVersionChanged)
+        return true;
+
+    int flags = SQLITE_UTF8;
+#ifdef SQLITE_DETERMINISTIC
+    flags |= SQLITE_DETERMINISTIC;
+#endif
+    if (sqlite3_create_function(_db.sqliteDb(), "phash_v0", 1, flags, nullptr,
+            &sqliteLegacyPHashFunction, nullptr, nullptr)
+            != SQLITE_OK
+        || sqlite3_create_function(_db.sqliteDb(), "phash_v1", 1, flags, nullptr,
+               &sqlitePHashFunction, nullptr, nullptr)
+            != SQLITE_OK) {
+        qCWarning(lcDb) << "updatePHashes: could not register the hash functions, not rehashing";
+        return true;
+    }
+
+    SqlQuery query(_db);
+    if (!_legacyPHash) {
+        // A different client version opened the journal since it was migrated.
+        // Clients older than the migration keep the phashVersion column but
+        // write records keyed by the old hash, look for those.
+        query.prepare("SELECT 1 FROM metadata WHERE phash != phash_v1(path) LIMIT 1;");
+        if (!query.exec()) {
+            return sqlFail("updatePHashes: look for stale records", query);
+        }
+        if (!query.next())
+            return true;
+        qCInfo(lcDb) << "The journal was written by a client using the old phash, rehashing";
+    }
+
+    // Rehash all records. If anything fails the savepoint is rolled back and
+    // the migration is retried the next time the journal is opened.
+    QElapsedTimer timer;
+    timer.start();
+    static const char *steps[] = {
+        // An older client does not find records keyed by the new hash and
+        // inserts a second one for the same path. Keep the one it wrote, it
+        // is the more recent.
+        "DELETE FROM metadata WHERE phash != phash_v0(path) AND path IN "
+        "(SELECT path FROM metadata GROUP BY path HAVING COUNT(*) > 1);",
+        "UPDATE metadata SET phash = phash_v1(path);",
+        "UPDATE version SET phashVersion = 1;",
+    };
+    query.prepare("SAVEPOINT rehash;");
+    query.exec();
+    for (auto step : steps) {
+        if (query.prepare(step, true) != SQLITE_OK || !query.exec()) {
+            qCWarning(lcDb) << "updatePHashes: rehashing failed" << query.error();
+            query.prepare("ROLLBACK TO rehash;");
+            query.exec();
+            query.prepare("RELEASE rehash;");
+            query.exec();
+            return true;
+        }
+    }
+    query.prepare("RELEASE rehash;");
+    query.exec();
+    commitInternal("update database structure: rehash phash");
+    _legacyPHash = false;
+    _storedPHashVersion = phashVersion;
+    qCInfo(lcDb) << "Rehashed the journal records in" << timer.elapsed() << "ms";
     return true;
 }
 
@@ -638,12 +869,6 @@ bool SyncJournalDb::updateMetadataTableStructure()
             sqlFail("updateMetadataTableStructure: Add column fileid", query);
             re = false;
         }
-
-        query.prepare("CREATE INDEX metadata_file_id ON metadata(fileid);");
-        if (!query.exec()) {
-            sqlFail("updateMetadataTableStructure: create index fileid", query);
-            re = false;
-        }
         commitInternal("update database structure: add fileid col");
     }
     if (columns.indexOf("remotePerm") == -1) {
@@ -665,24 +890,14 @@ bool SyncJournalDb::updateMetadataTableStructure()
         commitInternal("update database structure: add filesize col");
     }
 
-    if (true) {
+    for (auto index : metadataIndexes) {
         SqlQuery query(_db);
-        query.prepare("CREATE INDEX IF NOT EXISTS metadata_inode ON metadata(inode);");
+        query.prepare(index);
         if (!query.exec()) {
-            sqlFail("updateMetadataTableStructure: create index inode", query);
+            sqlFail("updateMetadataTableStructure: create index", query);
             re = false;
         }
-        commitInternal("update database structure: add inode index");
-    }
-
-    if (true) {
-        SqlQuery query(_db);
-        query.prepare("CREATE INDEX IF NOT EXISTS metadata_path ON metadata(path);");
-        if (!query.exec()) {
-            sqlFail("updateMetadataTableStructure: create index path", query);
-            re = false;
-        }
-        commitInternal("update database structure: add path index");
+        commitInternal("update database structure: add metadata indexes");
     }
 
     if (columns.indexOf("ignoredChildrenRemote") == -1) {
@@ -811,16 +1026,16 @@ QVector<QByteArray> SyncJournalDb::tableColumns(const QByteArray &table)
 
 qint64 SyncJournalDb::getPHash(const QByteArray &file)
 {
-    int64_t h = 0;
-
     if (file.isEmpty()) {
         return -1;
     }
 
-    int len = file.length();
+    return c_wyhash64(file.constData(), file.length(), 0);
+}
 
-    h = c_jhash64((uint8_t *)file.data(), len, 0);
-    return h;
+qint64 SyncJournalDb::journalPHash(const QByteArray &file) const
+{
+    return _legacyPHash ? getLegacyPHash(file) : getPHash(file);
 }
 
 bool SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
@@ -845,8 +1060,8 @@ bool SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
                  << "etag:" << record._etag << "fileId:" << record._fileId << "remotePerm:" << record._remotePerm.toString()
                  << "fileSize:" << record._fileSize << "checksum:" << record._checksumHeader << "e2eMangledName:" << record._e2eMangledName;
 
-    qlonglong phash = getPHash(record._path);
     if (checkConnect()) {
+        qlonglong phash = journalPHash(record._path);
         int plen = record._path.length();
 
         QByteArray etag(record._etag);
@@ -910,7 +1125,7 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
         if (!_deleteFileRecordPhash.initOrReset(QByteArrayLiteral("DELETE FROM metadata WHERE phash=?1"), _db))
             return false;
 
-        qlonglong phash = getPHash(filename.toUtf8());
+        qlonglong phash = journalPHash(filename.toUtf8());
         _deleteFileRecordPhash.bindValue(1, phash);
 
         if (!_deleteFileRecordPhash.exec())
@@ -951,7 +1166,7 @@ bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRec
         if (!_getFileRecordQuery.initOrReset(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE phash=?1"), _db))
             return false;
 
-        _getFileRecordQuery.bindValue(1, getPHash(filename));
+        _getFileRecordQuery.bindValue(1, journalPHash(filename));
 
         if (!_getFileRecordQuery.exec()) {
             close();
@@ -1123,8 +1338,217 @@ bool SyncJournalDb::getFilesBelowPath(const QByteArray &path, const std::functio
     return true;
 }
 
+bool SyncJournalDb::getSubdirectories(const QByteArray &path, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_metadataTableIsEmpty)
+        return true; // no error, yet nothing found
+
+    if (!checkConnect())
+        return false;
+
+    // Walks the path index one direct child at a time and jumps over the
+    // subtree of every child, so the cost depends on the number of direct
+    // children and not on how much is below them.
+    const QByteArray prefix = path.isEmpty() ? QByteArray() : path + '/';
+    QByteArray lowerBound = prefix;
+    forever {
+        if (!_getSubdirectoriesQuery.initOrReset(QByteArrayLiteral(
+                GET_FILE_RECORD_QUERY " WHERE path >= ?1 ORDER BY path ASC LIMIT 1"), _db)) {
+            return false;
+        }
+        _getSubdirectoriesQuery.bindValue(1, lowerBound);
+        if (!_getSubdirectoriesQuery.exec()) {
+            return false;
+        }
+        if (!_getSubdirectoriesQuery.next())
+            break;
+
+        SyncJournalFileRecord rec;
+        fillFileRecordFromGetQuery(rec, _getSubdirectoriesQuery);
+        if (!rec._path.startsWith(prefix))
+            break;
+
+        const int slash = rec._path.indexOf('/', prefix.size());
+        if (slash == -1) {
+            if (rec._type == ItemTypeDirectory)
+                rowCallback(rec);
+            // The smallest path after this one, paths can't contain a NUL
+            lowerBound = rec._path + '\x01';
+        } else {
+            // Below a direct child, continue after its subtree
+            lowerBound = rec._path.left(slash) + '0';
+        }
+    }
+
+    return true;
+}
+
+#define GET_SPILLED_DISCOVERY_RECORD_QUERY \
+        "SELECT path, inode, modtime, type, filesize, checksum FROM temp.discoveryspill"
+
+static void fillFileRecordFromSpillQuery(SyncJournalFileRecord &rec, SqlQuery &query)
+{
+    rec._path = query.baValue(0);
+    rec._inode = query.int64Value(1);
+    rec._modtime = query.int64Value(2);
+    rec._type = static_cast<ItemType>(query.intValue(3));
+    rec._fileSize = query.int64Value(4);
+    rec._checksumHeader = query.baValue(5);
+}
+
+bool SyncJournalDb::spillDiscoveryRecord(const SyncJournalFileRecord &record)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!checkConnect())
+        return false;
+
+    if (_discoverySpillCount == 0) {
+        // The temp database is private to this connection and is backed by a
+        // temporary file unless temp_store was forced to memory.
+        SqlQuery createQuery(_db);
+        createQuery.prepare("CREATE TEMP TABLE IF NOT EXISTS discoveryspill("
+                            "path TEXT PRIMARY KEY,"
+                            "inode INTEGER,"
+                            "modtime INTEGER,"
+                            "type INTEGER,"
+                            "filesize INTEGER,"
+                            "checksum TEXT,"
+                            "matched INTEGER DEFAULT 0"
+                            ");");
+        if (!createQuery.exec()) {
+            return sqlFail("Create temp table discoveryspill", createQuery);
+        }
+    }
+
+    if (!_spillDiscoveryRecordQuery.initOrReset(QByteArrayLiteral(
+            "INSERT OR REPLACE INTO temp.discoveryspill (path, inode, modtime, type, filesize, checksum) "
+            "VALUES (?1, ?2, ?3, ?4, ?5, ?6);"), _db)) {
+        return false;
+    }
+    _spillDiscoveryRecordQuery.bindValue(1, record._path);
+    _spillDiscoveryRecordQuery.bindValue(2, record._inode);
+    _spillDiscoveryRecordQuery.bindValue(3, record._modtime);
+    _spillDiscoveryRecordQuery.bindValue(4, record._type);
+    _spillDiscoveryRecordQuery.bindValue(5, record._fileSize);
+    _spillDiscoveryRecordQuery.bindValue(6, record._checksumHeader);
+    if (!_spillDiscoveryRecordQuery.exec())
+        return false;
+
+    ++_discoverySpillCount;
+    return true;
+}
+
+bool SyncJournalDb::matchSpilledDiscoveryRecord(const QByteArray &path, bool *found)
+{
+    QMutexLocker locker(&_mutex);
+    *found = false;
+
+    if (_discoverySpillCount == _discoverySpillMatchedCount)
+        return true; // nothing left to match
+
+    if (!checkConnect())
+        return false;
+
+    if (!_matchSpilledDiscoveryRecordQuery.initOrReset(QByteArrayLiteral(
+            "UPDATE temp.discoveryspill SET matched=1 WHERE path=?1 AND matched=0;"), _db)) {
+        return false;
+    }
+    _matchSpilledDiscoveryRecordQuery.bindValue(1, path);
+    if (!_matchSpilledDiscoveryRecordQuery.exec())
+        return false;
+
+    if (_matchSpilledDiscoveryRecordQuery.numRowsAffected() > 0) {
+        *found = true;
+        ++_discoverySpillMatchedCount;
+    }
+    return true;
+}
+
+bool SyncJournalDb::takeSpilledDiscoveryRecord(const QByteArray &path, SyncJournalFileRecord *record)
+{
+    QMutexLocker locker(&_mutex);
+    *record = SyncJournalFileRecord();
+
+    if (_discoverySpillCount == _discoverySpillMatchedCount)
+        return true;
+
+    if (!checkConnect())
+        return false;
+
+    if (!_getSpilledDiscoveryRecordQuery.initOrReset(QByteArrayLiteral(
+            GET_SPILLED_DISCOVERY_RECORD_QUERY " WHERE path=?1 AND matched=0;"), _db)) {
+        return false;
+    }
+    _getSpilledDiscoveryRecordQuery.bindValue(1, path);
+    if (!_getSpilledDiscoveryRecordQuery.exec())
+        return false;
+    if (!_getSpilledDiscoveryRecordQuery.next())
+        return true; // not spilled
+    fillFileRecordFromSpillQuery(*record, _getSpilledDiscoveryRecordQuery);
+    _getSpilledDiscoveryRecordQuery.reset_and_clear_bindings();
+
+    if (!_deleteSpilledDiscoveryRecordQuery.initOrReset(QByteArrayLiteral(
+            "DELETE FROM temp.discoveryspill WHERE path=?1;"), _db)) {
+        return false;
+    }
+    _deleteSpilledDiscoveryRecordQuery.bindValue(1, path);
+    if (!_deleteSpilledDiscoveryRecordQuery.exec())
+        return false;
+
+    --_discoverySpillCount;
+    return true;
+}
+
+bool SyncJournalDb::takeUnmatchedSpilledDiscoveryRecords(const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_discoverySpillCount == _discoverySpillMatchedCount)
+        return true;
+
+    if (!checkConnect())
+        return false;
+
+    SqlQuery query(_db);
+    query.prepare(GET_SPILLED_DISCOVERY_RECORD_QUERY " WHERE matched=0;");
+    if (!query.exec())
+        return false;
+    while (query.next()) {
+        SyncJournalFileRecord rec;
+        fillFileRecordFromSpillQuery(rec, query);
+        rowCallback(rec);
+    }
+    query.finish();
+
+    SqlQuery delQuery(_db);
+    delQuery.prepare("DELETE FROM temp.discoveryspill WHERE matched=0;");
+    if (!delQuery.exec())
+        return false;
+
+    _discoverySpillCount = _discoverySpillMatchedCount;
+    return true;
+}
+
+void SyncJournalDb::clearDiscoverySpill()
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_discoverySpillCount > 0 && _db.isOpen()) {
+        SqlQuery query(_db);
+        query.prepare("DELETE FROM temp.discoveryspill;");
+        query.exec();
+    }
+    _discoverySpillCount = 0;
+    _discoverySpillMatchedCount = 0;
+    _discoverySpillLost = false;
+}
+
 bool SyncJournalDb::postSyncCleanup(const QSet<QString> &filepathsToKeep,
-    const QSet<QString> &prefixesToKeep)
+    const QSet<QString> &prefixesToKeep,
+    const QSet<QString> &subtreesToKeep)
 {
     QMutexLocker locker(&_mutex);
 
@@ -1132,8 +1556,21 @@ bool SyncJournalDb::postSyncCleanup(const QSet<QString> &filepathsToKeep,
         return false;
     }
 
+    if (_discoverySpillLost) {
+        // The spilled entries that were seen during discovery are gone, we
+        // can't tell which records are superfluous.
+        qCWarning(lcDb) << "Discovery spill store was lost, skipping sync journal cleanup";
+        return false;
+    }
+
     SqlQuery query(_db);
-    query.prepare("SELECT phash, path FROM metadata order by path");
+    if (_discoverySpillMatchedCount > 0) {
+        query.prepare("SELECT phash, path FROM metadata"
+                      " WHERE path NOT IN (SELECT path FROM temp.discoveryspill WHERE matched=1)"
+                      " order by path");
+    } else {
+        query.prepare("SELECT phash, path FROM metadata order by path");
+    }
 
     if (!query.exec()) {
         return false;
@@ -1144,6 +1581,11 @@ bool SyncJournalDb::postSyncCleanup(const QSet<QString> &filepathsToKeep,
     while (query.next()) {
         const QString file = query.baValue(1);
         bool keep = filepathsToKeep.contains(file);
+        if (!keep && !subtreesToKeep.isEmpty()) {
+            for (int pos = file.indexOf('/'); pos > 0 && !keep; pos = file.indexOf('/', pos + 1)) {
+                keep = subtreesToKeep.contains(file.left(pos));
+            }
+        }
         if (!keep) {
             foreach (const QString &prefix, prefixesToKeep) {
                 if (file.startsWith(prefix)) {
@@ -1167,6 +1609,13 @@ bool SyncJournalDb::postSyncCleanup(const QSet<QString> &filepathsToKeep,
         }
     }
 
+    // Give pages freed by deletes back to the file system. This only has an
+    // effect on journals created with auto_vacuum = INCREMENTAL.
+    query.prepare("PRAGMA incremental_vacuum;");
+    query.exec();
+    while (query.next()) {
+    }
+
     // Incorporate results back into main DB
     walCheckpoint();
 
@@ -1200,11 +1649,11 @@ bool SyncJournalDb::updateFileRecordChecksum(const QString &filename,
 
     qCInfo(lcDb) << "Updating file checksum" << filename << contentChecksum << contentChecksumType;
 
-    qlonglong phash = getPHash(filename.toUtf8());
     if (!checkConnect()) {
         qCWarning(lcDb) << "Failed to connect database.";
         return false;
     }
+    qlonglong phash = journalPHash(filename.toUtf8());
 
     int checksumTypeId = mapChecksumType(contentChecksumType);
 
@@ -1228,11 +1677,11 @@ bool SyncJournalDb::updateLocalMetadata(const QString &filename,
 
     qCInfo(lcDb) << "Updating local metadata for:" << filename << modtime << size << inode;
 
-    qlonglong phash = getPHash(filename.toUtf8());
     if (!checkConnect()) {
         qCWarning(lcDb) << "Failed to connect database.";
         return false;
     }
+    qlonglong phash = journalPHash(filename.toUtf8());
 
 
     if (!_setFileRecordLocalMetadataQuery.initOrReset(QByteArrayLiteral(
@@ -60,6 +60,8 @@ public:
     bool getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec);
     bool getFileRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
     bool getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
+    /// Lists the directories directly inside path, "" is the sync root
+    bool getSubdirectories(const QByteArray &path, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
     bool setFileRecord(const SyncJournalFileRecord &record);
 
     /// Like setFileRecord, but preserves checksums
@@ -76,6 +78,7 @@ public:
 
     QString databaseFilePath() const;
 
+    /// The hash of the path that metadata records are keyed by
     static qint64 getPHash(const QByteArray &);
 
     void setErrorBlacklistEntry(const SyncJournalErrorBlacklistRecord &item);
@@ -183,8 +186,35 @@ public:
      */
     void forceRemoteDiscoveryNextSync();
 
+    /**
+     * Discovery spill store.
+     *
+     * When the discovery runs with a memory budget, unchanged local files are
+     * moved out of the in-memory tree into a temporary table of this connection.
+     * The remote discovery then either confirms them as unchanged (matched) or
+     * takes them back into memory. The table is dropped on close().
+     *
+     * Matched entries count as seen files for postSyncCleanup().
+     */
+    bool spillDiscoveryRecord(const SyncJournalFileRecord &record);
+    /// Marks a spilled entry as matched; *found is false if there was no unmatched entry
+    bool matchSpilledDiscoveryRecord(const QByteArray &path, bool *found);
+    /// Removes an entry from the spill store, *record is invalid if there was none
+    bool takeSpilledDiscoveryRecord(const QByteArray &path, SyncJournalFileRecord *record);
+    /// Removes all entries that were not matched and passes them to rowCallback
+    bool takeUnmatchedSpilledDiscoveryRecords(const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+    void clearDiscoverySpill();
+
+    /**
+     * Deletes the records that were not seen during the sync.
+     *
+     * Records of filepathsToKeep, those starting with one of prefixesToKeep and
+     * those below one of the directories in subtreesToKeep are kept. The
+     * latter are checked per parent directory and may be large.
+     */
     bool postSyncCleanup(const QSet<QString> &filepathsToKeep,
-        const QSet<QString> &prefixesToKeep);
+        const QSet<QString> &prefixesToKeep,
+        const QSet<QString> &subtreesToKeep = QSet<QString>());
 
     /* Because sqlite transactions are really slow, we encapsulate everything in big transactions
      * Commit will actually commit the transaction and create a new one.
@@ -242,9 +272,14 @@ private:
     void commitInternal(const QString &context, bool startTrans = true);
     void startTransaction();
     void commitTransaction();
+    bool updateMetadataTableLayout();
+    bool updatePHashes();
     QVector<QByteArray> tableColumns(const QByteArray &table);
     bool checkConnect();
 
+    // getPHash(), or the old hash if the journal could not be migrated yet
+    qint64 journalPHash(const QByteArray &file) const;
+
     // Same as forceRemoteDiscoveryNextSync but without acquiring the lock
     void forceRemoteDiscoveryNextSyncLocked();
 
@@ -258,6 +293,9 @@ private:
     QMutex _mutex; // Public functions are protected with the mutex.
     int _transaction;
     bool _metadataTableIsEmpty;
+    bool _legacyPHash = false;
+    int _storedPHashVersion = 0; // as read from the version table on open
+    bool _clientVersionChanged = false; // the journal was last opened by another version
 
     SqlQuery _getFileRecordQuery;
     SqlQuery _getFileRecordQueryByMangledName;
@@ -265,6 +303,7 @@ private:
     SqlQuery _getFileRecordQueryByFileId;
     SqlQuery _getFilesBelowPathQuery;
     SqlQuery _getAllFilesQuery;
+    SqlQuery _getSubdirectoriesQuery;
     SqlQuery _setFileRecordQuery;
     SqlQuery _setFileRecordChecksumQuery;
     SqlQuery _setFileRecordLocalMetadataQuery;
@@ -288,6 +327,18 @@ private:
     SqlQuery _getConflictRecordQuery;
     SqlQuery _setConflictRecordQuery;
     SqlQuery _deleteConflictRecordQuery;
+    SqlQuery _spillDiscoveryRecordQuery;
+    SqlQuery _matchSpilledDiscoveryRecordQuery;
+    SqlQuery _getSpilledDiscoveryRecordQuery;
+    SqlQuery _deleteSpilledDiscoveryRecordQuery;
+
+    /* Number of rows in the discovery spill table, and how many of them were
+     * matched. If the connection is closed while there are matched entries,
+     * postSyncCleanup() can no longer tell which records to keep and is skipped.
+     */
+    int _discoverySpillCount = 0;
+    int _discoverySpillMatchedCount = 0;
+    bool _discoverySpillLost = false;
 
     /* Storing etags to these folders, or their parent folders, is filtered out.
      *
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+/**
+ * USDT probes for perf, bpftrace and SystemTap, under the provider "nextcloud"
+ *
+ * They are only compiled in with the WITH_USDT_PROBES cmake option, which
+ * needs sys/sdt.h. A probe without an attached tracer is a nop, but its
+ * arguments are evaluated anyway. Strings are passed as zero terminated char
+ * pointers.
+ *
+ * Every probe has a semaphore that the tracer increments while it is
+ * attached. A file declares the semaphores of the probes it uses with
+ * OC_TRACE_SEMAPHORE(name) in the global namespace. Arguments that are
+ * expensive to compute are only built when OC_TRACE_ENABLED(name) is true:
+ *
+ *   if (OC_TRACE_ENABLED(job_started))
+ *       OC_TRACE(job_started, this, _item->_file.toUtf8().constData(), ...);
+ *
+ * The probes carry no timestamps. Durations are the time between the start
+ * and the end probe of an operation, matched by thread or by the id
+ * argument, for example
+ *
+ *   bpftrace -e 'usdt:libnextcloudsync.so:nextcloud:request_sent { @t[arg0] = nsecs; }
+ *       usdt:libnextcloudsync.so:nextcloud:request_finished /@t[arg0]/ {
+ *           @ms = hist((nsecs - @t[arg0]) / 1000000); delete(@t[arg0]); }'
+ *
+ * Probes (arguments):
+ * - dir_opened (replica, path): csync_ftw() starts to read a directory,
+ *   replica is 'l' or 'r', the end is dir_finished on the same thread
+ * - dir_finished (replica, path, result)
+ * - sql_exec_start (sql), sql_exec_end (sql, sqlite result) on the same thread,
+ *   only for statements that SqlQuery::exec() runs: selects are stepped by next()
+ * - propagator_schedule (active jobs): the propagator looks for jobs to start
+ * - job_started (job, path, instruction, size), job_finished (job, path, status, size)
+ * - request_sent (job, verb, url, body size), request_finished (job, http status, network error)
+ * - checksum_start (path, type), checksum_end (type, checksum length) on the same thread
+ * - inotify_batch (fd, bytes): a read of inotify events
+ */
+#ifdef WITH_USDT_PROBES
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define OC_TRACE_SEMAPHORE(name) \
+    static volatile unsigned short nextcloud_##name##_semaphore __attribute__((used, section(".probes")))
+#define OC_TRACE_ENABLED(name) __builtin_expect(nextcloud_##name##_semaphore != 0, 0)
+#define OC_TRACE(name, ...) STAP_PROBEV(nextcloud, name, ##__VA_ARGS__)
+#else
+#define OC_TRACE_SEMAPHORE(name) static_assert(true, "")
+#define OC_TRACE_ENABLED(name) false
+#define OC_TRACE(name, ...) \
+    do {                    \
+    } while (false)
+#endif
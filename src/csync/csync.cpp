@@ -81,6 +81,8 @@ int csync_update(CSYNC *ctx) {
       qCInfo(lcCSync, "No exclude file loaded or defined!");
   }
 
+  ctx->statedb->clearDiscoverySpill();
+
   /* update detection for local replica */
   QElapsedTimer timer;
   timer.start();
@@ -98,6 +100,9 @@ int csync_update(CSYNC *ctx) {
 
   qCInfo(lcCSync) << "Update detection for local replica took" << timer.elapsed() / 1000.
                   << "seconds walking" << ctx->local.files.size() << "files";
+  if (ctx->spilled_files > 0) {
+      qCInfo(lcCSync) << "Spilled" << ctx->spilled_files << "unchanged local files to the database";
+  }
   csync_memstat_check();
 
   /* update detection for remote replica */
@@ -114,6 +119,15 @@ int csync_update(CSYNC *ctx) {
       return rc;
   }
 
+  rc = csync_load_deferred_local(ctx);
+  if (rc < 0) {
+      return rc;
+  }
+
+  rc = csync_unspill_unmatched(ctx);
+  if (rc < 0) {
+      return rc;
+  }
 
   qCInfo(lcCSync) << "Update detection for remote replica took" << timer.elapsed() / 1000.
                   << "seconds walking" << ctx->remote.files.size() << "files";
@@ -150,6 +164,8 @@ int csync_reconcile(CSYNC *ctx) {
   qCInfo(lcCSync) << "Reconciliation for remote replica took " << timer.elapsed() / 1000.
                   << "seconds visiting " << ctx->remote.files.size() << " files.";
 
+  csync_reconcile_one_way(ctx);
+
   ctx->status |= CSYNC_STATUS_RECONCILE;
   return 0;
 }
@@ -239,6 +255,13 @@ int csync_s::reinitialize() {
 
   local.files.clear();
   remote.files.clear();
+  local_files_memory = 0;
+  spilled_files = 0;
+  spilled_files_matched = 0;
+  local_deferred_dirs.clear();
+  clean_subtrees.clear();
+  local_changed_dirs.clear();
+  sync_scope.clear();
 
   renames.folder_renamed_from.clear();
   renames.folder_renamed_to.clear();
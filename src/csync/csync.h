@@ -140,6 +140,16 @@ enum ItemType {
     ItemTypeSkip = 3
 };
 
+/**
+ * Which directions are synced. The one-way modes skip the work that is only
+ * needed for the other direction.
+ */
+enum class SyncMode {
+    Bidirectional,
+    DownloadOnly, //< the local tree mirrors the server, local changes are reverted
+    UploadOnly, //< local changes are uploaded, remote changes are left alone
+};
+
 
 #define FILE_ID_BUF_SIZE 36
 
@@ -41,6 +41,7 @@
 #include <functional>
 
 #include "common/syncjournaldb.h"
+#include "common/c_wyhash.h"
 #include "config_csync.h"
 #include "std/c_lib.h"
 #include "std/c_private.h"
@@ -107,7 +108,8 @@ public:
     friend bool operator==(const ByteArrayRef &a, const ByteArrayRef &b)
     { return a.size() == b.size() && qstrncmp(a.data(), b.data(), a.size()) == 0; }
 };
-struct ByteArrayRefHash { uint operator()(const ByteArrayRef &a) const { return qHashBits(a.data(), a.size()); } };
+/* Same hash as the journal phash, see SyncJournalDb::getPHash */
+struct ByteArrayRefHash { size_t operator()(const ByteArrayRef &a) const { return static_cast<size_t>(c_wyhash64(a.data(), a.size(), 0)); } };
 
 /**
  * @brief csync public structure
@@ -203,10 +205,48 @@ struct OCSYNC_EXPORT csync_s {
 
   std::function<bool(const QByteArray &)> should_discover_locally_fn;
 
+  /**
+   * Restricts the discovery to these paths, relative to the sync root, and
+   * their parent directories. Everything else is left out of both trees.
+   * Empty for a sync of the whole tree.
+   */
+  std::set<QByteArray> sync_scope;
+
+  SyncMode sync_mode = SyncMode::Bidirectional;
+
   bool ignore_hidden_files = true;
 
   bool upload_conflict_files = false;
 
+  /**
+   * Approximate memory budget in bytes for the local tree, 0 means unlimited.
+   *
+   * Beyond the budget unchanged local files are spilled to the statedb instead
+   * of being kept in local.files. The remote discovery drops the remote side of
+   * files that are unchanged on both sides and takes everything else back into
+   * memory, so reconcile and treewalk never see the clean pairs.
+   */
+  int64_t discovery_memory_budget = 0;
+  int64_t local_files_memory = 0;
+  int64_t spilled_files = 0;
+  int64_t spilled_files_matched = 0;
+
+  /**
+   * Local directories that would be read from the db are only loaded after
+   * the remote discovery. Where the remote side is read from the db too, the
+   * subtree is unchanged on both sides and neither side gets loaded, so a
+   * sync only pays for the parts of the tree that changed.
+   */
+  std::set<QByteArray> local_deferred_dirs;
+  /** Directories whose contents were left out of both trees, see above. */
+  std::set<QByteArray> clean_subtrees;
+
+  /**
+   * Local directories that contain changes, filled in upload-only mode.
+   * The remote side of all other directories is read from the db.
+   */
+  std::set<QByteArray> local_changed_dirs;
+
   csync_s(const char *localUri, OCC::SyncJournalDb *statedb);
   ~csync_s();
   int reinitialize();
@@ -467,4 +467,96 @@ void csync_reconcile_updates(CSYNC *ctx) {
   }
 }
 
+/* Download-only: the server wins, local changes are undone */
+static void _csync_revert_local_changes(CSYNC *ctx)
+{
+    for (auto &pair : ctx->local.files) {
+        csync_file_stat_t *cur = pair.second.get();
+        csync_file_stat_t *other = ctx->remote.files.findFile(cur->path);
+        switch (cur->instruction) {
+        case CSYNC_INSTRUCTION_NEW:
+            // Only exists locally. As in the merge, directories with ignored files stay.
+            cur->instruction = cur->has_ignored_files ? CSYNC_INSTRUCTION_NONE : CSYNC_INSTRUCTION_REMOVE;
+            break;
+        case CSYNC_INSTRUCTION_SYNC:
+        case CSYNC_INSTRUCTION_TYPE_CHANGE:
+            // Modified locally, download the server version again
+            if (other) {
+                other->instruction = cur->instruction;
+                cur->instruction = CSYNC_INSTRUCTION_NONE;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    for (auto &pair : ctx->remote.files) {
+        csync_file_stat_t *cur = pair.second.get();
+        switch (cur->instruction) {
+        case CSYNC_INSTRUCTION_REMOVE:
+            // Removed locally
+            cur->instruction = CSYNC_INSTRUCTION_NEW;
+            break;
+        case CSYNC_INSTRUCTION_CONFLICT: {
+            // No conflict copy, the local version is drift
+            csync_file_stat_t *other = ctx->local.files.findFile(cur->path);
+            cur->instruction = other && other->type != cur->type
+                ? CSYNC_INSTRUCTION_TYPE_CHANGE : CSYNC_INSTRUCTION_SYNC;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+/* Upload-only: the client wins, remote changes are left alone */
+static void _csync_ignore_remote_changes(CSYNC *ctx)
+{
+    for (auto &pair : ctx->remote.files) {
+        csync_file_stat_t *cur = pair.second.get();
+        switch (cur->instruction) {
+        case CSYNC_INSTRUCTION_CONFLICT: {
+            // Overwrite the server version, the upload uses its etag
+            csync_file_stat_t *other = ctx->local.files.findFile(cur->path);
+            if (other && other->type == cur->type) {
+                other->instruction = CSYNC_INSTRUCTION_SYNC;
+            }
+            cur->instruction = CSYNC_INSTRUCTION_NONE;
+            break;
+        }
+        case CSYNC_INSTRUCTION_NEW:
+        case CSYNC_INSTRUCTION_EVAL:
+        case CSYNC_INSTRUCTION_SYNC:
+        case CSYNC_INSTRUCTION_TYPE_CHANGE:
+            cur->instruction = CSYNC_INSTRUCTION_NONE;
+            break;
+        default:
+            break;
+        }
+    }
+    for (auto &pair : ctx->local.files) {
+        csync_file_stat_t *cur = pair.second.get();
+        // Removed or moved on the server: keep the local file
+        if (cur->instruction == CSYNC_INSTRUCTION_REMOVE
+            || cur->instruction == CSYNC_INSTRUCTION_RENAME) {
+            cur->instruction = CSYNC_INSTRUCTION_NONE;
+        }
+    }
+}
+
+void csync_reconcile_one_way(CSYNC *ctx)
+{
+    switch (ctx->sync_mode) {
+    case SyncMode::DownloadOnly:
+        _csync_revert_local_changes(ctx);
+        break;
+    case SyncMode::UploadOnly:
+        _csync_ignore_remote_changes(ctx);
+        break;
+    case SyncMode::Bidirectional:
+        break;
+    }
+}
+
 /* vim: set ts=8 sw=2 et cindent: */
@@ -50,6 +50,15 @@
  */
 void OCSYNC_EXPORT csync_reconcile_updates(CSYNC *ctx);
 
+/**
+ * @brief Drops the instructions for the direction that isn't synced.
+ *
+ * Only does something in the one-way sync modes, see SyncMode.
+ *
+ * @param  ctx          The csync context to use.
+ */
+void OCSYNC_EXPORT csync_reconcile_one_way(CSYNC *ctx);
+
 /**
  * }@
  */
@@ -45,6 +45,7 @@
 
 #include "common/utility.h"
 #include "common/asserts.h"
+#include "common/tracing.h"
 
 #include <QtCore/QTextCodec>
 
@@ -54,6 +55,9 @@
 
 Q_LOGGING_CATEGORY(lcUpdate, "nextcloud.sync.csync.updater", QtInfoMsg)
 
+OC_TRACE_SEMAPHORE(dir_opened);
+OC_TRACE_SEMAPHORE(dir_finished);
+
 #ifdef NO_RENAME_EXTENSION
 /* Return true if the two path have the same extension. false otherwise. */
 static bool _csync_sameextension(const char *p1, const char *p2) {
@@ -94,6 +98,137 @@ static bool _csync_mtime_equal(time_t a, time_t b)
     return false;
 }
 
+/* Rough estimate of the memory held by an entry of a FileMap, including the hash node. */
+static int64_t _csync_file_stat_memory(const csync_file_stat_t &fs)
+{
+    return sizeof(csync_file_stat_t) + 4 * sizeof(void *)
+        + fs.path.size() + fs.etag.size() + fs.file_id.size()
+        + fs.checksumHeader.size() + fs.e2eMangledName.size();
+}
+
+/* Only unchanged plain files are spilled, everything else may be needed
+ * by the reconciler even if the other side is unchanged too. */
+static bool _csync_should_spill(CSYNC *ctx, const csync_file_stat_t &fs)
+{
+    return ctx->current == LOCAL_REPLICA
+        && ctx->discovery_memory_budget > 0
+        && ctx->local_files_memory >= ctx->discovery_memory_budget
+        && fs.type == ItemTypeFile
+        && fs.instruction == CSYNC_INSTRUCTION_NONE
+        && fs.error_status == CSYNC_STATUS_OK
+        && fs.e2eMangledName.isEmpty();
+}
+
+static bool _csync_spill_local(CSYNC *ctx, const csync_file_stat_t &fs)
+{
+    OCC::SyncJournalFileRecord rec;
+    rec._path = fs.path;
+    rec._inode = fs.inode;
+    rec._modtime = fs.modtime;
+    rec._type = fs.type;
+    rec._fileSize = fs.size;
+    rec._checksumHeader = fs.checksumHeader;
+    if (!ctx->statedb->spillDiscoveryRecord(rec)) {
+        return false;
+    }
+    ++ctx->spilled_files;
+    return true;
+}
+
+static void _csync_store_local(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> fs)
+{
+    ctx->local_files_memory += _csync_file_stat_memory(*fs);
+    QByteArray path = fs->path;
+    ctx->local.files[path] = std::move(fs);
+}
+
+/* Resolve a remote entry against the spilled local files.
+ * If both sides are unchanged, the local entry stays spilled and *drop is set
+ * as the remote entry is not needed either. Otherwise the local entry is taken
+ * back into the local tree so the reconciler can see it. */
+static bool _csync_match_spilled(CSYNC *ctx, const csync_file_stat_t &fs, bool *drop)
+{
+    *drop = false;
+    if (ctx->spilled_files == ctx->spilled_files_matched) {
+        return true;
+    }
+
+    if (fs.type == ItemTypeFile
+        && fs.instruction == CSYNC_INSTRUCTION_NONE
+        && fs.error_status == CSYNC_STATUS_OK) {
+        bool found = false;
+        if (!ctx->statedb->matchSpilledDiscoveryRecord(fs.path, &found)) {
+            return false;
+        }
+        if (found) {
+            ++ctx->spilled_files_matched;
+            *drop = true;
+        }
+        return true;
+    }
+
+    OCC::SyncJournalFileRecord rec;
+    if (!ctx->statedb->takeSpilledDiscoveryRecord(fs.path, &rec)) {
+        return false;
+    }
+    if (rec.isValid()) {
+        --ctx->spilled_files;
+        _csync_store_local(ctx, csync_file_stat_t::fromSyncJournalFileRecord(rec));
+    }
+    return true;
+}
+
+/* Whether path is one of dirs or lies below one of them, "" being the root. */
+static bool _csync_is_in_dirs(const std::set<QByteArray> &dirs, const QByteArray &path)
+{
+    if (dirs.empty()) {
+        return false;
+    }
+    if (dirs.count(QByteArray())) {
+        return true;
+    }
+    int pos = 0;
+    forever {
+        pos = path.indexOf('/', pos);
+        if (dirs.count(pos < 0 ? path : path.left(pos))) {
+            return true;
+        }
+        if (pos < 0) {
+            return false;
+        }
+        ++pos;
+    }
+}
+
+/* Upload-only: remembers the directories that contain a local change */
+static void _csync_record_local_change(CSYNC *ctx, const csync_file_stat_t &fs)
+{
+    QByteArray dir = fs.type == ItemTypeDirectory ? fs.path : QByteArray();
+    if (dir.isEmpty()) {
+        const int pos = fs.path.lastIndexOf('/');
+        if (pos < 0) {
+            return;
+        }
+        dir = fs.path.left(pos);
+    }
+    while (ctx->local_changed_dirs.insert(dir).second) {
+        const int pos = dir.lastIndexOf('/');
+        if (pos < 0) {
+            break;
+        }
+        dir.truncate(pos);
+    }
+}
+
+/* Upload-only: whether the remote side of the directory has to be listed */
+static bool _csync_needs_remote_listing(CSYNC *ctx, const QByteArray &path)
+{
+    if (_csync_is_in_dirs(ctx->local_deferred_dirs, path)) {
+        return false;
+    }
+    return ctx->local_changed_dirs.count(path) || !ctx->local.files.findFile(path);
+}
+
 /**
  * The main function of the discovery/update pass.
  *
@@ -218,9 +353,23 @@ static int _csync_detect_update(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> f
                 fs->etag.constData(), base._etag.constData(), (uint64_t) fs->inode, (uint64_t) base._inode,
                 (uint64_t) fs->size, (uint64_t) base._fileSize, *reinterpret_cast<short*>(&fs->remotePerm), *reinterpret_cast<short*>(&base._remotePerm),
                 fs->checksumHeader.constData(), base._checksumHeader.constData(), base._serverHasIgnoredFiles, base._e2eMangledName.constData());
+      if (ctx->current == REMOTE_REPLICA && ctx->sync_mode == SyncMode::UploadOnly
+              && fs->type == ItemTypeDirectory && base._type == ItemTypeDirectory
+              && fs->etag != base._etag && !_csync_needs_remote_listing(ctx, fs->path)) {
+          /* Nothing to upload below, treat it as unchanged so that its contents
+           * are read from the db. */
+          qCInfo(lcUpdate, "Upload only, not listing %s", fs->path.constData());
+          fs->etag = base._etag;
+      }
       if (ctx->current == REMOTE_REPLICA && fs->etag != base._etag) {
           fs->instruction = CSYNC_INSTRUCTION_EVAL;
 
+          // Remote changes are not synced in upload-only mode. Keeping the old
+          // etag makes a later two-way sync list the directory again.
+          if (ctx->sync_mode == SyncMode::UploadOnly && fs->type == ItemTypeDirectory) {
+              fs->etag = base._etag;
+          }
+
           // Preserve the EVAL flag later on if the type has changed.
           if (base._type != fs->type) {
               fs->child_modified = true;
@@ -234,9 +383,11 @@ static int _csync_detect_update(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> f
                || (base._fileSize != 0 && fs->size != base._fileSize))) {
 
           // Checksum comparison at this stage is only enabled for .eml files,
-          // check #4754 #4755
+          // check #4754 #4755. Not in download-only mode, the file gets
+          // overwritten anyway.
           bool isEmlFile = csync_fnmatch("*.eml", fs->path, FNM_CASEFOLD) == 0;
-          if (isEmlFile && fs->size == base._fileSize && !base._checksumHeader.isEmpty()) {
+          if (isEmlFile && fs->size == base._fileSize && !base._checksumHeader.isEmpty()
+              && ctx->sync_mode != SyncMode::DownloadOnly) {
               if (ctx->callbacks.checksum_hook) {
                   fs->checksumHeader = ctx->callbacks.checksum_hook(
                       _rel_to_abs(ctx, fs->path), base._checksumHeader,
@@ -289,7 +440,11 @@ static int _csync_detect_update(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> f
       }
   } else {
       /* check if it's a file and has been renamed */
-      if (ctx->current == LOCAL_REPLICA) {
+      if (ctx->current == LOCAL_REPLICA && ctx->sync_mode == SyncMode::DownloadOnly) {
+          /* Local files that the db doesn't know are removed, renamed or not */
+          fs->instruction = CSYNC_INSTRUCTION_NEW;
+          goto out;
+      } else if (ctx->current == LOCAL_REPLICA) {
           qCInfo(lcUpdate, "Checking for rename based on inode # %" PRId64 "", (uint64_t) fs->inode);
 
           OCC::SyncJournalFileRecord base;
@@ -399,6 +554,14 @@ static int _csync_detect_update(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> f
                   return 1;
               }
           }
+          if (fs->instruction == CSYNC_INSTRUCTION_NEW
+              && fs->type == ItemTypeDirectory
+              && ctx->sync_mode == SyncMode::UploadOnly
+              && !ctx->local.files.findFile(fs->path)) {
+              /* Nothing is uploaded into it, don't list it. */
+              qCInfo(lcUpdate, "Upload only, skipping new remote directory %s", fs->path.constData());
+              return 1;
+          }
           goto out;
       }
   }
@@ -436,6 +599,13 @@ out:
     fs->child_modified = true;
   }
 
+  if (ctx->current == LOCAL_REPLICA && ctx->sync_mode == SyncMode::UploadOnly
+      && fs->instruction != CSYNC_INSTRUCTION_NONE
+      && fs->instruction != CSYNC_INSTRUCTION_IGNORE
+      && fs->instruction != CSYNC_INSTRUCTION_UPDATE_METADATA) {
+    _csync_record_local_change(ctx, *fs);
+  }
+
   // If conflict files are uploaded, they won't be marked as IGNORE / CSYNC_FILE_EXCLUDE_CONFLICT
   // but we still want them marked!
   if (ctx->upload_conflict_files) {
@@ -444,15 +614,33 @@ out:
       }
   }
 
-  ctx->current_fs = fs.get();
-
   qCInfo(lcUpdate, "file: %s, instruction: %s <<=", fs->path.constData(),
       csync_instruction_str(fs->instruction));
 
+  if (_csync_should_spill(ctx, *fs)) {
+      if (!_csync_spill_local(ctx, *fs)) {
+          ctx->status_code = CSYNC_STATUS_UNSUCCESSFUL;
+          return -1;
+      }
+      return 0;
+  }
+  if (ctx->current == REMOTE_REPLICA) {
+      bool drop = false;
+      if (!_csync_match_spilled(ctx, *fs, &drop)) {
+          ctx->status_code = CSYNC_STATUS_UNSUCCESSFUL;
+          return -1;
+      }
+      if (drop) {
+          return 0;
+      }
+  }
+
+  ctx->current_fs = fs.get();
+
   QByteArray path = fs->path;
   switch (ctx->current) {
     case LOCAL_REPLICA:
-      ctx->local.files[path] = std::move(fs);
+      _csync_store_local(ctx, std::move(fs));
       break;
     case REMOTE_REPLICA:
       ctx->remote.files[path] = std::move(fs);
@@ -501,12 +689,33 @@ int csync_walker(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> fs) {
   return rc;
 }
 
+/* Whether the path is inside the sync scope or one of its parent directories */
+static bool _csync_is_in_sync_scope(CSYNC *ctx, const QByteArray &path)
+{
+    if (ctx->sync_scope.empty() || _csync_is_in_dirs(ctx->sync_scope, path)) {
+        return true;
+    }
+    const QByteArray prefix = path + '/';
+    auto it = ctx->sync_scope.lower_bound(prefix);
+    return it != ctx->sync_scope.end() && it->startsWith(prefix);
+}
+
 static bool fill_tree_from_db(CSYNC *ctx, const char *uri)
 {
     int64_t count = 0;
     QByteArray skipbase;
-    auto &files = ctx->current == LOCAL_REPLICA ? ctx->local.files : ctx->remote.files;
-    auto rowCallback = [ctx, &count, &skipbase, &files](const OCC::SyncJournalFileRecord &rec) {
+    QByteArray cleanbase;
+    bool spillOk = true;
+    /* The remote side leaves out the contents of deferred local directories,
+     * the deferred local side those of the directories the remote left out. */
+    const std::set<QByteArray> &cleanDirs =
+        ctx->current == REMOTE_REPLICA ? ctx->local_deferred_dirs : ctx->clean_subtrees;
+    auto rowCallback = [ctx, &cleanDirs, &count, &skipbase, &cleanbase, &spillOk](const OCC::SyncJournalFileRecord &rec) {
+        if (!cleanbase.isEmpty() && rec._path.startsWith(cleanbase)) {
+            return;
+        }
+        cleanbase.clear();
+
         if (ctx->current == REMOTE_REPLICA) {
             /* When selective sync is used, the database may have subtrees with a parent
              * whose etag is _invalid_. These are ignored and shall not appear in the
@@ -551,12 +760,32 @@ static bool fill_tree_from_db(CSYNC *ctx, const char *uri)
             st->instruction = CSYNC_INSTRUCTION_IGNORE;
         }
 
-        /* store into result list. */
-        files[rec._path] = std::move(st);
         ++count;
+
+        if (st->type == ItemTypeDirectory && cleanDirs.count(rec._path)) {
+            if (ctx->current == REMOTE_REPLICA) {
+                ctx->clean_subtrees.insert(rec._path);
+            }
+            cleanbase = rec._path;
+            cleanbase += '/';
+        }
+
+        /* store into result list. */
+        if (ctx->current == LOCAL_REPLICA) {
+            /* Only deferred directories get here, after the remote discovery.
+             * What is left after skipping the clean subtrees is needed by the
+             * reconciler, so there's no point in spilling it. */
+            _csync_store_local(ctx, std::move(st));
+        } else {
+            bool drop = false;
+            spillOk = spillOk && _csync_match_spilled(ctx, *st, &drop);
+            if (!drop) {
+                ctx->remote.files[rec._path] = std::move(st);
+            }
+        }
     };
 
-    if (!ctx->statedb->getFilesBelowPath(uri, rowCallback)) {
+    if (!ctx->statedb->getFilesBelowPath(uri, rowCallback) || !spillOk) {
         ctx->status_code = CSYNC_STATUS_STATEDB_LOAD_ERROR;
         return false;
     }
@@ -565,6 +794,50 @@ static bool fill_tree_from_db(CSYNC *ctx, const char *uri)
     return true;
 }
 
+int csync_unspill_unmatched(CSYNC *ctx)
+{
+    if (ctx->spilled_files == ctx->spilled_files_matched) {
+        return 0;
+    }
+
+    int64_t count = 0;
+    auto rowCallback = [ctx, &count](const OCC::SyncJournalFileRecord &rec) {
+        _csync_store_local(ctx, csync_file_stat_t::fromSyncJournalFileRecord(rec));
+        ++count;
+    };
+    if (!ctx->statedb->takeUnmatchedSpilledDiscoveryRecords(rowCallback)) {
+        ctx->status_code = CSYNC_STATUS_STATEDB_LOAD_ERROR;
+        return -1;
+    }
+    ctx->spilled_files = ctx->spilled_files_matched;
+    qCInfo(lcUpdate, "%" PRId64 " spilled local entries without unchanged remote counterpart, %" PRId64 " stay spilled",
+        count, ctx->spilled_files_matched);
+    return 0;
+}
+
+int csync_load_deferred_local(CSYNC *ctx)
+{
+    if (ctx->local_deferred_dirs.empty()) {
+        return 0;
+    }
+
+    const auto current = ctx->current;
+    ctx->current = LOCAL_REPLICA;
+    for (const auto &dir : ctx->local_deferred_dirs) {
+        if (_csync_is_in_dirs(ctx->clean_subtrees, dir)) {
+            continue;
+        }
+        if (!fill_tree_from_db(ctx, dir.constData())) {
+            ctx->current = current;
+            return -1;
+        }
+    }
+    ctx->current = current;
+
+    qCInfo(lcUpdate, "%zu unchanged subtrees were left out of both trees", ctx->clean_subtrees.size());
+    return 0;
+}
+
 /* set the current item to an ignored state.
  * If the item is set to ignored, the update phase continues, ie. its not a hard error */
 static bool mark_current_item_ignored( CSYNC *ctx, csync_file_stat_t *previous_fs, CSYNC_STATUS status )
@@ -616,6 +889,17 @@ int csync_ftw(CSYNC *ctx, const char *uri, csync_walker_fn fn,
 
   // if the etag of this dir is still the same, its content is restored from the
   // database.
+  if (do_read_from_db && ctx->current == LOCAL_REPLICA) {
+      // Loaded after the remote discovery, unless the remote side turns out
+      // to be unchanged as well.
+      ctx->local_deferred_dirs.insert(QByteArray(db_uri));
+      return 0;
+  }
+  if (do_read_from_db && _csync_is_in_dirs(ctx->local_deferred_dirs, QByteArray(db_uri))) {
+      qCDebug(lcUpdate, "%s is unchanged on both sides", db_uri);
+      ctx->clean_subtrees.insert(QByteArray(db_uri));
+      return 0;
+  }
   if( do_read_from_db ) {
       if(!fill_tree_from_db(ctx, db_uri)) {
         errno = ENOENT;
@@ -667,6 +951,7 @@ int csync_ftw(CSYNC *ctx, const char *uri, csync_walker_fn fn,
       }
       goto error;
   }
+  OC_TRACE(dir_opened, ctx->current == LOCAL_REPLICA ? 'l' : 'r', uri);
 
   while (true) {
     // Get the next item in the directory
@@ -728,6 +1013,11 @@ int csync_ftw(CSYNC *ctx, const char *uri, csync_walker_fn fn,
         dirent->path = dirent->path.mid(OCC::Utility::convertSizeToInt(uriLength) + 1);
     }
 
+    /* Left out of both trees, nothing happens to it in this sync */
+    if (!_csync_is_in_sync_scope(ctx, dirent->path)) {
+        continue;
+    }
+
     previous_fs = ctx->current_fs;
     bool recurse = dirent->type == ItemTypeDirectory;
 
@@ -777,6 +1067,7 @@ int csync_ftw(CSYNC *ctx, const char *uri, csync_walker_fn fn,
   }
 
   csync_vio_closedir(ctx, dh);
+  OC_TRACE(dir_finished, ctx->current == LOCAL_REPLICA ? 'l' : 'r', uri, rc);
   qCInfo(lcUpdate, " <= Closing walk for %s with read_from_db %d", uri, read_from_db);
 
   return rc;
@@ -785,6 +1076,7 @@ error:
   ctx->remote.read_from_db = read_from_db;
   if (dh) {
     csync_vio_closedir(ctx, dh);
+    OC_TRACE(dir_finished, ctx->current == LOCAL_REPLICA ? 'l' : 'r', uri, -1);
   }
   return -1;
 }
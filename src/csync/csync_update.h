@@ -77,6 +77,30 @@ int csync_walker(CSYNC *ctx, std::unique_ptr<csync_file_stat_t> fs);
 int csync_ftw(CSYNC *ctx, const char *uri, csync_walker_fn fn,
     unsigned int depth);
 
+/**
+ * @brief Take the spilled local files back into the local tree.
+ *
+ * Called after the remote discovery: spilled local files that were not matched
+ * by an unchanged remote file are needed by the reconciler.
+ *
+ * @param  ctx          The csync context to use.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+int csync_unspill_unmatched(CSYNC *ctx);
+
+/**
+ * @brief Load the local directories that were deferred during local discovery.
+ *
+ * Called after the remote discovery: subtrees whose remote side was read from
+ * the database as well are unchanged on both sides and stay unloaded.
+ *
+ * @param  ctx          The csync context to use.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+int csync_load_deferred_local(CSYNC *ctx);
+
 #endif /* _CSYNC_UPDATE_H */
 
 /* vim: set ft=c.doxygen ts=8 sw=2 et cindent: */
@@ -160,6 +160,60 @@ static const char short_months[12][4] = {
     "Jan", "Feb", "Mar", "Apr", "May", "Jun",
     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
 };
+static bool _csync_parse_digits(const char *p, int count, int *result)
+{
+    int value = 0;
+    for (int i = 0; i < count; ++i) {
+        if (p[i] < '0' || p[i] > '9')
+            return false;
+        value = value * 10 + (p[i] - '0');
+    }
+    *result = value;
+    return true;
+}
+
+/* Days since 1970-01-01 of a date in the proleptic Gregorian calendar.
+ * month is 1-12. See http://howardhinnant.github.io/date_algorithms.html */
+static int64_t _csync_days_from_civil(int64_t year, int month, int day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yoe = year - era * 400;
+    const int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/*
+ * Parses the fixed width form "Sun, 06 Nov 1994 08:49:37 GMT" without
+ * sscanf and timegm. Anything unusual is left to the generic code.
+ */
+static bool _csync_httpdate_parse_fast(const char *date, time_t *result)
+{
+    if (strlen(date) != 29 || date[3] != ',' || date[4] != ' ' || date[7] != ' '
+        || date[11] != ' ' || date[16] != ' ' || date[19] != ':' || date[22] != ':'
+        || strcmp(date + 25, " GMT") != 0) {
+        return false;
+    }
+
+    int day = 0, year = 0, hour = 0, min = 0, sec = 0;
+    if (!_csync_parse_digits(date + 5, 2, &day) || !_csync_parse_digits(date + 12, 4, &year)
+        || !_csync_parse_digits(date + 17, 2, &hour) || !_csync_parse_digits(date + 20, 2, &min)
+        || !_csync_parse_digits(date + 23, 2, &sec)) {
+        return false;
+    }
+
+    int month = 0;
+    while (month < 12 && strncmp(date + 8, short_months[month], 3) != 0)
+        ++month;
+    if (month == 12 || day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60)
+        return false;
+
+    *result = static_cast<time_t>(_csync_days_from_civil(year, month + 1, day) * 86400
+        + hour * 3600 + min * 60 + sec);
+    return true;
+}
+
 /*
  * This function is borrowed from libneon's ne_httpdate_parse.
  * Unfortunately that one converts to local time but here UTC is
@@ -172,6 +226,9 @@ time_t oc_httpdate_parse( const char *date ) {
     int n = 0;
     time_t result = 0;
 
+    if (_csync_httpdate_parse_fast(date, &result))
+        return result;
+
     memset(&gmt, 0, sizeof(struct tm));
 
     /*  it goes: Sun, 06 Nov 1994 08:49:37 GMT */
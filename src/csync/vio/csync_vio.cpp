@@ -31,6 +31,7 @@
 #include "vio/csync_vio.h"
 #include "vio/csync_vio_local.h"
 #include "common/c_jhash.h"
+#include "common/iogovernor.h"
 
 csync_vio_handle_t *csync_vio_opendir(CSYNC *ctx, const char *name) {
   switch(ctx->current) {
@@ -42,6 +43,7 @@ csync_vio_handle_t *csync_vio_opendir(CSYNC *ctx, const char *name) {
 	if( ctx->callbacks.update_callback ) {
         ctx->callbacks.update_callback(/*local=*/true, name, ctx->callbacks.update_callback_userdata);
 	}
+      OCC::IoGovernor::instance()->acquire(0);
       return csync_vio_local_opendir(name);
       break;
     default:
@@ -81,6 +83,8 @@ std::unique_ptr<csync_file_stat_t> csync_vio_readdir(CSYNC *ctx, csync_vio_handl
       return ctx->callbacks.remote_readdir_hook(dhandle, ctx->callbacks.vio_userdata);
       break;
     case LOCAL_REPLICA:
+      // One stat per entry, the directory reads themselves are batched
+      OCC::IoGovernor::instance()->acquire(0);
       return csync_vio_local_readdir(dhandle);
       break;
     default:
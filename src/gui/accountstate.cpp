@@ -36,6 +36,12 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcAccountState, "nextcloud.gui.account.state", QtInfoMsg)
 
+static const char capabilitiesC[] = "capabilities";
+static const char capabilitiesEtagC[] = "capabilitiesEtag";
+static const char davUserC[] = "davUser";
+static const char davDisplayNameC[] = "davDisplayName";
+static const char capabilitiesServerVersionC[] = "capabilitiesServerVersion";
+
 AccountState::AccountState(AccountPtr account)
     : QObject()
     , _account(account)
@@ -59,14 +65,48 @@ AccountState::AccountState(AccountPtr account)
 
 AccountState::~AccountState() = default;
 
-AccountState *AccountState::loadFromSettings(AccountPtr account, QSettings & /*settings*/)
+AccountState *AccountState::loadFromSettings(AccountPtr account, QSettings &settings)
 {
     auto accountState = new AccountState(account);
+
+    // Restore the last known good server state, see _savedServerState
+    const auto capabilities = QJsonDocument::fromJson(settings.value(QLatin1String(capabilitiesC)).toByteArray())
+                                  .object()
+                                  .toVariantMap();
+    if (!capabilities.isEmpty()) {
+        account->setCapabilities(capabilities);
+        const QString davUser = settings.value(QLatin1String(davUserC)).toString();
+        if (!davUser.isEmpty())
+            account->setDavUser(davUser);
+        account->setDavDisplayName(settings.value(QLatin1String(davDisplayNameC)).toString());
+
+        accountState->_capabilitiesEtagResponseHeader = settings.value(QLatin1String(capabilitiesEtagC)).toByteArray();
+
+        auto &saved = accountState->_savedServerState;
+        saved = accountState->currentServerState();
+        saved.davUser = davUser;
+        // Older snapshots rely on the server version saved with the account
+        const QString serverVersion = settings.value(QLatin1String(capabilitiesServerVersionC)).toString();
+        if (!serverVersion.isEmpty())
+            saved.serverVersion = serverVersion;
+        accountState->_useSavedServerState = true;
+    }
     return accountState;
 }
 
-void AccountState::writeToSettings(QSettings & /*settings*/)
+void AccountState::writeToSettings(QSettings &settings)
 {
+    if (!_account->capabilities().isValid()) {
+        return;
+    }
+    const auto state = currentServerState();
+    settings.setValue(QLatin1String(capabilitiesC),
+        QJsonDocument::fromVariant(state.capabilities).toJson(QJsonDocument::Compact));
+    settings.setValue(QLatin1String(capabilitiesEtagC), state.capabilitiesEtag);
+    settings.setValue(QLatin1String(capabilitiesServerVersionC), state.serverVersion);
+    settings.setValue(QLatin1String(davUserC), state.davUser);
+    settings.setValue(QLatin1String(davDisplayNameC), state.davDisplayName);
+    _savedServerState = state;
 }
 
 AccountPtr AccountState::account() const
@@ -102,6 +142,10 @@ void AccountState::setState(State state)
         State oldState = _state;
         _state = state;
 
+        // Traffic from before the state change doesn't prove anything about
+        // the new state, the next connection check has to do the full cycle.
+        _timeSinceLastETagCheck.invalidate();
+
         if (_state == SignedOut) {
             _connectionStatus = ConnectionValidator::Undefined;
             _connectionErrors.clear();
@@ -204,6 +248,16 @@ void AccountState::setNavigationAppsEtagResponseHeader(const QByteArray &value)
     _navigationAppsEtagResponseHeader = value;
 }
 
+QByteArray AccountState::capabilitiesEtagResponseHeader() const
+{
+    return _capabilitiesEtagResponseHeader;
+}
+
+void AccountState::setCapabilitiesEtagResponseHeader(const QByteArray &value)
+{
+    _capabilitiesEtagResponseHeader = value;
+}
+
 void AccountState::checkConnectivity()
 {
     if (isSignedOut() || _waitingForNewCredentials) {
@@ -227,10 +281,11 @@ void AccountState::checkConnectivity()
     // if the last successful etag check job is not so long ago.
     ConfigFile cfg;
     std::chrono::milliseconds polltime = cfg.remotePollInterval();
+    const qint64 skipWindow = qMax<qint64>(polltime.count(), ConnectionValidator::DefaultCallingIntervalMsec);
 
     if (isConnected() && _timeSinceLastETagCheck.isValid()
-        && _timeSinceLastETagCheck.hasExpired(polltime.count())) {
-        qCDebug(lcAccountState) << account()->displayName() << "The last ETag check succeeded within the last " << polltime.count() / 1000 << " secs. No connection check needed!";
+        && !_timeSinceLastETagCheck.hasExpired(skipWindow)) {
+        qCDebug(lcAccountState) << account()->displayName() << "The last ETag check succeeded within the last " << skipWindow / 1000 << " secs. No connection check needed!";
         return;
     }
 
@@ -261,12 +316,30 @@ void AccountState::checkConnectivity()
         // ssl config that does not have a sensible certificate chain.
         account()->setSslConfiguration(QSslConfiguration());
         //#endif
+
+        // Don't wait for the validation on startup, go on with the last
+        // known good server state and roll back if the validation disagrees
+        if (_useSavedServerState && account()->credentials()->ready()) {
+            qCInfo(lcAccountState) << account()->displayName() << "Connecting with the last known server state, validating it in the background";
+            _optimisticallyConnected = true;
+            setState(Connected);
+        }
         conValidator->checkServerAndAuth();
     }
 }
 
 void AccountState::slotConnectionValidatorResult(ConnectionValidator::Status status, const QStringList &errors)
 {
+    // The saved server state is only used for the first connection attempt
+    const bool wasOptimistic = _optimisticallyConnected;
+    const bool serverStateChanged = wasOptimistic && status == ConnectionValidator::Connected
+        && syncRelevantServerStateChanged();
+    _optimisticallyConnected = false;
+    _useSavedServerState = false;
+    if (wasOptimistic && status != ConnectionValidator::Connected) {
+        qCInfo(lcAccountState) << "The last known server state could not be validated:" << status;
+    }
+
     if (isSignedOut()) {
         qCWarning(lcAccountState) << "Signed out, ignoring" << status << _account->url().toString();
         return;
@@ -299,12 +372,20 @@ void AccountState::slotConnectionValidatorResult(ConnectionValidator::Status sta
 
     switch (status) {
     case ConnectionValidator::Connected:
-        if (_state != Connected) {
+        if (serverStateChanged) {
+            // Syncs that were started with the snapshot may rely on outdated capabilities
+            qCInfo(lcAccountState) << "The server state changed since the last start, restarting the syncs";
+            setState(Disconnected);
+        }
+        if (_state != Connected || wasOptimistic) {
             setState(Connected);
 
             // Get the Apps available on the server.
             fetchNavigationApps();
         }
+
+        // Remember the validated server state for the next start
+        saveServerStateIfChanged();
         break;
     case ConnectionValidator::Undefined:
     case ConnectionValidator::NotConfigured:
@@ -340,6 +421,52 @@ void AccountState::slotConnectionValidatorResult(ConnectionValidator::Status sta
     }
 }
 
+AccountState::ServerState AccountState::currentServerState() const
+{
+    ServerState state;
+    state.serverVersion = _account->serverVersion();
+    state.capabilities = _account->capabilities().toVariantMap();
+    state.capabilitiesEtag = _capabilitiesEtagResponseHeader;
+    state.davUser = _account->davUser();
+    state.davDisplayName = _account->davDisplayName();
+    return state;
+}
+
+bool AccountState::syncRelevantServerStateChanged() const
+{
+    if (_account->serverVersion() != _savedServerState.serverVersion) {
+        return true;
+    }
+    if (!_savedServerState.davUser.isEmpty() && _account->davUser() != _savedServerState.davUser) {
+        return true;
+    }
+
+    // Only compare what the sync engine and the propagator look at, changes
+    // in e.g. the sharing or notification capabilities don't need a restart
+    const Capabilities saved(_savedServerState.capabilities);
+    const Capabilities &current = _account->capabilities();
+    return saved.chunkingNg() != current.chunkingNg()
+        || saved.chunkingParallelUploadDisabled() != current.chunkingParallelUploadDisabled()
+        || saved.supportedChecksumTypes() != current.supportedChecksumTypes()
+        || saved.preferredUploadChecksumType() != current.preferredUploadChecksumType()
+        || saved.uploadConflictFiles() != current.uploadConflictFiles()
+        || saved.invalidFilenameRegex() != current.invalidFilenameRegex()
+        || saved.httpErrorCodesThatResetFailingChunkedUploads() != current.httpErrorCodesThatResetFailingChunkedUploads()
+        || saved.clientSideEncryptionAvaliable() != current.clientSideEncryptionAvaliable();
+}
+
+void AccountState::saveServerStateIfChanged()
+{
+    if (!_account->capabilities().isValid() || currentServerState() == _savedServerState) {
+        return;
+    }
+    // Accounts that are still being set up are saved once they are added
+    if (AccountManager::instance()->account(_account->displayName()).data() != this) {
+        return;
+    }
+    AccountManager::instance()->saveAccountState(this);
+}
+
 void AccountState::slotHandleRemoteWipeCheck()
 {
     // make sure it changes account state and icons
@@ -19,6 +19,7 @@
 #include <QByteArray>
 #include <QElapsedTimer>
 #include <QPointer>
+#include <QVariantMap>
 #include "connectionvalidator.h"
 #include "creds/abstractcredentials.h"
 #include <memory>
@@ -89,7 +90,8 @@ public:
 
     /** Writes account state information to settings.
      *
-     * It does not write the Account data.
+     * It does not write the Account data, except for the last known
+     * capabilities and user info that are restored by loadFromSettings().
      */
     void writeToSettings(QSettings &settings);
 
@@ -158,6 +160,16 @@ public:
     */
     void setNavigationAppsEtagResponseHeader(const QByteArray &value);
 
+    /** Returns the ETag Response header from the last capabilities
+     * request with statusCode 100.
+    */
+    QByteArray capabilitiesEtagResponseHeader() const;
+
+    /** Saves the ETag Response header from the last capabilities
+     * request with statusCode 100.
+    */
+    void setCapabilitiesEtagResponseHeader(const QByteArray &value);
+
     ///Asks for user credentials
     void handleInvalidCredentials();
 
@@ -170,6 +182,33 @@ private:
     void setState(State state);
     void fetchNavigationApps();
 
+    /// The server state that writeToSettings() persists for the next start
+    struct ServerState
+    {
+        QString serverVersion;
+        QVariantMap capabilities;
+        QByteArray capabilitiesEtag;
+        QString davUser;
+        QString davDisplayName;
+
+        bool operator==(const ServerState &other) const
+        {
+            return serverVersion == other.serverVersion
+                && capabilities == other.capabilities
+                && capabilitiesEtag == other.capabilitiesEtag
+                && davUser == other.davUser
+                && davDisplayName == other.davDisplayName;
+        }
+        bool operator!=(const ServerState &other) const { return !(*this == other); }
+    };
+    ServerState currentServerState() const;
+
+    /// Whether the validated server state differs from the saved one in a way that affects syncs
+    bool syncRelevantServerStateChanged() const;
+
+    /// Saves the server state of registered accounts, if it differs from the saved one
+    void saveServerStateIfChanged();
+
 signals:
     void stateChanged(int state);
     void isConnectedChanged();
@@ -200,6 +239,20 @@ private:
     QPointer<ConnectionValidator> _connectionValidator;
     QByteArray _notificationsEtagResponseHeader;
     QByteArray _navigationAppsEtagResponseHeader;
+    QByteArray _capabilitiesEtagResponseHeader;
+
+    /**
+     * The last known good server state, as restored from or written to the settings.
+     *
+     * With it, the first connection attempt after startup goes to Connected
+     * right away and the ConnectionValidator runs in the background. If it
+     * fails or finds a server state that matters to the syncs, the account
+     * leaves the Connected state again, which terminates the syncs that were
+     * started.
+     */
+    ServerState _savedServerState;
+    bool _useSavedServerState = false;
+    bool _optimisticallyConnected = false;
 
     /**
      * Starts counting when the server starts being back up after 503 or
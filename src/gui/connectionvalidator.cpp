@@ -225,6 +225,12 @@ void ConnectionValidator::checkServerCapabilities()
     // The main flow now needs the capabilities
     auto *job = new JsonApiJob(_account, QLatin1String("ocs/v1.php/cloud/capabilities"), this);
     job->setTimeout(timeoutToUseMsec);
+    // Only ask for the full capabilities when they changed since the last time
+    const QByteArray capabilitiesEtag = _accountState->capabilitiesEtagResponseHeader();
+    if (_account->capabilities().isValid() && !capabilitiesEtag.isEmpty()) {
+        job->addRawHeader("If-None-Match", capabilitiesEtag);
+    }
+    QObject::connect(job, &JsonApiJob::etagResponseHeaderReceived, this, &ConnectionValidator::slotCapabilitiesEtagReceived);
     QObject::connect(job, &JsonApiJob::jsonReceived, this, &ConnectionValidator::slotCapabilitiesRecieved);
     job->start();
 
@@ -240,12 +246,29 @@ void ConnectionValidator::checkServerCapabilities()
     configJob->start();
 }
 
-void ConnectionValidator::slotCapabilitiesRecieved(const QJsonDocument &json)
+void ConnectionValidator::slotCapabilitiesEtagReceived(const QByteArray &value, int statusCode)
+{
+    if (statusCode == 100 || statusCode == 200) {
+        _accountState->setCapabilitiesEtagResponseHeader(value);
+    }
+}
+
+void ConnectionValidator::slotCapabilitiesRecieved(const QJsonDocument &json, int statusCode)
 {
+    if (statusCode == 304 && _account->capabilities().isValid()) {
+        qCInfo(lcConnectionValidator) << "Server capabilities not modified";
+        applyCapabilities(QJsonObject::fromVariantMap(_account->capabilities().toVariantMap()));
+        return;
+    }
+
     auto caps = json.object().value("ocs").toObject().value("data").toObject().value("capabilities").toObject();
     qCInfo(lcConnectionValidator) << "Server capabilities" << caps;
     _account->setCapabilities(caps.toVariantMap());
+    applyCapabilities(caps);
+}
 
+void ConnectionValidator::applyCapabilities(const QJsonObject &caps)
+{
     // New servers also report the version in the capabilities
     QString serverVersion = caps["core"].toObject()["status"].toObject()["version"].toString();
     if (!serverVersion.isEmpty() && !setAndCheckServerVersion(serverVersion)) {
@@ -61,7 +61,8 @@ namespace OCC {
   |
   +-> checkServerCapabilities --------------v (in parallel)
         JsonApiJob (cloud/capabilities)     JsonApiJob (ocs/v1.php/config)
-        |                                   +-> ocsConfigReceived
+        |  (If-None-Match, 304 keeps the    +-> ocsConfigReceived
+        |   current capabilities)
         +-> slotCapabilitiesRecieved -+
                                       |
     +---------------------------------+
@@ -121,7 +122,8 @@ protected slots:
     void slotAuthFailed(QNetworkReply *reply);
     void slotAuthSuccess();
 
-    void slotCapabilitiesRecieved(const QJsonDocument &);
+    void slotCapabilitiesEtagReceived(const QByteArray &value, int statusCode);
+    void slotCapabilitiesRecieved(const QJsonDocument &json, int statusCode);
     void slotUserFetched(UserInfo *userInfo);
 
 private:
@@ -130,6 +132,13 @@ private:
 #endif
     void reportResult(Status status);
     void checkServerCapabilities();
+
+    /** Applies what the capabilities say about the server and continues with the user
+     *
+     * Used for new capabilities as well as for the cached ones when the server
+     * reported them as not modified.
+     */
+    void applyCapabilities(const QJsonObject &caps);
     void fetchUser();
     static void ocsConfigReceived(const QJsonDocument &json, AccountPtr account);
 
@@ -69,7 +69,7 @@ void HttpCredentialsGui::askFromUserAsync()
 }
 
 void HttpCredentialsGui::asyncAuthResult(OAuth::Result r, const QString &user,
-    const QString &token, const QString &refreshToken)
+    const QString &token, const QString &refreshToken, int expiresIn)
 {
     switch (r) {
     case OAuth::NotSupported:
@@ -90,6 +90,7 @@ void HttpCredentialsGui::asyncAuthResult(OAuth::Result r, const QString &user,
     _password = token;
     _refreshToken = refreshToken;
     _ready = true;
+    scheduleTokenRefresh(expiresIn);
     persist();
     _asyncAuth.reset(nullptr);
     emit asked();
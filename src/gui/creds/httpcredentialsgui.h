@@ -38,10 +38,11 @@ public:
     {
     }
     HttpCredentialsGui(const QString &user, const QString &password, const QString &refreshToken,
-        const QSslCertificate &certificate, const QSslKey &key)
+        int expiresIn, const QSslCertificate &certificate, const QSslKey &key)
         : HttpCredentials(user, password, certificate, key)
     {
         _refreshToken = refreshToken;
+        scheduleTokenRefresh(expiresIn);
     }
 
     /**
@@ -58,7 +59,7 @@ public:
 
     static QString requestAppPasswordText(const Account *account);
 private slots:
-    void asyncAuthResult(OAuth::Result, const QString &user, const QString &accessToken, const QString &refreshToken);
+    void asyncAuthResult(OAuth::Result, const QString &user, const QString &accessToken, const QString &refreshToken, int expiresIn);
     void showDialog();
     void askFromUserAsync();
 
@@ -143,7 +143,7 @@ void OAuth::start()
                     } else {
                         httpReplyAndClose(socket, "200 OK", loginSuccessfullHtml);
                     }
-                    emit result(LoggedIn, user, accessToken, refreshToken);
+                    emit result(LoggedIn, user, accessToken, refreshToken, json["expires_in"].toInt());
                 });
             });
         }
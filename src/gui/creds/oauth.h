@@ -60,9 +60,10 @@ public:
 signals:
     /**
      * The state has changed.
-     * when logged in, token has the value of the token.
+     * when logged in, token has the value of the token and expiresIn its
+     * lifetime in seconds, or 0 if the server didn't say.
      */
-    void result(OAuth::Result result, const QString &user = QString(), const QString &token = QString(), const QString &refreshToken = QString());
+    void result(OAuth::Result result, const QString &user = QString(), const QString &token = QString(), const QString &refreshToken = QString(), int expiresIn = 0);
 
 private:
     Account *_account;
@@ -81,6 +81,13 @@ Folder::Folder(const FolderDefinition &definition,
     if (!reloadExcludes())
         qCWarning(lcFolder, "Could not read system exclude file");
 
+    // Opening the journal runs the integrity and schema checks. Do that on a
+    // worker thread so setting up many folders doesn't block the UI, whoever
+    // uses the journal first just waits on its mutex.
+    if (_syncResult.status() != SyncResult::SetupError) {
+        _journalOpenFuture = std::async(std::launch::async, [this] { _journal.isConnected(); });
+    }
+
     connect(_accountState.data(), &AccountState::isConnectedChanged, this, &Folder::canSyncChanged);
     connect(_engine.data(), &SyncEngine::rootEtag, this, &Folder::etagRetreivedFromSyncEngine);
 
@@ -114,6 +121,9 @@ Folder::Folder(const FolderDefinition &definition,
 
 Folder::~Folder()
 {
+    if (_journalOpenFuture.valid())
+        _journalOpenFuture.wait();
+
     // Reset then engine first as it will abort and try to access members of the Folder
     _engine.reset();
 }
@@ -317,6 +327,7 @@ void Folder::etagRetreivedFromSyncEngine(const QString &etag)
     qCInfo(lcFolder) << "Root etag from during sync:" << etag;
     accountState()->tagLastSuccessfullETagRequest();
     _lastEtag = etag;
+    _syncRootEtag = etag;
 }
 
 
@@ -622,8 +633,6 @@ bool Folder::reloadExcludes()
 
 void Folder::startSync(const QStringList &pathList)
 {
-    Q_UNUSED(pathList)
-
     if (isBusy()) {
         qCCritical(lcFolder) << "ERROR csync is still running and new sync requested.";
         return;
@@ -660,7 +669,17 @@ void Folder::startSync(const QStringList &pathList)
     bool periodicFullLocalDiscoveryNow =
         fullLocalDiscoveryInterval.count() >= 0 // negative means we don't require periodic full runs
         && _timeSinceLastFullLocalDiscovery.hasExpired(fullLocalDiscoveryInterval.count());
-    if (_folderWatcher && _folderWatcher->isReliable()
+    if (!pathList.isEmpty()) {
+        // The scope is discovered completely. The local discovery paths are
+        // kept for the next full sync, which still has to look at them.
+        std::set<QByteArray> scope;
+        for (const auto &path : pathList)
+            scope.insert(path.toUtf8());
+        qCInfo(lcFolder) << "Only syncing" << pathList;
+        _engine->setSyncScope(std::move(scope));
+        _engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::FilesystemOnly);
+        _previousLocalDiscoveryPaths.clear();
+    } else if (_folderWatcher && _folderWatcher->isReliable()
         && hasDoneFullLocalDiscovery
         && !periodicFullLocalDiscoveryNow) {
         qCInfo(lcFolder) << "Allowing local discovery to read from the database";
@@ -674,12 +693,13 @@ void Folder::startSync(const QStringList &pathList)
         }
 
         _previousLocalDiscoveryPaths = std::move(_localDiscoveryPaths);
+        _localDiscoveryPaths.clear();
     } else {
         qCInfo(lcFolder) << "Forbidding local discovery to read from the database";
         _engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::FilesystemOnly);
         _previousLocalDiscoveryPaths.clear();
+        _localDiscoveryPaths.clear();
     }
-    _localDiscoveryPaths.clear();
 
     _engine->setIgnoreHiddenFiles(_definition.ignoreHiddenFiles);
 
@@ -731,6 +751,13 @@ void Folder::setSyncOptions()
         opt._targetChunkUploadDuration = cfgFile.targetChunkUploadDuration();
     }
 
+    QByteArray discoveryMemoryBudgetEnv = qgetenv("OWNCLOUD_DISCOVERY_MEMORY_BUDGET");
+    if (!discoveryMemoryBudgetEnv.isEmpty()) {
+        opt._discoveryMemoryBudget = discoveryMemoryBudgetEnv.toLongLong();
+    } else {
+        opt._discoveryMemoryBudget = cfgFile.discoveryMemoryBudget();
+    }
+
     _engine->setSyncOptions(opt);
 }
 
@@ -810,21 +837,31 @@ void Folder::slotSyncFinished(bool success)
     if (_syncResult.status() == SyncResult::Success
         || _syncResult.status() == SyncResult::Problem) {
         _consecutiveFailingSyncs = 0;
+        // A sync that went through proves connectivity and auth just as well
+        // as an etag check does.
+        _accountState->tagLastSuccessfullETagRequest();
     } else {
         _consecutiveFailingSyncs++;
         qCInfo(lcFolder) << "the last" << _consecutiveFailingSyncs << "syncs failed";
     }
 
-    if (_syncResult.status() == SyncResult::Success && success) {
+    if (_engine->lastSyncWasScoped()) {
+        // Says nothing about the rest of the folder
+    } else if (_syncResult.status() == SyncResult::Success && success) {
         // Clear the white list as all the folders that should be on that list are sync-ed
         journalDb()->setSelectiveSyncList(SyncJournalDb::SelectiveSyncWhiteList, QStringList());
+        _lastSyncedRootEtag = _syncRootEtag;
+    } else {
+        _lastSyncedRootEtag.clear();
     }
+    _syncRootEtag.clear();
 
     // bug: This function uses many different criteria for "sync was successful" - investigate!
     if ((_syncResult.status() == SyncResult::Success
             || _syncResult.status() == SyncResult::Problem)
         && success) {
-        if (_engine->lastLocalDiscoveryStyle() == LocalDiscoveryStyle::FilesystemOnly) {
+        if (_engine->lastLocalDiscoveryStyle() == LocalDiscoveryStyle::FilesystemOnly
+            && !_engine->lastSyncWasScoped()) {
             _timeSinceLastFullLocalDiscovery.start();
         }
         qCDebug(lcFolder) << "Sync success, forgetting last sync's local discovery path list";
@@ -1111,6 +1148,7 @@ void Folder::slotAboutToRemoveAllFiles(SyncFileItem::Direction dir, bool *cancel
         FileSystem::setFolderMinimumPermissions(path());
         journalDb()->clearFileTable();
         _lastEtag.clear();
+        _lastSyncedRootEtag.clear();
         slotScheduleThisFolder();
     }
 }
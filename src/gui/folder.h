@@ -29,6 +29,7 @@
 #include <QUuid>
 #include <set>
 #include <chrono>
+#include <future>
 
 class QThread;
 class QSettings;
@@ -140,6 +141,12 @@ public:
      */
     QUrl remoteUrl() const;
 
+    /**
+     * The root etag the last successful sync ran against, empty if the
+     * journal isn't known to be up to date with the server.
+     */
+    QString lastSyncedRootEtag() const { return _lastSyncedRootEtag; }
+
     /**
      * switch sync on or off
      */
@@ -260,7 +267,8 @@ public slots:
     /**
       * Starts a sync operation
       *
-      * If the list of changed files is known, it is passed.
+      * If pathList is not empty, only these folder-relative paths are
+      * synced, see SyncEngine::setSyncScope().
       */
     void startSync(const QStringList &pathList = QStringList());
 
@@ -352,6 +360,8 @@ private:
     bool _csyncUnavail;
     QPointer<RequestEtagJob> _requestEtagJob;
     QString _lastEtag;
+    QString _syncRootEtag;
+    QString _lastSyncedRootEtag;
     QElapsedTimer _timeSinceLastSyncDone;
     QElapsedTimer _timeSinceLastSyncStart;
     QElapsedTimer _timeSinceLastFullLocalDiscovery;
@@ -367,6 +377,9 @@ private:
 
     SyncJournalDb _journal;
 
+    /// Opens _journal in the background, see the constructor
+    std::future<void> _journalOpenFuture;
+
     QScopedPointer<SyncRunFileLog> _fileLog;
 
     QTimer _scheduleSelfTimer;
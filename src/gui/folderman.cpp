@@ -137,6 +137,7 @@ int FolderMan::unloadAndDeleteAllFolders()
     _lastSyncFolder = nullptr;
     _currentSyncFolder = nullptr;
     _scheduledFolders.clear();
+    _scheduledSyncScopes.clear();
     emit folderListChanged(_folderMap);
     emit scheduleQueueChanged();
 
@@ -525,6 +526,7 @@ void FolderMan::scheduleFolder(Folder *f)
     auto alias = f->alias();
 
     qCInfo(lcFolderMan) << "Schedule folder " << alias << " to sync!";
+    _scheduledSyncScopes.remove(f);
 
     if (!_scheduledFolders.contains(f)) {
         if (!f->canSync()) {
@@ -547,6 +549,7 @@ void FolderMan::scheduleFolderNext(Folder *f)
 {
     auto alias = f->alias();
     qCInfo(lcFolderMan) << "Schedule folder " << alias << " to sync! Front-of-queue.";
+    _scheduledSyncScopes.remove(f);
 
     if (!f->canSync()) {
         qCInfo(lcFolderMan) << "Folder is not ready to sync, not scheduled!";
@@ -563,6 +566,22 @@ void FolderMan::scheduleFolderNext(Folder *f)
     startScheduledSyncSoon();
 }
 
+void FolderMan::scheduleFolderPaths(Folder *f, const QStringList &relativePaths)
+{
+    // A full sync covers the paths as well
+    if (_scheduledFolders.contains(f) && !_scheduledSyncScopes.contains(f)) {
+        qCInfo(lcFolderMan) << "Folder" << f->alias() << "is already scheduled to sync completely";
+        return;
+    }
+
+    QStringList scope = _scheduledSyncScopes.value(f) + relativePaths;
+    scheduleFolderNext(f);
+    if (_scheduledFolders.contains(f)) {
+        scope.removeDuplicates();
+        _scheduledSyncScopes.insert(f, scope);
+    }
+}
+
 void FolderMan::slotScheduleETagJob(const QString & /*alias*/, RequestEtagJob *job)
 {
     QObject::connect(job, &QObject::destroyed, this, &FolderMan::slotEtagJobDestroyed);
@@ -717,8 +736,10 @@ void FolderMan::slotStartScheduledFolderSync()
 
     // Find the first folder in the queue that can be synced.
     Folder *folder = nullptr;
+    QStringList syncScope;
     while (!_scheduledFolders.isEmpty()) {
         Folder *g = _scheduledFolders.dequeue();
+        syncScope = _scheduledSyncScopes.take(g);
         if (g->canSync()) {
             folder = g;
             break;
@@ -735,7 +756,7 @@ void FolderMan::slotStartScheduledFolderSync()
         registerFolderWithSocketApi(folder);
 
         _currentSyncFolder = folder;
-        folder->startSync(QStringList());
+        folder->startSync(syncScope);
     }
 }
 
@@ -1004,6 +1025,7 @@ void FolderMan::removeFolder(Folder *f)
         terminateSyncProcess();
     }
 
+    _scheduledSyncScopes.remove(f);
     if (_scheduledFolders.removeAll(f) > 0) {
         emit scheduleQueueChanged();
     }
@@ -1129,6 +1151,7 @@ void FolderMan::slotWipeFolderForAccount(AccountState *accountState)
             terminateSyncProcess();
         }
 
+        _scheduledSyncScopes.remove(f);
         if (_scheduledFolders.removeAll(f) > 0) {
             emit scheduleQueueChanged();
         }
@@ -19,6 +19,7 @@
 #include <QObject>
 #include <QQueue>
 #include <QList>
+#include <QHash>
 
 #include "folder.h"
 #include "folderwatcher.h"
@@ -176,6 +177,12 @@ public:
     /** Puts a folder in the very front of the queue. */
     void scheduleFolderNext(Folder *);
 
+    /**
+     * Puts a folder in the front of the queue to only sync the given
+     * folder-relative paths, unless a full sync of it is queued already.
+     */
+    void scheduleFolderPaths(Folder *, const QStringList &relativePaths);
+
     /** Queues all folders for syncing. */
     void scheduleAllFolders();
 
@@ -322,6 +329,9 @@ private:
     /// Scheduled folders that should be synced as soon as possible
     QQueue<Folder *> _scheduledFolders;
 
+    /// The paths scheduled folders are restricted to, see scheduleFolderPaths()
+    QHash<Folder *, QStringList> _scheduledSyncScopes;
+
     /// Picks the next scheduled folder and starts the sync
     QTimer _startScheduledSyncTimer;
 
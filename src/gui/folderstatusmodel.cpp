@@ -19,6 +19,7 @@
 #include <theme.h>
 #include <account.h>
 #include "folderstatusdelegate.h"
+#include "common/syncjournalfilerecord.h"
 
 #include <QFileIconProvider>
 #include <QVarLengthArray>
@@ -32,6 +33,7 @@ Q_LOGGING_CATEGORY(lcFolderStatus, "nextcloud.gui.folder.model", QtInfoMsg)
 
 static const char propertyParentIndexC[] = "oc_parentIndex";
 static const char propertyPermissionMap[] = "oc_permissionMap";
+static const char propertyJournalEtagC[] = "oc_journalEtag";
 
 static QString removeTrailingSlash(const QString &s)
 {
@@ -587,6 +589,9 @@ void FolderStatusModel::fetchMore(const QModelIndex &parent)
 			_accountState->account()->e2e()->fetchFolderEncryptedStatus();
 		}
 
+    if (fetchFromJournal(info, parent, path))
+        return;
+
     auto *job = new LsColJob(_accountState->account(), path, this);
     info->_fetchingJob = job;
     job->setProperties(QList<QByteArray>() << "resourcetype"
@@ -612,6 +617,102 @@ void FolderStatusModel::fetchMore(const QModelIndex &parent)
     QTimer::singleShot(1000, this, &FolderStatusModel::slotShowFetchProgress);
 }
 
+bool FolderStatusModel::fetchFromJournal(SubFolderInfo *info, const QModelIndex &parent, const QString &remotePath)
+{
+    // Blacklisted and undecided folders are not in the journal, neither
+    // are the blacklisted children of partially checked folders.
+    if (info->_journalOutdated || info->_checked != Qt::Checked || info->_isUndecided)
+        return false;
+
+    auto journal = info->_folder->journalDb();
+    const bool isRoot = info->_path == QLatin1String("/");
+    const QString dirPath = isRoot ? QString() : removeTrailingSlash(info->_path);
+
+    bool ok = true;
+    const auto undecidedList = journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncUndecidedList, &ok);
+    if (!ok)
+        return false;
+    for (const auto &undecided : undecidedList) {
+        if (isRoot || undecided.startsWith(info->_path))
+            return false;
+    }
+
+    // The root isn't in the journal, its etag is remembered by the folder
+    QByteArray journalEtag = Utility::normalizeEtag(info->_folder->lastSyncedRootEtag().toUtf8());
+    if (!isRoot) {
+        SyncJournalFileRecord rec;
+        if (!journal->getFileRecord(dirPath, &rec) || !rec.isValid() || rec._type != ItemTypeDirectory)
+            return false;
+        journalEtag = rec._etag;
+    }
+    if (journalEtag.isEmpty())
+        return false;
+
+    QHash<QString, SyncJournalFileRecord> records;
+    QStringList sortedSubfolders;
+    ok = journal->getSubdirectories(dirPath.toUtf8(), [&](const SyncJournalFileRecord &rec) {
+        const QString relativePath = QString::fromUtf8(rec._path) + QLatin1Char('/');
+        if (info->_folder->isFileExcludedRelative(relativePath))
+            return;
+        records.insert(relativePath, rec);
+        sortedSubfolders.append(relativePath);
+    });
+    if (!ok)
+        return false;
+    Utility::sortFilenames(sortedSubfolders);
+
+    QVector<SubFolderInfo> newSubs;
+    newSubs.reserve(sortedSubfolders.size());
+    for (const auto &relativePath : sortedSubfolders) {
+        const auto &rec = records[relativePath];
+        SubFolderInfo newInfo;
+        newInfo._folder = info->_folder;
+        newInfo._pathIdx = info->_pathIdx;
+        newInfo._pathIdx << newSubs.size();
+        newInfo._isExternal = rec._remotePerm.hasPermission(RemotePermissions::IsMounted);
+        newInfo._path = relativePath;
+        newInfo._name = removeTrailingSlash(relativePath).split('/').last();
+        newInfo._size = -1; // the journal stores directories with size 0, the real size is unknown
+        newInfo._fileId = rec._fileId;
+        newSubs.append(newInfo);
+    }
+
+    info->_fetched = true;
+    info->_fetchedFromJournal = true;
+    if (!newSubs.isEmpty()) {
+        beginInsertRows(parent, 0, newSubs.size() - 1);
+        info->_subs = std::move(newSubs);
+        endInsertRows();
+    }
+
+    // Only a single depth 0 PROPFIND to see whether the journal is still
+    // up to date, the full listing is requested only if it isn't.
+    auto *job = new RequestEtagJob(_accountState->account(), remotePath, this);
+    job->setProperty(propertyParentIndexC, QVariant::fromValue(QPersistentModelIndex(parent)));
+    job->setProperty(propertyJournalEtagC, journalEtag);
+    connect(job, &RequestEtagJob::etagRetreived, this, &FolderStatusModel::slotJournalEtagRevalidated);
+    job->start();
+    return true;
+}
+
+void FolderStatusModel::slotJournalEtagRevalidated(const QString &etag)
+{
+    auto job = sender();
+    QModelIndex idx = qvariant_cast<QPersistentModelIndex>(job->property(propertyParentIndexC));
+    auto info = infoForIndex(idx);
+    if (!info || !info->_fetchedFromJournal)
+        return;
+
+    const auto journalEtag = job->property(propertyJournalEtagC).toByteArray();
+    if (Utility::normalizeEtag(etag.toUtf8()) == journalEtag)
+        return;
+
+    qCInfo(lcFolderStatus) << "Journal listing of" << info->_path << "is outdated, fetching from the server";
+    info->resetSubs(this, idx);
+    info->_journalOutdated = true;
+    fetchMore(idx);
+}
+
 void FolderStatusModel::slotGatherPermissions(const QString &href, const QMap<QString, QString> &map)
 {
     auto it = map.find("permissions");
@@ -648,6 +749,7 @@ void FolderStatusModel::slotUpdateDirectories(const QStringList &list)
     parentInfo->_lastErrorString.clear();
     parentInfo->_fetchingJob = nullptr;
     parentInfo->_fetched = true;
+    parentInfo->_journalOutdated = false;
 
     QUrl url = parentInfo->_folder->remoteUrl();
     QString pathToRemove = url.path();
@@ -1261,6 +1363,7 @@ bool FolderStatusModel::SubFolderInfo::hasLabel() const
 void FolderStatusModel::SubFolderInfo::resetSubs(FolderStatusModel *model, QModelIndex index)
 {
     _fetched = false;
+    _fetchedFromJournal = false;
     delete _fetchingJob;
     if (hasLabel()) {
         model->beginRemoveRows(index, 0, 0);
@@ -67,6 +67,8 @@ public:
         bool _isExternal = false;
 
         bool _fetched = false; // If we did the LSCOL for this folder already
+        bool _fetchedFromJournal = false; // If _subs were listed from the journal, not the server
+        bool _journalOutdated = false; // The server etag differs, list from the server next time
         QPointer<LsColJob> _fetchingJob; // Currently running LsColJob
         bool _hasError = false; // If the last fetching job ended in an error
         QString _lastErrorString;
@@ -127,6 +129,7 @@ private slots:
     void slotUpdateDirectories(const QStringList &);
     void slotGatherPermissions(const QString &name, const QMap<QString, QString> &properties);
     void slotLscolFinishedWithError(QNetworkReply *r);
+    void slotJournalEtagRevalidated(const QString &etag);
     void slotFolderSyncStateChange(Folder *f);
     void slotFolderScheduleQueueChanged();
     void slotNewBigFolder();
@@ -140,6 +143,16 @@ private slots:
 private:
     QStringList createBlackList(OCC::FolderStatusModel::SubFolderInfo *root,
         const QStringList &oldBlackList) const;
+
+    /**
+     * Lists the subfolders of a fully synced folder from the journal.
+     *
+     * Returns false if the journal can't be trusted for this folder, the
+     * caller then lists it from the server. Otherwise the stored etag is
+     * revalidated in the background and the folder is listed again from
+     * the server only if it changed.
+     */
+    bool fetchFromJournal(SubFolderInfo *info, const QModelIndex &parent, const QString &remotePath);
     const AccountState *_accountState = nullptr;
     bool _dirty = false; // If the selective sync checkboxes were changed
 
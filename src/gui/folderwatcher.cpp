@@ -73,6 +73,11 @@ bool FolderWatcher::isReliable() const
     return _isReliable;
 }
 
+bool FolderWatcher::isInitialScanDone() const
+{
+    return _isInitialScanDone;
+}
+
 void FolderWatcher::appendSubPaths(QDir dir, QStringList& subPaths) {
     QStringList newSubPaths = dir.entryList(QDir::NoDotAndDotDot | QDir::Dirs | QDir::Files);
     for (int i = 0; i < newSubPaths.size(); i++) {
@@ -85,6 +85,12 @@ public:
      */
     bool isReliable() const;
 
+    /**
+     * Returns false while the watches for the existing subfolders are
+     * still being set up in the background after init().
+     */
+    bool isInitialScanDone() const;
+
 signals:
     /** Emitted when one of the watched directories or one
      *  of the contained files is changed. */
@@ -120,6 +126,7 @@ private:
     QSet<QString> _lastPaths;
     Folder *_folder;
     bool _isReliable = true;
+    bool _isInitialScanDone = true;
 
     void appendSubPaths(QDir dir, QStringList& subPaths);
 
@@ -18,12 +18,16 @@
 
 #include "folder.h"
 #include "folderwatcher_linux.h"
+#include "common/tracing.h"
 
 #include <cerrno>
 #include <QStringList>
 #include <QObject>
+#include <QThreadPool>
 #include <QVarLengthArray>
 
+OC_TRACE_SEMAPHORE(inotify_batch);
+
 namespace OCC {
 
 FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path)
@@ -39,7 +43,15 @@ FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path
         qCWarning(lcFolderWatcher) << "notify_init() failed: " << strerror(errno);
     }
 
-    QMetaObject::invokeMethod(this, "slotAddFolderRecursive", Q_ARG(QString, path));
+    // The root is watched right away, the subfolders follow once the
+    // tree has been walked in the background.
+    inotifyRegisterPath(QDir(path).absolutePath());
+
+    _parent->_isInitialScanDone = false;
+    auto *runnable = new FolderWatcherScanRunnable(path);
+    connect(runnable, &FolderWatcherScanRunnable::subfoldersFound,
+        this, &FolderWatcherPrivate::slotSubfoldersFound);
+    QThreadPool::globalInstance()->start(runnable); // takes ownership and deletes
 }
 
 FolderWatcherPrivate::~FolderWatcherPrivate() = default;
@@ -76,6 +88,7 @@ void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
             IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR);
         if (wd > -1) {
             _watches.insert(wd, path);
+            _watchedPaths.insert(path);
         } else {
             // If we're running out of memory or inotify watches, become
             // unreliable.
@@ -91,23 +104,35 @@ void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
 
 void FolderWatcherPrivate::slotAddFolderRecursive(const QString &path)
 {
-    int subdirs = 0;
     qCDebug(lcFolderWatcher) << "(+) Watcher:" << path;
 
     QDir inPath(path);
     inotifyRegisterPath(inPath.absolutePath());
 
-    const QStringList watchedFolders = _watches.values();
-
     QStringList allSubfolders;
     if (!findFoldersBelow(QDir(path), allSubfolders)) {
         qCWarning(lcFolderWatcher) << "Could not traverse all sub folders";
     }
-    QStringListIterator subfoldersIt(allSubfolders);
-    while (subfoldersIt.hasNext()) {
-        QString subfolder = subfoldersIt.next();
+    registerSubfolders(allSubfolders);
+}
+
+void FolderWatcherPrivate::slotSubfoldersFound(const QString &path, const QStringList &subfolders, bool ok)
+{
+    qCDebug(lcFolderWatcher) << "(+) Watcher:" << path;
+    if (!ok) {
+        qCWarning(lcFolderWatcher) << "Could not traverse all sub folders";
+    }
+    registerSubfolders(subfolders);
+    _parent->_isInitialScanDone = true;
+}
+
+void FolderWatcherPrivate::registerSubfolders(const QStringList &subfolders)
+{
+    int subdirs = 0;
+
+    for (const auto &subfolder : subfolders) {
         QDir folder(subfolder);
-        if (folder.exists() && !watchedFolders.contains(folder.absolutePath())) {
+        if (folder.exists() && !_watchedPaths.contains(folder.absolutePath())) {
             subdirs++;
             if (_parent->pathIsIgnored(subfolder)) {
                 qCDebug(lcFolderWatcher) << "* Not adding" << folder.path();
@@ -151,6 +176,7 @@ void FolderWatcherPrivate::slotReceivedNotification(int fd)
             continue;
         }
     } while (false);
+    OC_TRACE(inotify_batch, fd, len);
 
     // reset counter
     i = 0;
@@ -203,7 +229,22 @@ void FolderWatcherPrivate::removePath(const QString &path)
     if (wid > -1) {
         inotify_rm_watch(_fd, wid);
         _watches.remove(wid);
+        _watchedPaths.remove(path);
     }
 }
 
+FolderWatcherScanRunnable::FolderWatcherScanRunnable(const QString &path)
+    : QObject()
+    , QRunnable()
+    , _path(path)
+{
+}
+
+void FolderWatcherScanRunnable::run()
+{
+    QStringList subfolders;
+    bool ok = FolderWatcherPrivate::findFoldersBelow(QDir(_path), subfolders);
+    emit subfoldersFound(_path, subfolders, ok);
+}
+
 } // ns mirall
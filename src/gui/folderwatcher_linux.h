@@ -19,7 +19,9 @@
 #include <QString>
 #include <QSocketNotifier>
 #include <QHash>
+#include <QSet>
 #include <QDir>
+#include <QRunnable>
 
 #include "folderwatcher.h"
 
@@ -40,22 +42,45 @@ public:
     void addPath(const QString &path);
     void removePath(const QString &);
 
+    static bool findFoldersBelow(const QDir &dir, QStringList &fullList);
+
 protected slots:
     void slotReceivedNotification(int fd);
     void slotAddFolderRecursive(const QString &path);
+    void slotSubfoldersFound(const QString &path, const QStringList &subfolders, bool ok);
 
 protected:
-    bool findFoldersBelow(const QDir &dir, QStringList &fullList);
     void inotifyRegisterPath(const QString &path);
+    void registerSubfolders(const QStringList &subfolders);
 
 private:
     FolderWatcher *_parent;
 
     QString _folder;
     QHash<int, QString> _watches;
+    QSet<QString> _watchedPaths;
     QScopedPointer<QSocketNotifier> _socket;
     int _fd;
 };
+
+/**
+ * @brief Lists the subfolders of the watched root on a worker thread
+ *
+ * Walking a large tree takes long, the watches for the subfolders get
+ * registered once the list arrives in the main thread.
+ */
+class FolderWatcherScanRunnable : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    FolderWatcherScanRunnable(const QString &path);
+    void run() override;
+signals:
+    void subfoldersFound(const QString &path, const QStringList &subfolders, bool ok);
+
+private:
+    QString _path;
+};
 }
 
 #endif
@@ -14,11 +14,24 @@
 
 #include "iconjob.h"
 
+#include <QTimer>
+
 namespace OCC {
 
 IconJob::IconJob(const QUrl &url, QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    _url(url)
 {
+    auto cache = ImageCache::instance();
+    _cached = cache->lookup(url);
+    if (cache->isFresh(_cached)) {
+        QTimer::singleShot(0, this, [this] {
+            emit jobFinished(_cached.data);
+            deleteLater();
+        });
+        return;
+    }
+
     connect(&_accessManager, &QNetworkAccessManager::finished,
             this, &IconJob::finished);
 
@@ -26,15 +39,19 @@ IconJob::IconJob(const QUrl &url, QObject *parent) :
 #if (QT_VERSION >= 0x050600)
     request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
 #endif
+    cache->prepareRequest(request, _cached);
     _accessManager.get(request);
 }
 
 void IconJob::finished(QNetworkReply *reply)
 {
+    reply->deleteLater();
+    deleteLater();
     if (reply->error() != QNetworkReply::NoError)
         return;
 
-    reply->deleteLater();
-    emit jobFinished(reply->readAll());
+    const QByteArray iconData = ImageCache::instance()->handleReply(_url, reply, _cached);
+    if (!iconData.isEmpty())
+        emit jobFinished(iconData);
 }
 }
@@ -21,10 +21,14 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 
+#include "imagecache.h"
+
 namespace OCC {
 
 /**
  * @brief Job to fetch a icon
+ *
+ * Goes through the ImageCache and deletes itself once it is done.
  * @ingroup gui
  */
 class IconJob : public QObject
@@ -41,6 +45,8 @@ private slots:
 
 private:
     QNetworkAccessManager _accessManager;
+    QUrl _url;
+    ImageCache::Entry _cached;
 };
 }
 
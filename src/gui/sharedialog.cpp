@@ -344,11 +344,13 @@ void ShareDialog::slotThumbnailFetched(const int &statusCode, const QByteArray &
         return;
     }
 
-    QPixmap p;
-    p.loadFromData(reply, "PNG");
-    p = p.scaledToHeight(thumbnailSize, Qt::SmoothTransformation);
-    _ui->label_icon->setPixmap(p);
-    _ui->label_icon->show();
+    ImageCache::decodeAsync(reply, this, [this](const QImage &image) {
+        if (image.isNull())
+            return;
+        const auto p = QPixmap::fromImage(image).scaledToHeight(thumbnailSize, Qt::SmoothTransformation);
+        _ui->label_icon->setPixmap(p);
+        _ui->label_icon->show();
+    });
 }
 
 void ShareDialog::slotAccountStateChanged(int state)
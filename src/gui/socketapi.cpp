@@ -682,6 +682,19 @@ void SocketApi::command_OPEN_PRIVATE_LINK(const QString &localFile, SocketListen
     fetchPrivateLinkUrlHelper(localFile, &SocketApi::openPrivateLink);
 }
 
+void SocketApi::command_SYNC_PATH(const QString &localFile, SocketListener *)
+{
+    auto fileData = FileData::get(localFile);
+    if (!fileData.folder)
+        return;
+
+    if (fileData.folderRelativePath.isEmpty()) {
+        FolderMan::instance()->scheduleFolderNext(fileData.folder);
+    } else {
+        FolderMan::instance()->scheduleFolderPaths(fileData.folder, QStringList(fileData.folderRelativePath));
+    }
+}
+
 void SocketApi::copyUrlToClipboard(const QString &link)
 {
     QApplication::clipboard()->setText(link);
@@ -810,6 +823,9 @@ void SocketApi::command_GET_MENU_ITEMS(const QString &argument, OCC::SocketListe
         }
 
         sendSharingContextMenuOptions(fileData, listener);
+
+        if (QFileInfo(fileData.localPath).isDir())
+            listener->sendMessage(QLatin1String("MENU_ITEM:SYNC_PATH::") + tr("Sync now"));
     }
     listener->sendMessage(QString("GET_MENU_ITEMS:END"));
 }
@@ -106,6 +106,9 @@ private:
     Q_INVOKABLE void command_EMAIL_PRIVATE_LINK(const QString &localFile, SocketListener *listener);
     Q_INVOKABLE void command_OPEN_PRIVATE_LINK(const QString &localFile, SocketListener *listener);
 
+    // Syncs only the given file or directory instead of the whole folder
+    Q_INVOKABLE void command_SYNC_PATH(const QString &localFile, SocketListener *listener);
+
     // Windows Shell / Explorer pinning fallbacks, see issue: https://github.com/nextcloud/desktop/issues/1599
 #ifdef Q_OS_WIN
     Q_INVOKABLE void command_COPYASPATH(const QString &localFile, SocketListener *listener);
@@ -13,6 +13,9 @@
  */
 
 #include <QRegExp>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "syncrunfilelog.h"
 #include "common/utility.h"
@@ -21,8 +24,88 @@
 
 namespace OCC {
 
+// Buffered lines are handed to the writer when there are this many characters...
+static const int flushSize = 64 * 1024;
+// ... or when the last flush is this long ago
+static const qint64 flushIntervalMsecs = 1000;
+
+/**
+ * Writes the lines of the sync runs of a folder, used from the thread pool.
+ *
+ * A write takes everything queued so far while holding the write lock,
+ * which keeps the lines in order no matter in which order the runnables
+ * of the thread pool get to run.
+ */
+class SyncRunFileLogWriter
+{
+public:
+    explicit SyncRunFileLogWriter(const QString &folderPath)
+        : _folderPath(folderPath)
+    {
+    }
+
+    const QString &folderPath() const { return _folderPath; }
+
+    /// \a close: close the file after writing the data, at the end of a sync run
+    void enqueue(const QByteArray &data, bool close)
+    {
+        QMutexLocker locker(&_queueMutex);
+        _queue.append(qMakePair(data, close));
+    }
+
+    void writePending()
+    {
+        QMutexLocker writeLocker(&_writeMutex);
+        QVector<QPair<QByteArray, bool>> queue;
+        {
+            QMutexLocker locker(&_queueMutex);
+            queue.swap(_queue);
+        }
+        for (const auto &chunk : queue) {
+            if (!_file.isOpen())
+                open();
+            if (!_file.isOpen())
+                continue;
+            _file.write(chunk.first);
+            if (chunk.second)
+                _file.close();
+        }
+        if (_file.isOpen())
+            _file.flush();
+    }
+
+private:
+    void open();
+
+    const QString _folderPath;
+    QMutex _queueMutex;
+    QMutex _writeMutex;
+    QVector<QPair<QByteArray, bool>> _queue;
+    QFile _file;
+};
+
+namespace {
+    class SyncRunFileLogFlush : public QRunnable
+    {
+    public:
+        explicit SyncRunFileLogFlush(const QSharedPointer<SyncRunFileLogWriter> &writer)
+            : _writer(writer)
+        {
+        }
+        void run() override { _writer->writePending(); }
+
+    private:
+        QSharedPointer<SyncRunFileLogWriter> _writer;
+    };
+}
+
 SyncRunFileLog::SyncRunFileLog() = default;
 
+SyncRunFileLog::~SyncRunFileLog()
+{
+    flush(true);
+}
+
 QString SyncRunFileLog::dateTimeStr(const QDateTime &dt)
 {
     return dt.toString(Qt::ISODate);
@@ -89,7 +172,7 @@ QString SyncRunFileLog::instructionToStr(csync_instructions_e inst)
 }
 
 
-void SyncRunFileLog::start(const QString &folderPath)
+void SyncRunFileLogWriter::open()
 {
     const qint64 logfileMaxSize = 10 * 1024 * 1024; // 10MiB
 
@@ -98,8 +181,8 @@ void SyncRunFileLog::start(const QString &folderPath)
         QDir().mkdir(logpath);
     }
 
-    int length = folderPath.split(QLatin1String("/")).length();
-    QString filenameSingle = folderPath.split(QLatin1String("/")).at(length - 2);
+    int length = _folderPath.split(QLatin1String("/")).length();
+    QString filenameSingle = _folderPath.split(QLatin1String("/")).at(length - 2);
     QString filename = logpath + QLatin1String("/") + filenameSingle + QLatin1String("_sync.log");
 
     int depthIndex = 2;
@@ -110,10 +193,10 @@ void SyncRunFileLog::start(const QString &folderPath)
         QTextStream in(&file);
         QString line = in.readLine();
 
-        if(QString::compare(folderPath,line,Qt::CaseSensitive)!=0) {
+        if(QString::compare(_folderPath,line,Qt::CaseSensitive)!=0) {
             depthIndex++;
             if(depthIndex <= length) {
-                filenameSingle = folderPath.split(QLatin1String("/")).at(length - depthIndex) + QString("_") ///
+                filenameSingle = _folderPath.split(QLatin1String("/")).at(length - depthIndex) + QString("_") ///
                         + filenameSingle;
                 filename = logpath+ QLatin1String("/") + filenameSingle + QLatin1String("_sync.log");
             }
@@ -134,29 +217,49 @@ void SyncRunFileLog::start(const QString &folderPath)
         QFile::remove(newFilename);
         QFile::rename(filename, newFilename);
     }
-    _file.reset(new QFile(filename));
-
-    _file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
-    _out.setDevice(_file.data());
-
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        return;
 
     if (!exists) {
-        _out << folderPath << endl;
+        QByteArray header = _folderPath.toUtf8() + '\n';
         // We are creating a new file, add the note.
-        _out << "# timestamp | duration | file | instruction | dir | modtime | etag | "
-                "size | fileId | status | errorString | http result code | "
-                "other size | other modtime | other etag | other fileId | "
-                "other instruction"
-             << endl;
+        header += "# timestamp | duration | file | instruction | dir | modtime | etag | "
+                  "size | fileId | status | errorString | http result code | "
+                  "other size | other modtime | other etag | other fileId | "
+                  "other instruction\n";
+        _file.write(header);
 
         FileSystem::setFileHidden(filename, true);
     }
+}
 
+void SyncRunFileLog::start(const QString &folderPath)
+{
+    if (!_writer || _writer->folderPath() != folderPath)
+        _writer.reset(new SyncRunFileLogWriter(folderPath));
+    _buffer.clear();
+    _out.setString(&_buffer, QIODevice::WriteOnly);
+    _lastFlush.start();
 
     _totalDuration.start();
     _lapDuration.start();
-    _out << "#=#=#=# Syncrun started " << dateTimeStr(QDateTime::currentDateTimeUtc()) << endl;
+    _out << "#=#=#=# Syncrun started " << dateTimeStr(QDateTime::currentDateTimeUtc()) << '\n';
+}
+
+void SyncRunFileLog::flush(bool force, bool closeFile)
+{
+    if (!_writer)
+        return;
+    _out.flush();
+    if (!closeFile && (_buffer.isEmpty() || (!force && _buffer.size() < flushSize && _lastFlush.elapsed() < flushIntervalMsecs)))
+        return;
+    _writer->enqueue(_buffer.toUtf8(), closeFile);
+    _buffer.clear();
+    _lastFlush.start();
+    QThreadPool::globalInstance()->start(new SyncRunFileLogFlush(_writer)); // takes ownership and deletes
 }
+
 void SyncRunFileLog::logItem(const SyncFileItem &item)
 {
     // don't log the directory items that are in the list
@@ -195,21 +298,23 @@ void SyncRunFileLog::logItem(const SyncFileItem &item)
     _out /* << other fileId (removed) */ << L;
     _out /* << other instruction (removed) */ << L;
 
-    _out << endl;
+    _out << '\n';
+    flush(false);
 }
 
 void SyncRunFileLog::logLap(const QString &name)
 {
     _out << "#=#=#=#=# " << name << " " << dateTimeStr(QDateTime::currentDateTimeUtc())
          << " (last step: " << _lapDuration.restart() << " msec"
-         << ", total: " << _totalDuration.elapsed() << " msec)" << endl;
+         << ", total: " << _totalDuration.elapsed() << " msec)" << '\n';
+    flush(true);
 }
 
 void SyncRunFileLog::finish()
 {
     _out << "#=#=#=# Syncrun finished " << dateTimeStr(QDateTime::currentDateTimeUtc())
          << " (last step: " << _lapDuration.elapsed() << " msec"
-         << ", total: " << _totalDuration.elapsed() << " msec)" << endl;
-    _file->close();
+         << ", total: " << _totalDuration.elapsed() << " msec)" << '\n';
+    flush(true, true);
 }
 }
@@ -18,6 +18,7 @@
 #include <QFile>
 #include <QTextStream>
 #include <QScopedPointer>
+#include <QSharedPointer>
 #include <QElapsedTimer>
 #include <QStandardPaths>
 #include <QDir>
@@ -26,15 +27,22 @@
 
 namespace OCC {
 class SyncFileItem;
+class SyncRunFileLogWriter;
 
 /**
  * @brief The SyncRunFileLog class
  * @ingroup gui
+ *
+ * Lines are collected in memory and written in batches in the thread pool,
+ * together with choosing and rotating the log file, so nothing touches the
+ * disk on the GUI thread. The log lives in the application data location,
+ * outside of the sync folder.
  */
 class SyncRunFileLog
 {
 public:
     SyncRunFileLog();
+    ~SyncRunFileLog();
     void start(const QString &folderPath);
     void logItem(const SyncFileItem &item);
     void logLap(const QString &name);
@@ -46,10 +54,15 @@ private:
     QString instructionToStr(csync_instructions_e inst);
     QString directionToStr(SyncFileItem::Direction dir);
 
-    QScopedPointer<QFile> _file;
+    /// Hands the buffered lines to the writer if \a force or enough have accumulated
+    void flush(bool force, bool closeFile = false);
+
+    QSharedPointer<SyncRunFileLogWriter> _writer;
+    QString _buffer;
     QTextStream _out;
     QElapsedTimer _totalDuration;
     QElapsedTimer _lapDuration;
+    QElapsedTimer _lastFlush;
 };
 }
 
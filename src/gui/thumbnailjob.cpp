@@ -16,6 +16,8 @@
 #include "networkjobs.h"
 #include "account.h"
 
+#include <QTimer>
+
 namespace OCC {
 
 ThumbnailJob::ThumbnailJob(const QString &path, AccountPtr account, QObject *parent)
@@ -26,13 +28,35 @@ ThumbnailJob::ThumbnailJob(const QString &path, AccountPtr account, QObject *par
 
 void ThumbnailJob::start()
 {
-    sendRequest("GET", makeAccountUrl(path()));
+    // The path is relative to the user, keep thumbnails of different users apart
+    const QUrl url = makeAccountUrl(path());
+    _cacheUrl = url;
+    _cacheUrl.setUserName(account()->davUser());
+
+    auto cache = ImageCache::instance();
+    _cached = cache->lookup(_cacheUrl);
+    if (cache->isFresh(_cached)) {
+        QTimer::singleShot(0, this, [this] {
+            emit jobFinished(200, _cached.data);
+            deleteLater();
+        });
+        return;
+    }
+
+    QNetworkRequest req;
+    cache->prepareRequest(req, _cached);
+    sendRequest("GET", url, req);
     AbstractNetworkJob::start();
 }
 
 bool ThumbnailJob::finished()
 {
-    emit jobFinished(reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), reply()->readAll());
+    const QByteArray data = ImageCache::instance()->handleReply(_cacheUrl, reply(), _cached);
+    if (!data.isEmpty()) {
+        emit jobFinished(200, data);
+    } else {
+        emit jobFinished(reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), QByteArray());
+    }
     return true;
 }
 }
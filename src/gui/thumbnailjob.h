@@ -26,6 +26,7 @@ namespace OCC {
  *
  * Job that allows fetching a preview (of 150x150 for now) of a given file.
  * Once the job has finished the jobFinished signal will be emitted.
+ * Thumbnails are served from the ImageCache when possible.
  */
 class ThumbnailJob : public AbstractNetworkJob
 {
@@ -46,6 +47,10 @@ signals:
     void jobFinished(int statusCode, QByteArray reply);
 private slots:
     bool finished() override;
+
+private:
+    QUrl _cacheUrl;
+    ImageCache::Entry _cached;
 };
 }
 
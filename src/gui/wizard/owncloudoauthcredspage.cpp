@@ -70,7 +70,7 @@ void OCC::OwncloudOAuthCredsPage::cleanupPage()
 }
 
 void OwncloudOAuthCredsPage::asyncAuthResult(OAuth::Result r, const QString &user,
-    const QString &token, const QString &refreshToken)
+    const QString &token, const QString &refreshToken, int expiresIn)
 {
     switch (r) {
     case OAuth::NotSupported: {
@@ -89,6 +89,7 @@ void OwncloudOAuthCredsPage::asyncAuthResult(OAuth::Result r, const QString &use
         _token = token;
         _user = user;
         _refreshToken = refreshToken;
+        _tokenExpiresIn = expiresIn;
         auto *ocWizard = qobject_cast<OwncloudWizard *>(wizard());
         Q_ASSERT(ocWizard);
         emit connectToOCUrl(ocWizard->account()->url().toString());
@@ -111,7 +112,7 @@ AbstractCredentials *OwncloudOAuthCredsPage::getCredentials() const
 {
     auto *ocWizard = qobject_cast<OwncloudWizard *>(wizard());
     Q_ASSERT(ocWizard);
-    return new HttpCredentialsGui(_user, _token, _refreshToken,
+    return new HttpCredentialsGui(_user, _token, _refreshToken, _tokenExpiresIn,
         ocWizard->_clientSslCertificate, ocWizard->_clientSslKey);
 }
 
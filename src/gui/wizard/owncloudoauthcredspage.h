@@ -46,7 +46,7 @@ public:
 
 public Q_SLOTS:
     void asyncAuthResult(OAuth::Result, const QString &user, const QString &token,
-        const QString &reniewToken);
+        const QString &reniewToken, int expiresIn);
 
 signals:
     void connectToOCUrl(const QString &);
@@ -55,6 +55,7 @@ public:
     QString _user;
     QString _token;
     QString _refreshToken;
+    int _tokenExpiresIn = 0;
     QScopedPointer<OAuth> _asyncAuth;
     Ui_OwncloudOAuthCredsPage _ui;
 
@@ -34,9 +34,13 @@
 #include "owncloudpropagator.h"
 
 #include "creds/abstractcredentials.h"
+#include "common/tracing.h"
 
 Q_DECLARE_METATYPE(QTimer *)
 
+OC_TRACE_SEMAPHORE(request_sent);
+OC_TRACE_SEMAPHORE(request_finished);
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcNetworkJob, "nextcloud.sync.networkjob", QtInfoMsg)
@@ -124,6 +128,8 @@ QNetworkReply *AbstractNetworkJob::addTimer(QNetworkReply *reply)
 QNetworkReply *AbstractNetworkJob::sendRequest(const QByteArray &verb, const QUrl &url,
     QNetworkRequest req, QIODevice *requestBody)
 {
+    if (OC_TRACE_ENABLED(request_sent))
+        OC_TRACE(request_sent, this, verb.constData(), url.toEncoded().constData(), requestBody ? requestBody->size() : 0);
     auto reply = _account->sendRawRequest(verb, url, req, requestBody);
     _requestBody = requestBody;
     if (_requestBody) {
@@ -154,6 +160,7 @@ QUrl AbstractNetworkJob::makeDavUrl(const QString &relativePath) const
 void AbstractNetworkJob::slotFinished()
 {
     _timer.stop();
+    OC_TRACE(request_finished, this, _reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), int(_reply->error()));
 
     if (_reply->error() == QNetworkReply::SslHandshakeFailedError) {
         qCWarning(lcNetworkJob) << "SslHandshakeFailedError: " << errorString() << " : can be caused by a webserver wanting SSL client certificates";
@@ -192,6 +199,41 @@ void AbstractNetworkJob::slotFinished()
     }
 #endif
 
+    // Expired credentials, like an OAuth access token, may be renewable without
+    // the user. Send the request once more when they are instead of failing.
+    AbstractCredentials *creds = _account->credentials();
+    if (!_ignoreCredentialFailure && !_credentialsRenewed && !creds->stillValid(_reply)) {
+        const QByteArray renewVerb = requestVerb(*reply());
+        if (!renewVerb.isEmpty() && !(_requestBody && _requestBody->isSequential())) {
+            _credentialsRenewed = true;
+            const bool renewing = creds->renewCredentials(_reply, this, [this, renewVerb](bool renewed) {
+                _renewingCredentials = false;
+                if (!_reply)
+                    return;
+                if (!renewed) {
+                    slotFinished();
+                    return;
+                }
+                qCInfo(lcNetworkJob) << "Resending" << renewVerb << _reply->request().url() << "with renewed credentials";
+                resetTimeout();
+                if (_requestBody) {
+                    if (!_requestBody->isOpen())
+                        _requestBody->open(QIODevice::ReadOnly);
+                    _requestBody->seek(0);
+                }
+                sendRequest(
+                    renewVerb,
+                    _reply->request().url(),
+                    _reply->request(),
+                    _requestBody);
+            });
+            if (renewing) {
+                _renewingCredentials = true;
+                return;
+            }
+        }
+    }
+
     if (_reply->error() != QNetworkReply::NoError) {
         if (!_ignoreCredentialFailure || _reply->error() != QNetworkReply::AuthenticationRequiredError) {
             qCWarning(lcNetworkJob) << _reply->error() << errorString()
@@ -258,7 +300,6 @@ void AbstractNetworkJob::slotFinished()
         }
     }
 
-    AbstractCredentials *creds = _account->credentials();
     if (!creds->stillValid(_reply) && !_ignoreCredentialFailure) {
         _account->handleInvalidCredentials();
     }
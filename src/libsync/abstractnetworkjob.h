@@ -146,6 +146,11 @@ protected:
      */
     virtual void newReplyHook(QNetworkReply *) {}
 
+    /** Whether the finished reply was rejected for expired credentials and
+     * will be sent again once they are renewed.
+     */
+    bool isRenewingCredentials() const { return _renewingCredentials; }
+
     /// Creates a url for the account from a relative path
     QUrl makeAccountUrl(const QString &relativePath) const;
 
@@ -189,6 +194,8 @@ private:
     QString _path;
     QTimer _timer;
     int _redirectCount = 0;
+    bool _credentialsRenewed = false; // requests are sent again at most once after renewing
+    bool _renewingCredentials = false;
 #if (QT_VERSION >= 0x050800)
     int _http2ResendCount = 0;
 #endif
@@ -23,6 +23,7 @@
 
 #include "common/asserts.h"
 #include "clientsideencryption.h"
+#include "syncrecorder.h"
 
 #include <QLoggingCategory>
 #include <QNetworkReply>
@@ -172,6 +173,7 @@ void Account::setCredentials(AbstractCredentials *cred)
         proxy = _am->proxy();
 
         _am = QSharedPointer<QNetworkAccessManager>();
+        _amPool.clear();
     }
 
     // The order for these two is important! Reading the credential's
@@ -194,6 +196,7 @@ void Account::setCredentials(AbstractCredentials *cred)
         SLOT(slotHandleSslErrors(QNetworkReply *, QList<QSslError>)));
     connect(_am.data(), &QNetworkAccessManager::proxyAuthenticationRequired,
         this, &Account::proxyAuthenticationRequired);
+    resetNetworkAccessManagerPool();
     connect(_credentials.data(), &AbstractCredentials::fetched,
         this, &Account::slotCredentialsFetched);
     connect(_credentials.data(), &AbstractCredentials::asked,
@@ -259,6 +262,31 @@ void Account::resetNetworkAccessManager()
         SLOT(slotHandleSslErrors(QNetworkReply *, QList<QSslError>)));
     connect(_am.data(), &QNetworkAccessManager::proxyAuthenticationRequired,
         this, &Account::proxyAuthenticationRequired);
+
+    resetNetworkAccessManagerPool();
+}
+
+void Account::resetNetworkAccessManagerPool()
+{
+    _amPool.clear();
+    _amPoolNext = 0;
+
+    static int poolSize = qBound(1, qEnvironmentVariableIsSet("OWNCLOUD_QNAM_POOL_SIZE")
+            ? qgetenv("OWNCLOUD_QNAM_POOL_SIZE").toInt() : 2, 4);
+    for (int i = 1; i < poolSize; ++i) {
+        QNetworkAccessManager *am = _credentials->createQNAM();
+        if (am == _am.data()) {
+            // These credentials hand out a single QNAM
+            break;
+        }
+        lendCookieJarTo(am);
+        am->setProxy(_am->proxy());
+        connect(am, SIGNAL(sslErrors(QNetworkReply *, QList<QSslError>)),
+            SLOT(slotHandleSslErrors(QNetworkReply *, QList<QSslError>)));
+        connect(am, &QNetworkAccessManager::proxyAuthenticationRequired,
+            this, &Account::proxyAuthenticationRequired);
+        _amPool.append(QSharedPointer<QNetworkAccessManager>(am, &QObject::deleteLater));
+    }
 }
 
 QNetworkAccessManager *Account::networkAccessManager()
@@ -271,22 +299,55 @@ QSharedPointer<QNetworkAccessManager> Account::sharedNetworkAccessManager()
     return _am;
 }
 
+int Account::networkAccessManagerPoolSize()
+{
+    if (isHttp2Supported())
+        return 1;
+    return 1 + _amPool.size();
+}
+
+QNetworkAccessManager *Account::nextNetworkAccessManager()
+{
+    if (_amPool.isEmpty() || isHttp2Supported())
+        return _am.data();
+
+    _amPoolNext = (_amPoolNext + 1) % (_amPool.size() + 1);
+    if (_amPoolNext == 0)
+        return _am.data();
+    QNetworkAccessManager *am = _amPool.at(_amPoolNext - 1).data();
+    // The proxy is only ever changed on the main QNAM
+    if (am->proxy() != _am->proxy())
+        am->setProxy(_am->proxy());
+    return am;
+}
+
 QNetworkReply *Account::sendRawRequest(const QByteArray &verb, const QUrl &url, QNetworkRequest req, QIODevice *data)
 {
     req.setUrl(url);
     req.setSslConfiguration(this->getOrCreateSslConfig());
+    QNetworkAccessManager *am = nextNetworkAccessManager();
+    QNetworkReply *reply = nullptr;
     if (verb == "HEAD" && !data) {
-        return _am->head(req);
+        reply = am->head(req);
     } else if (verb == "GET" && !data) {
-        return _am->get(req);
+        reply = am->get(req);
     } else if (verb == "POST") {
-        return _am->post(req, data);
+        reply = am->post(req, data);
     } else if (verb == "PUT") {
-        return _am->put(req, data);
+        reply = am->put(req, data);
     } else if (verb == "DELETE" && !data) {
-        return _am->deleteResource(req);
+        reply = am->deleteResource(req);
+    } else {
+        reply = am->sendCustomRequest(req, verb, data);
     }
-    return _am->sendCustomRequest(req, verb, data);
+    if (_syncRecorder)
+        _syncRecorder->recordRequest(verb, reply, data);
+    return reply;
+}
+
+void Account::setSyncRecorder(SyncRecorder *recorder)
+{
+    _syncRecorder = recorder;
 }
 
 SimpleNetworkJob *Account::sendRequest(const QByteArray &verb, const QUrl &url, QNetworkRequest req, QIODevice *data)
@@ -408,6 +469,10 @@ void Account::slotHandleSslErrors(QNetworkReply *reply, QList<QSslError> errors)
     // Keep a ref here on our stackframe to make sure that it doesn't get deleted before
     // handleErrors returns.
     QSharedPointer<QNetworkAccessManager> qnamLock = _am;
+    for (const auto &am : _amPool) {
+        if (am.data() == reply->manager())
+            qnamLock = am;
+    }
     QPointer<QObject> guard = reply;
 
     if (_sslErrorHandler->handleErrors(errors, reply->sslConfiguration(), &approvedCerts, sharedFromThis())) {
@@ -461,6 +526,8 @@ void Account::handleInvalidCredentials()
 void Account::clearQNAMCache()
 {
     _am->clearAccessCache();
+    for (const auto &am : _amPool)
+        am->clearAccessCache();
 }
 
 const Capabilities &Account::capabilities() const
@@ -25,7 +25,9 @@
 #include <QSslConfiguration>
 #include <QSslCipher>
 #include <QSslError>
+#include <QPointer>
 #include <QSharedPointer>
+#include <QVector>
 
 #ifndef TOKEN_AUTH_ONLY
 #include <QPixmap>
@@ -54,6 +56,7 @@ class Account;
 typedef QSharedPointer<Account> AccountPtr;
 class AccessManager;
 class SimpleNetworkJob;
+class SyncRecorder;
 
 /**
  * @brief Reimplement this to handle SSL errors from libsync
@@ -146,6 +149,9 @@ public:
         QNetworkRequest req = QNetworkRequest(),
         QIODevice *data = nullptr);
 
+    /** Requests sent through sendRawRequest() are recorded while set, see SyncRecorder */
+    void setSyncRecorder(SyncRecorder *recorder);
+
     /** Create and start network job for a simple one-off request.
      *
      * More complicated requests typically create their own job types.
@@ -235,6 +241,15 @@ public:
     QNetworkAccessManager *networkAccessManager();
     QSharedPointer<QNetworkAccessManager> sharedNetworkAccessManager();
 
+    /** Number of QNAMs that requests are distributed over.
+     *
+     * Qt opens at most six connections per host and QNAM. Without HTTP/2,
+     * requests are spread over a small pool of QNAMs that share the cookie
+     * jar, proxy and credentials, to allow more parallel requests.
+     * See OWNCLOUD_QNAM_POOL_SIZE.
+     */
+    int networkAccessManagerPoolSize();
+
     /// Called by network jobs on credential errors, emits invalidCredentials()
     void handleInvalidCredentials();
 
@@ -286,6 +301,8 @@ protected Q_SLOTS:
 private:
     Account(QObject *parent = nullptr);
     void setSharedThis(AccountPtr sharedThis);
+    void resetNetworkAccessManagerPool();
+    QNetworkAccessManager *nextNetworkAccessManager();
 
     QWeakPointer<Account> _sharedThis;
     QString _id;
@@ -311,6 +328,10 @@ private:
     QString _serverVersion;
     QScopedPointer<AbstractSslErrorHandler> _sslErrorHandler;
     QSharedPointer<QNetworkAccessManager> _am;
+    /// The QNAMs besides _am that requests are distributed over, see networkAccessManagerPoolSize()
+    QVector<QSharedPointer<QNetworkAccessManager>> _amPool;
+    int _amPoolNext = 0;
+    QPointer<SyncRecorder> _syncRecorder;
     QScopedPointer<AbstractCredentials> _credentials;
     bool _http2Supported = false;
 
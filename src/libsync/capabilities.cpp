@@ -103,6 +103,11 @@ bool Capabilities::isValid() const
     return !_capabilities.isEmpty();
 }
 
+QVariantMap Capabilities::toVariantMap() const
+{
+    return _capabilities;
+}
+
 bool Capabilities::hasActivities() const
 {
     return _capabilities.contains("activity");
@@ -62,6 +62,9 @@ public:
     /// returns true if the capabilities are loaded already.
     bool isValid() const;
 
+    /// the capabilities as received from the server, for persisting them
+    QVariantMap toVariantMap() const;
+
     /// return true if the activity app is enabled
     bool hasActivities() const;
 
@@ -32,6 +32,11 @@
 #include <QIODevice>
 #include <QUuid>
 #include <QScopeGuard>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
 
 #include <keychain.h>
 #include "common/utility.h"
@@ -733,7 +738,13 @@ QByteArray encryptStringAsymmetric(EVP_PKEY *publicKey, const QByteArray& data)
 }
 
 }
-ClientSideEncryption::ClientSideEncryption() = default;
+ClientSideEncryption::ClientSideEncryption()
+{
+    // Folders usually come in bunches during a sync, write the cache once for all of them
+    _folderMetadataCacheSaveTimer.setSingleShot(true);
+    _folderMetadataCacheSaveTimer.setInterval(5000);
+    connect(&_folderMetadataCacheSaveTimer, &QTimer::timeout, this, &ClientSideEncryption::saveFolderMetadataCache);
+}
 
 void ClientSideEncryption::setAccount(AccountPtr account)
 {
@@ -914,6 +925,11 @@ void ClientSideEncryption::writeMnemonic() {
 
 void ClientSideEncryption::forgetSensitiveData()
 {
+    _folderMetadataCacheSaveTimer.stop();
+    _folderMetadataCache.clear();
+    _folderMetadataCacheLoaded = false;
+    QFile::remove(folderMetadataCachePath());
+
     _privateKey = QByteArray();
     _certificate = QSslCertificate();
     _publicKey = QSslKey();
@@ -1236,7 +1252,102 @@ void ClientSideEncryption::folderEncryptedStatusError(int error)
     qCDebug(lcCse) << "Failed to retrieve the status of the folders." << error;
 }
 
-FolderMetadata::FolderMetadata(AccountPtr account, const QByteArray& metadata, int statusCode) : _account(account)
+QString ClientSideEncryption::folderMetadataCachePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + QStringLiteral("/e2e-metadata-") + _account->id() + QStringLiteral(".cache");
+}
+
+QByteArray ClientSideEncryption::folderMetadataCacheKey() const
+{
+    if (_privateKey.isEmpty())
+        return {};
+    // AES-128 like the rest of the metadata
+    return QCryptographicHash::hash(_privateKey + "nextcloud-e2e-metadata-cache", QCryptographicHash::Sha256).left(16);
+}
+
+void ClientSideEncryption::loadFolderMetadataCache()
+{
+    const auto key = folderMetadataCacheKey();
+    if (_folderMetadataCacheLoaded || key.isEmpty())
+        return;
+    _folderMetadataCacheLoaded = true;
+
+    QFile file(folderMetadataCachePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QByteArray data = QByteArray::fromBase64(EncryptionHelper::decryptStringSymmetric(key, file.readAll()));
+    QDataStream stream(data);
+    quint32 version = 0;
+    stream >> version;
+    if (version != 1) {
+        qCInfo(lcCseMetadata) << "Ignoring the metadata cache with version" << version;
+        return;
+    }
+    QHash<QByteArray, QPair<QByteArray, QByteArray>> cache;
+    stream >> cache;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(lcCseMetadata) << "Could not read the metadata cache" << file.fileName();
+        return;
+    }
+    // Entries set up since startup are newer than the ones on disk
+    for (auto it = _folderMetadataCache.cbegin(); it != _folderMetadataCache.cend(); ++it)
+        cache.insert(it.key(), it.value());
+    _folderMetadataCache = cache;
+    qCInfo(lcCseMetadata) << "Loaded" << _folderMetadataCache.size() << "folders from the metadata cache";
+}
+
+void ClientSideEncryption::saveFolderMetadataCache()
+{
+    const auto key = folderMetadataCacheKey();
+    if (key.isEmpty())
+        return;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint32(1) << _folderMetadataCache;
+
+    const auto path = folderMetadataCachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    // Don't leave a truncated cache behind if writing fails halfway
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(EncryptionHelper::encryptStringSymmetric(key, data.toBase64())) < 0
+        || !file.commit()) {
+        qCWarning(lcCseMetadata) << "Could not write the metadata cache" << path << file.errorString();
+    }
+}
+
+QByteArray ClientSideEncryption::cachedFolderMetadata(const QByteArray &folderId, const QByteArray &metadataHash)
+{
+    loadFolderMetadataCache();
+    auto it = _folderMetadataCache.constFind(folderId);
+    if (it == _folderMetadataCache.constEnd() || it->first != metadataHash)
+        return {};
+    return it->second;
+}
+
+void ClientSideEncryption::cacheFolderMetadata(const QByteArray &folderId, const QByteArray &metadataHash, const QByteArray &cacheData)
+{
+    loadFolderMetadataCache();
+    _folderMetadataCache.insert(folderId, qMakePair(metadataHash, cacheData));
+    _folderMetadataCacheSaveTimer.start();
+}
+
+FolderMetadata::FolderMetadata(AccountPtr account, const QByteArray& metadata, int statusCode)
+    : _account(account)
+    , _privateKey(account->e2e()->_privateKey)
+{
+    setup(metadata, statusCode);
+}
+
+FolderMetadata::FolderMetadata(AccountPtr account, const QByteArray &privateKey)
+    : _account(account)
+    , _privateKey(privateKey)
+{
+}
+
+void FolderMetadata::setup(const QByteArray &metadata, int statusCode)
 {
     if (metadata.isEmpty() || statusCode == 404) {
         qCInfo(lcCseMetadata()) << "Setupping Empty Metadata";
@@ -1247,6 +1358,83 @@ FolderMetadata::FolderMetadata(AccountPtr account, const QByteArray& metadata, i
     }
 }
 
+void FolderMetadata::setupAsync(AccountPtr account, const QByteArray &folderId, const QJsonDocument &json, int statusCode,
+    QObject *receiver, const std::function<void(const FolderMetadata &)> &callback)
+{
+    const QByteArray metadata = json.toJson(QJsonDocument::Compact);
+    if (metadata.isEmpty() || statusCode == 404 || folderId.isEmpty()) {
+        // Nothing to decrypt
+        callback(FolderMetadata(account, metadata, statusCode));
+        return;
+    }
+
+    const QByteArray metadataHash = QCryptographicHash::hash(metadata, QCryptographicHash::Sha256);
+    const QByteArray cacheData = account->e2e()->cachedFolderMetadata(folderId, metadataHash);
+    if (!cacheData.isEmpty()) {
+        if (auto cached = fromCacheData(account, cacheData)) {
+            qCInfo(lcCseMetadata) << "Using the cached metadata of" << folderId;
+            callback(*cached);
+            return;
+        }
+    }
+
+    auto runnable = new FolderMetadataRunnable(account, account->e2e()->_privateKey, metadata, statusCode);
+    QObject::connect(runnable, &FolderMetadataRunnable::finished, receiver,
+        [account, folderId, metadataHash, callback](const QSharedPointer<FolderMetadata> &result) {
+            account->e2e()->cacheFolderMetadata(folderId, metadataHash, result->toCacheData());
+            callback(*result);
+        });
+    QThreadPool::globalInstance()->start(runnable); // takes ownership and deletes
+}
+
+QByteArray FolderMetadata::toCacheData() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << _metadataKeys << _sharing << _files.size();
+    for (const auto &file : _files) {
+        stream << file.encryptionKey << file.mimetype << file.initializationVector << file.authenticationTag
+               << file.encryptedFilename << file.originalFilename << file.fileVersion << file.metadataKey;
+    }
+    return data;
+}
+
+QSharedPointer<FolderMetadata> FolderMetadata::fromCacheData(AccountPtr account, const QByteArray &data)
+{
+    QSharedPointer<FolderMetadata> metadata(new FolderMetadata(account, QByteArray()));
+    QDataStream stream(data);
+    int count = 0;
+    stream >> metadata->_metadataKeys >> metadata->_sharing >> count;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        EncryptedFile file;
+        stream >> file.encryptionKey >> file.mimetype >> file.initializationVector >> file.authenticationTag
+            >> file.encryptedFilename >> file.originalFilename >> file.fileVersion >> file.metadataKey;
+        metadata->_files.append(file);
+    }
+    if (stream.status() != QDataStream::Ok || metadata->_metadataKeys.isEmpty())
+        return {};
+    return metadata;
+}
+
+FolderMetadataRunnable::FolderMetadataRunnable(AccountPtr account, const QByteArray &privateKey, const QByteArray &metadata, int statusCode)
+    : _account(account)
+    , _privateKey(privateKey)
+    , _metadata(metadata)
+    , _statusCode(statusCode)
+{
+}
+
+void FolderMetadataRunnable::run()
+{
+    qRegisterMetaType<QSharedPointer<FolderMetadata>>();
+
+    // The private key was copied in the main thread, only the public key
+    // is read from the account and only when encrypting.
+    QSharedPointer<FolderMetadata> metadata(new FolderMetadata(_account, _privateKey));
+    metadata->setup(_metadata, _statusCode);
+    emit finished(metadata);
+}
+
 void FolderMetadata::setupExistingMetadata(const QByteArray& metadata)
 {
   /* This is the json response from the server, it contains two extra objects that we are *not* interested.
@@ -1350,7 +1538,7 @@ QByteArray FolderMetadata::encryptMetadataKey(const QByteArray& data) const
 QByteArray FolderMetadata::decryptMetadataKey(const QByteArray& encryptedMetadata) const
 {
     Bio privateKeyBio;
-    QByteArray privateKeyPem = _account->e2e()->_privateKey;
+    QByteArray privateKeyPem = _privateKey;
     BIO_write(privateKeyBio, privateKeyPem.constData(), privateKeyPem.size());
     auto key = PKey::readPrivateKey(privateKeyBio);
 
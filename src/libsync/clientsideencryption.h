@@ -9,6 +9,13 @@
 #include <QFile>
 #include <QVector>
 #include <QMap>
+#include <QHash>
+#include <QPair>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include <functional>
 
 #include <openssl/evp.h>
 
@@ -23,6 +30,8 @@ class ReadPasswordJob;
 
 namespace OCC {
 
+class FolderMetadata;
+
 QString baseUrl();
 
 namespace EncryptionHelper {
@@ -90,6 +99,15 @@ public:
 
     bool newMnemonicGenerated() const;
 
+    /** Decrypted metadata of the folder as FolderMetadata::toCacheData(), if it
+     * was set up from metadata with this hash. Empty otherwise.
+     *
+     * See FolderMetadata::setupAsync(). The cache is kept in memory and
+     * encrypted on disk, with a key derived from the private key.
+     */
+    QByteArray cachedFolderMetadata(const QByteArray &folderId, const QByteArray &metadataHash);
+    void cacheFolderMetadata(const QByteArray &folderId, const QByteArray &metadataHash, const QByteArray &cacheData);
+
 public slots:
     void slotRequestMnemonic();
 
@@ -117,6 +135,11 @@ private:
     void writeCertificate();
     void writeMnemonic();
 
+    QString folderMetadataCachePath() const;
+    QByteArray folderMetadataCacheKey() const;
+    void loadFolderMetadataCache();
+    void saveFolderMetadataCache();
+
     AccountPtr _account;
     bool isInitialized = false;
     bool _refreshingEncryptionStatus = false;
@@ -124,6 +147,11 @@ private:
     QMap<QByteArray, QByteArray> _folder2token;
     QMap<QString, bool> _folder2encryptedStatus;
 
+    // folder id -> hash of the metadata received from the server, and the decrypted metadata
+    QHash<QByteArray, QPair<QByteArray, QByteArray>> _folderMetadataCache;
+    bool _folderMetadataCacheLoaded = false;
+    QTimer _folderMetadataCacheSaveTimer;
+
 public:
     //QSslKey _privateKey;
     QByteArray _privateKey;
@@ -153,8 +181,24 @@ public:
     void removeEncryptedFile(const EncryptedFile& f);
     QVector<EncryptedFile> files() const;
 
+    /** Sets up the metadata of the folder folderId from the reply of a GetMetadataApiJob
+     *
+     * Decrypting the metadata keys and every file entry runs on the thread pool,
+     * callback is called in the thread of receiver. The result is cached, so
+     * metadata that did not change since the last time is not decrypted again.
+     */
+    static void setupAsync(AccountPtr account, const QByteArray &folderId, const QJsonDocument &json, int statusCode,
+        QObject *receiver, const std::function<void(const FolderMetadata &)> &callback);
+
+    /// Serializes the decrypted metadata, without the private key, for the cache on disk
+    QByteArray toCacheData() const;
+    static QSharedPointer<FolderMetadata> fromCacheData(AccountPtr account, const QByteArray &data);
 
 private:
+    friend class FolderMetadataRunnable;
+    FolderMetadata(AccountPtr account, const QByteArray &privateKey);
+    void setup(const QByteArray &metadata, int statusCode);
+
     /* Use std::string and std::vector internally on this class
      * to ease the port to Nlohmann Json API
      */
@@ -170,8 +214,29 @@ private:
     QVector<EncryptedFile> _files;
     QMap<int, QByteArray> _metadataKeys;
     AccountPtr _account;
+    QByteArray _privateKey;
     QVector<QPair<QString, QString>> _sharing;
 };
 
+/* Decrypts folder metadata on the thread pool, see FolderMetadata::setupAsync() */
+class OWNCLOUDSYNC_EXPORT FolderMetadataRunnable : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    FolderMetadataRunnable(AccountPtr account, const QByteArray &privateKey, const QByteArray &metadata, int statusCode);
+    void run() override;
+signals:
+    void finished(const QSharedPointer<OCC::FolderMetadata> &metadata);
+
+private:
+    AccountPtr _account;
+    QByteArray _privateKey;
+    QByteArray _metadata;
+    int _statusCode;
+};
+
 } // namespace OCC
+
+Q_DECLARE_METATYPE(QSharedPointer<OCC::FolderMetadata>)
+
 #endif
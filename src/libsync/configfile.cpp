@@ -72,6 +72,7 @@ static const char chunkSizeC[] = "chunkSize";
 static const char minChunkSizeC[] = "minChunkSize";
 static const char maxChunkSizeC[] = "maxChunkSize";
 static const char targetChunkUploadDurationC[] = "targetChunkUploadDuration";
+static const char discoveryMemoryBudgetC[] = "discoveryMemoryBudget";
 static const char automaticLogDirC[] = "logToTemporaryLogDir";
 
 static const char proxyHostC[] = "Proxy/host";
@@ -232,6 +233,12 @@ chrono::milliseconds ConfigFile::targetChunkUploadDuration() const
     return millisecondsValue(settings, targetChunkUploadDurationC, chrono::minutes(1));
 }
 
+qint64 ConfigFile::discoveryMemoryBudget() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(discoveryMemoryBudgetC), 0).toLongLong(); // default to unlimited
+}
+
 void ConfigFile::setOptionalServerNotifications(bool show)
 {
     QSettings settings(configFile(), QSettings::IniFormat);
@@ -139,6 +139,8 @@ public:
     quint64 maxChunkSize() const;
     quint64 minChunkSize() const;
     std::chrono::milliseconds targetChunkUploadDuration() const;
+    /** Memory budget in bytes for discovery, 0 for unlimited. See SyncOptions. */
+    qint64 discoveryMemoryBudget() const;
 
     void saveGeometry(QWidget *w);
     void restoreGeometry(QWidget *w);
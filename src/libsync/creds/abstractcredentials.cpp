@@ -33,6 +33,11 @@ void AbstractCredentials::setAccount(Account *account)
     _account = account;
 }
 
+bool AbstractCredentials::renewCredentials(QNetworkReply *, QObject *, const std::function<void(bool)> &)
+{
+    return false;
+}
+
 QString AbstractCredentials::keychainKey(const QString &url, const QString &user, const QString &accountId)
 {
     QString u(url);
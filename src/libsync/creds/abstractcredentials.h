@@ -17,6 +17,8 @@
 
 #include <QObject>
 
+#include <functional>
+
 #include <csync.h>
 #include "owncloudlib.h"
 #include "accountfwd.h"
@@ -64,6 +66,18 @@ public:
     virtual void askFromUser() = 0;
 
     virtual bool stillValid(QNetworkReply *reply) = 0;
+
+    /** Renews the credentials without asking the user, if that is possible.
+     *
+     * Used when \a reply failed because the credentials expired, typically an
+     * OAuth access token. \a callback is called in the thread of \a receiver
+     * once it is known whether the request may be sent again.
+     *
+     * Returns false, without calling \a callback, if the credentials can't be
+     * renewed this way.
+     */
+    virtual bool renewCredentials(QNetworkReply *reply, QObject *receiver, const std::function<void(bool renewed)> &callback);
+
     virtual void persist() = 0;
 
     /** Invalidates token used to authorize requests, it will no longer be used.
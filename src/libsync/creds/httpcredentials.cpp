@@ -137,6 +137,11 @@ QString HttpCredentials::password() const
 void HttpCredentials::setAccount(Account *account)
 {
     AbstractCredentials::setAccount(account);
+    _refreshTimer.setSingleShot(true);
+    connect(&_refreshTimer, &QTimer::timeout, this, [this] {
+        if (_ready && !_refreshToken.isEmpty())
+            startTokenRefresh();
+    });
     if (_user.isEmpty()) {
         fetchUser();
     }
@@ -358,9 +363,23 @@ bool HttpCredentials::refreshAccessToken()
     if (_refreshToken.isEmpty())
         return false;
 
+    _emitFetchedAfterRefresh = true;
+    startTokenRefresh();
+    return true;
+}
+
+void HttpCredentials::startTokenRefresh()
+{
+    if (_isRefreshingToken)
+        return;
+    _isRefreshingToken = true;
+    _refreshTimer.stop();
+
     QUrl requestToken = Utility::concatUrlPath(_account->url(), QLatin1String("/index.php/apps/oauth2/api/v1/token"));
     QNetworkRequest req;
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+    // The access token may still be set when refreshing ahead of time
+    req.setAttribute(DontAddCredentialsAttribute, true);
 
     QString basicAuth = QString("%1:%2").arg(
         Theme::instance()->oauthClientId(), Theme::instance()->oauthClientSecret());
@@ -373,6 +392,7 @@ bool HttpCredentials::refreshAccessToken()
     auto job = _account->sendRequest("POST", requestToken, req, requestBody);
     job->setTimeout(qMin(30 * 1000ll, job->timeoutMsec()));
     QObject::connect(job, &SimpleNetworkJob::finishedSignal, this, [this](QNetworkReply *reply) {
+        bool renewed = false;
         auto jsonData = reply->readAll();
         QJsonParseError jsonParseError;
         QJsonObject json = QJsonDocument::fromJson(jsonData, &jsonParseError).object();
@@ -390,9 +410,56 @@ bool HttpCredentials::refreshAccessToken()
             _password = accessToken;
             _refreshToken = json["refresh_token"].toString();
             persist();
+            renewed = true;
+            scheduleTokenRefresh(json["expires_in"].toInt());
+        }
+        _isRefreshingToken = false;
+
+        const auto callbacks = std::move(_renewalCallbacks);
+        _renewalCallbacks.clear();
+        for (const auto &callback : callbacks) {
+            if (callback.first)
+                callback.second(renewed);
+        }
+
+        if (_emitFetchedAfterRefresh) {
+            _emitFetchedAfterRefresh = false;
+            emit fetched();
         }
-        emit fetched();
     });
+}
+
+void HttpCredentials::scheduleTokenRefresh(int expiresIn)
+{
+    // The lifetime of the access tokens of the Nextcloud oauth2 app, for
+    // servers that don't announce it
+    if (expiresIn <= 0)
+        expiresIn = 3600;
+
+    // Refresh a while before the token expires, so that requests of a
+    // running sync don't get rejected
+    const int refreshIn = qMax(60, expiresIn - qMin(300, expiresIn / 5));
+    qCInfo(lcHttpCredentials) << "Access token expires in" << expiresIn << "s, refreshing it in" << refreshIn << "s";
+    _refreshTimer.setSingleShot(true);
+    _refreshTimer.start(refreshIn * 1000);
+}
+
+bool HttpCredentials::renewCredentials(QNetworkReply *reply, QObject *receiver, const std::function<void(bool)> &callback)
+{
+    // Never for the refresh request itself
+    if (_refreshToken.isEmpty() || reply->request().attribute(DontAddCredentialsAttribute).toBool())
+        return false;
+
+    // Another request already caused a refresh since this one was sent
+    const QByteArray currentAuthorization = "Bearer " + _password.toUtf8();
+    if (!_password.isEmpty() && reply->request().rawHeader("Authorization") != currentAuthorization) {
+        QTimer::singleShot(0, receiver, [callback] { callback(true); });
+        return true;
+    }
+
+    qCInfo(lcHttpCredentials) << "Access token rejected for" << reply->request().url() << ", refreshing it";
+    _renewalCallbacks.append(qMakePair(QPointer<QObject>(receiver), callback));
+    startTokenRefresh();
     return true;
 }
 
@@ -404,6 +471,7 @@ void HttpCredentials::invalidateToken()
     }
     _password = QString();
     _ready = false;
+    _refreshTimer.stop();
 
     // User must be fetched from config file to generate a valid key
     fetchUser();
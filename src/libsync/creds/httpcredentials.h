@@ -20,6 +20,9 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QNetworkRequest>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
 #include "creds/abstractcredentials.h"
 
 class QNetworkReply;
@@ -66,6 +69,10 @@ namespace OCC {
                 v
             emit fetched()
 
+   While OAuth is used, the access token is refreshed again a while before it
+   expires. Requests that are rejected anyway ask for a refresh through
+   renewCredentials() and are sent again once it is done.
+
    2) If the credentials is still not valid when fetched() is emitted, the ui, will call askFromUser()
       which is implemented in HttpCredentialsGui
 
@@ -87,6 +94,7 @@ public:
     bool ready() const override;
     void fetchFromKeychain() override;
     bool stillValid(QNetworkReply *reply) override;
+    bool renewCredentials(QNetworkReply *reply, QObject *receiver, const std::function<void(bool renewed)> &callback) override;
     void persist() override;
     QString user() const override;
     // the password or token
@@ -131,6 +139,12 @@ protected:
     /// Wipes legacy keychain locations
     void deleteOldKeychainEntries();
 
+    /// Requests a new access token unless that is already in progress
+    void startTokenRefresh();
+
+    /// Refreshes the access token ahead of its expiry, \a expiresIn seconds from now or a default if <= 0
+    void scheduleTokenRefresh(int expiresIn);
+
     QString _user;
     QString _password; // user's password, or access_token for OAuth
     QString _refreshToken; // OAuth _refreshToken, set if OAuth is used.
@@ -142,6 +156,11 @@ protected:
     QSslCertificate _clientSslCertificate;
     bool _keychainMigration = false;
     bool _retryOnKeyChainError = true; // true if we haven't done yet any reading from keychain
+
+    QTimer _refreshTimer; // refreshes the access token before it expires
+    bool _isRefreshingToken = false;
+    bool _emitFetchedAfterRefresh = false; // whether refreshAccessToken() was called
+    QVector<QPair<QPointer<QObject>, std::function<void(bool)>>> _renewalCallbacks;
 };
 
 
@@ -17,6 +17,7 @@
 #include "account.h"
 #include "common/asserts.h"
 #include "common/checksums.h"
+#include "common/iogovernor.h"
 
 #include <csync_private.h>
 #include <csync_rename.h>
@@ -284,7 +285,7 @@ void DiscoverySingleDirectoryJob::start()
 
     lsColJob->setProperties(props);
 
-    QObject::connect(lsColJob, &LsColJob::directoryListingIterated,
+    QObject::connect(lsColJob, &LsColJob::directoryListingEntry,
         this, &DiscoverySingleDirectoryJob::directoryListingIteratedSlot);
     QObject::connect(lsColJob, &LsColJob::finishedWithError, this, &DiscoverySingleDirectoryJob::lsJobFinishedWithErrorSlot);
     QObject::connect(lsColJob, &LsColJob::finishedWithoutError, this, &DiscoverySingleDirectoryJob::lsJobFinishedWithoutErrorSlot);
@@ -300,67 +301,50 @@ void DiscoverySingleDirectoryJob::abort()
     }
 }
 
-static void propertyMapToFileStat(const QMap<QString, QString> &map, csync_file_stat_t *file_stat)
+static void entryToFileStat(const LsColEntry &entry, csync_file_stat_t *file_stat)
 {
-    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
-        QString property = it.key();
-        QString value = it.value();
-        if (property == "resourcetype") {
-            if (value.contains("collection")) {
-                file_stat->type = ItemTypeDirectory;
-            } else {
-                file_stat->type = ItemTypeFile;
-            }
-        } else if (property == "getlastmodified") {
-            file_stat->modtime = oc_httpdate_parse(value.toUtf8());
-        } else if (property == "getcontentlength") {
-            // See #4573, sometimes negative size values are returned
-            bool ok = false;
-            qlonglong ll = value.toLongLong(&ok);
-            if (ok && ll >= 0) {
-                file_stat->size = ll;
-            } else {
-                file_stat->size = 0;
-            }
-        } else if (property == "getetag") {
-            file_stat->etag = Utility::normalizeEtag(value.toUtf8());
-        } else if (property == "id") {
-            file_stat->file_id = value.toUtf8();
-        } else if (property == "downloadURL") {
-            file_stat->directDownloadUrl = value.toUtf8();
-        } else if (property == "dDC") {
-            file_stat->directDownloadCookies = value.toUtf8();
-        } else if (property == "permissions") {
-            file_stat->remotePerm = RemotePermissions(value);
-        } else if (property == "checksums") {
-            file_stat->checksumHeader = findBestChecksum(value.toUtf8());
-        } else if (property == "share-types" && !value.isEmpty()) {
-            // Since QMap is sorted, "share-types" is always after "permissions".
-            if (file_stat->remotePerm.isNull()) {
-                qWarning() << "Server returned a share type, but no permissions?";
-            } else {
-                // S means shared with me.
-                // But for our purpose, we want to know if the file is shared. It does not matter
-                // if we are the owner or not.
-                // Piggy back on the persmission field
-                file_stat->remotePerm.setPermission(RemotePermissions::IsShared);
-            }
+    if (entry.hasResourceType) {
+        file_stat->type = entry.isCollection ? ItemTypeDirectory : ItemTypeFile;
+    }
+    file_stat->modtime = entry.modtime;
+    if (entry.hasContentLength) {
+        // See #4573, sometimes negative size values are returned
+        file_stat->size = qMax<qint64>(entry.contentLength, 0);
+    }
+    if (entry.hasEtag) {
+        file_stat->etag = Utility::normalizeEtag(entry.etag);
+    }
+    file_stat->file_id = entry.fileId;
+    file_stat->directDownloadUrl = entry.downloadUrl;
+    file_stat->directDownloadCookies = entry.downloadCookies;
+    file_stat->remotePerm = entry.remotePerm;
+    if (!entry.checksums.isEmpty()) {
+        file_stat->checksumHeader = findBestChecksum(entry.checksums);
+    }
+    if (entry.isShared) {
+        if (file_stat->remotePerm.isNull()) {
+            qWarning() << "Server returned a share type, but no permissions?";
+        } else {
+            // S means shared with me.
+            // But for our purpose, we want to know if the file is shared. It does not matter
+            // if we are the owner or not.
+            // Piggy back on the persmission field
+            file_stat->remotePerm.setPermission(RemotePermissions::IsShared);
         }
     }
 }
 
-void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(QString file, const QMap<QString, QString> &map)
+void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(QString file, const LsColEntry &entry)
 {
     if (!_ignoredFirst) {
         // The first entry is for the folder itself, we should process it differently.
         _ignoredFirst = true;
-        if (map.contains("permissions")) {
-            RemotePermissions perm(map.value("permissions"));
-            emit firstDirectoryPermissions(perm);
-            _isExternalStorage = perm.hasPermission(RemotePermissions::IsMounted);
+        if (!entry.remotePerm.isNull()) {
+            emit firstDirectoryPermissions(entry.remotePerm);
+            _isExternalStorage = entry.remotePerm.hasPermission(RemotePermissions::IsMounted);
         }
-        if (map.contains("data-fingerprint")) {
-            _dataFingerprint = map.value("data-fingerprint").toUtf8();
+        if (entry.hasDataFingerprint) {
+            _dataFingerprint = entry.dataFingerprint;
             if (_dataFingerprint.isEmpty()) {
                 // Placeholder that means that the server supports the feature even if it did not set one.
                 _dataFingerprint = "[empty]";
@@ -381,7 +365,7 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(QString file, con
         std::unique_ptr<csync_file_stat_t> file_stat(new csync_file_stat_t);
         file_stat->path = file.toUtf8();
         file_stat->size = -1;
-        propertyMapToFileStat(map, file_stat.get());
+        entryToFileStat(entry, file_stat.get());
         if (file_stat->type == ItemTypeDirectory)
             file_stat->size = 0;
         if (file_stat->remotePerm.hasPermission(RemotePermissions::IsShared) && file_stat->etag.isEmpty()) {
@@ -420,11 +404,12 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(QString file, con
     }
 
     //This works in concerto with the RequestEtagJob and the Folder object to check if the remote folder changed.
-    if (map.contains("getetag")) {
-        _etagConcatenation += map.value("getetag");
+    if (entry.hasEtag) {
+        const QString etag = QString::fromUtf8(entry.etag);
+        _etagConcatenation += etag;
 
         if (_firstEtag.isEmpty()) {
-            _firstEtag = map.value("getetag"); // for directory itself
+            _firstEtag = etag; // for directory itself
         }
     }
 }
@@ -724,7 +709,11 @@ void DiscoveryJob::start()
     _csync_ctx->callbacks.vio_userdata = this;
 
     _lastUpdateProgressCallbackCall.invalidate();
-    int ret = csync_update(_csync_ctx);
+    int ret = 0;
+    {
+        IoGovernor::ScopedBackgroundIo backgroundIo;
+        ret = csync_update(_csync_ctx);
+    }
 
     _csync_ctx->callbacks.checkSelectiveSyncNewFolderHook = nullptr;
     _csync_ctx->callbacks.checkSelectiveSyncBlackListHook = nullptr;
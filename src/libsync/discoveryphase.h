@@ -70,7 +70,7 @@ signals:
     void finishedWithResult();
     void finishedWithError(int csyncErrnoCode, const QString &msg);
 private slots:
-    void directoryListingIteratedSlot(QString, const QMap<QString, QString> &);
+    void directoryListingIteratedSlot(QString, const LsColEntry &);
     void lsJobFinishedWithoutErrorSlot();
     void lsJobFinishedWithErrorSlot(QNetworkReply *);
 
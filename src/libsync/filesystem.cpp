@@ -18,6 +18,12 @@
 #include <QFile>
 #include <QFileInfo>
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
 // We use some internals of csync:
 extern "C" int c_utimes(const char *, const struct timeval *);
 
@@ -139,4 +145,43 @@ qint64 FileSystem::getSize(const QString &filename)
 }
 
 
+int FileSystem::openAnonymousFile(const QString &directory)
+{
+#if defined(Q_OS_LINUX) && defined(O_TMPFILE)
+    // Not all file systems support it, EOPNOTSUPP or EISDIR for old kernels
+    const int fd = ::open(QFile::encodeName(directory).constData(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0666);
+    if (fd == -1)
+        qCDebug(lcFileSystem) << "No anonymous files in" << directory << ", errno:" << errno;
+    return fd;
+#else
+    Q_UNUSED(directory)
+    return -1;
+#endif
+}
+
+QString FileSystem::anonymousFilePath(int fd)
+{
+    return qEnvironmentVariable("OWNCLOUD_PROC_FD_DIR", QStringLiteral("/proc/self/fd")) + QLatin1Char('/') + QString::number(fd);
+}
+
+bool FileSystem::linkAnonymousFile(int fd, const QString &fileName, QString *errorString)
+{
+#if defined(Q_OS_LINUX) && defined(O_TMPFILE)
+    // AT_EMPTY_PATH would need CAP_DAC_READ_SEARCH, following the /proc link does not
+    if (linkat(AT_FDCWD, QFile::encodeName(anonymousFilePath(fd)).constData(),
+            AT_FDCWD, QFile::encodeName(fileName).constData(), AT_SYMLINK_FOLLOW) == 0) {
+        return true;
+    }
+    if (errorString)
+        *errorString = QString::fromLocal8Bit(strerror(errno));
+#else
+    Q_UNUSED(fd)
+    Q_UNUSED(fileName)
+    if (errorString)
+        *errorString = QStringLiteral("Anonymous files are not supported");
+#endif
+    qCWarning(lcFileSystem) << "Error linking anonymous file to" << fileName;
+    return false;
+}
+
 } // namespace OCC
@@ -77,6 +77,32 @@ namespace FileSystem {
     bool verifyFileUnchanged(const QString &fileName,
         qint64 previousSize,
         time_t previousMtime);
+
+    /**
+     * @brief Creates a file without a name in \a directory (O_TMPFILE, only on linux)
+     *
+     * It disappears when the returned descriptor is closed, unless it was given
+     * a name with linkAnonymousFile() first. While the descriptor is open the
+     * file can be used through anonymousFilePath().
+     *
+     * @return the file descriptor, -1 if not supported here
+     */
+    int OWNCLOUDSYNC_EXPORT openAnonymousFile(const QString &directory);
+
+    /**
+     * A path under which the file opened as \a fd can be opened again
+     *
+     * It is below /proc/self/fd, or OWNCLOUD_PROC_FD_DIR if that is set.
+     * Opening it fails where /proc is not mounted.
+     */
+    QString OWNCLOUDSYNC_EXPORT anonymousFilePath(int fd);
+
+    /**
+     * @brief Gives the anonymous file \a fd the name \a fileName
+     *
+     * Fails if \a fileName exists already.
+     */
+    bool OWNCLOUDSYNC_EXPORT linkAnonymousFile(int fd, const QString &fileName, QString *errorString);
 }
 
 /** @} */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "imagecache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcImageCache, "nextcloud.sync.imagecache", QtInfoMsg)
+
+// Entries are used without asking the server for this long
+static const qint64 freshnessMsecs = 10 * 60 * 1000;
+
+static const quint32 entryVersion = 1;
+
+ImageCache *ImageCache::instance()
+{
+    static ImageCache cache;
+    return &cache;
+}
+
+ImageCache::ImageCache()
+    : _directory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/images"))
+{
+    bool ok = false;
+    _maxSize = qEnvironmentVariableIntValue("OWNCLOUD_IMAGE_CACHE_SIZE", &ok) * 1024LL * 1024;
+    if (!ok || _maxSize < 0)
+        _maxSize = 50LL * 1024 * 1024;
+}
+
+QString ImageCache::pathForUrl(const QUrl &url) const
+{
+    return _directory + QLatin1Char('/')
+        + QString::fromLatin1(QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex());
+}
+
+ImageCache::Entry ImageCache::lookup(const QUrl &url) const
+{
+    Entry entry;
+    if (_maxSize == 0)
+        return entry;
+
+    QFile file(pathForUrl(url));
+    if (!file.open(QIODevice::ReadOnly))
+        return entry;
+    QDataStream stream(&file);
+    quint32 version = 0;
+    stream >> version;
+    if (version != entryVersion)
+        return entry;
+    stream >> entry.etag >> entry.validatedAt >> entry.data;
+    if (stream.status() != QDataStream::Ok)
+        return Entry();
+    return entry;
+}
+
+bool ImageCache::isFresh(const Entry &entry) const
+{
+    const qint64 age = QDateTime::currentMSecsSinceEpoch() - entry.validatedAt;
+    return entry.isValid() && age >= 0 && age < freshnessMsecs;
+}
+
+void ImageCache::prepareRequest(QNetworkRequest &request, const Entry &cached) const
+{
+    if (cached.isValid() && !cached.etag.isEmpty())
+        request.setRawHeader("If-None-Match", cached.etag);
+}
+
+QByteArray ImageCache::handleReply(const QUrl &url, QNetworkReply *reply, const Entry &cached)
+{
+    const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (httpStatus == 304 && cached.isValid()) {
+        qCDebug(lcImageCache) << "Not modified:" << url;
+        Entry entry = cached;
+        entry.validatedAt = QDateTime::currentMSecsSinceEpoch();
+        store(url, entry);
+        return entry.data;
+    }
+    if (httpStatus != 200)
+        return QByteArray();
+
+    Entry entry;
+    entry.data = reply->readAll();
+    entry.etag = reply->rawHeader("ETag");
+    entry.validatedAt = QDateTime::currentMSecsSinceEpoch();
+    if (entry.isValid())
+        store(url, entry);
+    return entry.data;
+}
+
+void ImageCache::store(const QUrl &url, const Entry &entry)
+{
+    if (_maxSize == 0)
+        return;
+
+    QDir().mkpath(_directory);
+    const QString path = pathForUrl(url);
+    const qint64 oldSize = QFileInfo(path).size();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcImageCache) << "Could not write" << path << file.errorString();
+        return;
+    }
+    QDataStream stream(&file);
+    stream << entryVersion << entry.etag << entry.validatedAt << entry.data;
+    if (!file.commit()) {
+        qCWarning(lcImageCache) << "Could not write" << path << file.errorString();
+        return;
+    }
+
+    if (_currentSize < 0) {
+        _currentSize = 0;
+        const auto entries = QDir(_directory).entryInfoList(QDir::Files);
+        for (const auto &info : entries)
+            _currentSize += info.size();
+    } else {
+        _currentSize += QFileInfo(path).size() - oldSize;
+    }
+    if (_currentSize > _maxSize)
+        evict();
+}
+
+void ImageCache::evict()
+{
+    // Oldest first: the modification time is the last validation
+    const auto entries = QDir(_directory).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    _currentSize = 0;
+    for (const auto &info : entries)
+        _currentSize += info.size();
+
+    int removed = 0;
+    for (const auto &info : entries) {
+        if (_currentSize <= _maxSize * 3 / 4)
+            break;
+        if (QFile::remove(info.filePath())) {
+            _currentSize -= info.size();
+            ++removed;
+        }
+    }
+    qCInfo(lcImageCache) << "Evicted" << removed << "images, the cache now uses" << _currentSize << "bytes";
+}
+
+#ifndef TOKEN_AUTH_ONLY
+void ImageCache::decodeAsync(const QByteArray &data, QObject *receiver, const std::function<void(const QImage &)> &callback)
+{
+    auto runnable = new ImageDecodeRunnable(data);
+    QObject::connect(runnable, &ImageDecodeRunnable::decoded, receiver, callback);
+    QThreadPool::globalInstance()->start(runnable); // takes ownership and deletes
+}
+
+void ImageDecodeRunnable::run()
+{
+    QImage image;
+    if (!_data.isEmpty() && !image.loadFromData(_data))
+        qCWarning(lcImageCache) << "Could not decode image of" << _data.size() << "bytes";
+    emit decoded(image);
+}
+#endif
+}
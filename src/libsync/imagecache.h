@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+#include <QUrl>
+
+#ifndef TOKEN_AUTH_ONLY
+#include <QImage>
+#endif
+
+#include <functional>
+
+#include "owncloudlib.h"
+
+class QNetworkReply;
+class QNetworkRequest;
+
+namespace OCC {
+
+/**
+ * @brief On-disk cache for avatars, thumbnails and icons
+ *
+ * Entries are keyed by URL, so the cache is shared between dialogs and
+ * accounts. An entry is used without asking the server for a few minutes
+ * after it was fetched or revalidated; later it is revalidated with
+ * If-None-Match when the server sent an ETag. The total size is bounded,
+ * the least recently validated entries are evicted first.
+ *
+ * Only used from the main thread.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT ImageCache
+{
+public:
+    struct Entry
+    {
+        QByteArray etag;
+        QByteArray data;
+        qint64 validatedAt = 0; // msecs since epoch
+
+        bool isValid() const { return !data.isEmpty(); }
+    };
+
+    static ImageCache *instance();
+
+    Entry lookup(const QUrl &url) const;
+
+    /// Whether the entry can be used without a request to the server
+    bool isFresh(const Entry &entry) const;
+
+    /// Adds If-None-Match for the cached entry, if any
+    void prepareRequest(QNetworkRequest &request, const Entry &cached) const;
+
+    /**
+     * Returns the image data of a finished reply to a request set up with
+     * prepareRequest(): the cached data for a 304, or the new data for a 200,
+     * which then replaces the cached entry. Empty on errors.
+     */
+    QByteArray handleReply(const QUrl &url, QNetworkReply *reply, const Entry &cached);
+
+#ifndef TOKEN_AUTH_ONLY
+    /// Decodes the image in the thread pool, callback is called in the thread of receiver
+    static void decodeAsync(const QByteArray &data, QObject *receiver, const std::function<void(const QImage &)> &callback);
+#endif
+
+private:
+    ImageCache();
+    QString pathForUrl(const QUrl &url) const;
+    void store(const QUrl &url, const Entry &entry);
+    void evict();
+
+    QString _directory;
+    qint64 _maxSize;
+    qint64 _currentSize = -1; // unknown until the directory is scanned
+};
+
+#ifndef TOKEN_AUTH_ONLY
+/* Decodes an image in the thread pool, see ImageCache::decodeAsync() */
+class ImageDecodeRunnable : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    explicit ImageDecodeRunnable(const QByteArray &data)
+        : _data(data)
+    {
+    }
+    void run() override;
+signals:
+    void decoded(const QImage &image);
+
+private:
+    QByteArray _data;
+};
+#endif
+}
+
+#endif // IMAGECACHE_H
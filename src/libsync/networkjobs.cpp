@@ -32,11 +32,13 @@
 #include <QJsonObject>
 #include <QPainter>
 #include <QPainterPath>
+#include <QMetaMethod>
 
 #include "networkjobs.h"
 #include "account.h"
 #include "owncloudpropagator.h"
 #include "clientsideencryption.h"
+#include "csync.h"
 
 #include "creds/abstractcredentials.h"
 #include "creds/httpcredentials.h"
@@ -183,6 +185,143 @@ static QString readContentsAsString(QXmlStreamReader &reader)
 }
 
 
+namespace {
+enum class KnownProperty {
+    Unknown,
+    ResourceType,
+    LastModified,
+    ContentLength,
+    Etag,
+    Id,
+    FileId,
+    Size,
+    DownloadUrl,
+    DownloadCookies,
+    Permissions,
+    Checksums,
+    ShareTypes,
+    DataFingerprint,
+};
+}
+
+static KnownProperty knownProperty(const QStringRef &name)
+{
+    if (name == QLatin1String("resourcetype"))
+        return KnownProperty::ResourceType;
+    if (name == QLatin1String("getlastmodified"))
+        return KnownProperty::LastModified;
+    if (name == QLatin1String("getcontentlength"))
+        return KnownProperty::ContentLength;
+    if (name == QLatin1String("getetag"))
+        return KnownProperty::Etag;
+    if (name == QLatin1String("id"))
+        return KnownProperty::Id;
+    if (name == QLatin1String("fileid"))
+        return KnownProperty::FileId;
+    if (name == QLatin1String("size"))
+        return KnownProperty::Size;
+    if (name == QLatin1String("downloadURL"))
+        return KnownProperty::DownloadUrl;
+    if (name == QLatin1String("dDC"))
+        return KnownProperty::DownloadCookies;
+    if (name == QLatin1String("permissions"))
+        return KnownProperty::Permissions;
+    if (name == QLatin1String("checksums"))
+        return KnownProperty::Checksums;
+    if (name == QLatin1String("share-types"))
+        return KnownProperty::ShareTypes;
+    if (name == QLatin1String("data-fingerprint"))
+        return KnownProperty::DataFingerprint;
+    return KnownProperty::Unknown;
+}
+
+// The date is plain ascii, avoid a QByteArray for the conversion
+static time_t parseHttpDate(const QString &date)
+{
+    char buf[64];
+    const int len = qMin(date.size(), int(sizeof(buf)) - 1);
+    const QChar *data = date.constData();
+    for (int i = 0; i < len; ++i)
+        buf[i] = data[i].toLatin1();
+    buf[len] = '\0';
+    return oc_httpdate_parse(buf);
+}
+
+// Sets a property that has a text value. Elements with children
+// (resourcetype and share-types) are handled by the callers.
+static void applyTextProperty(KnownProperty property, const QString &value, LsColEntry *entry)
+{
+    bool ok = false;
+    switch (property) {
+    case KnownProperty::LastModified:
+        entry->modtime = parseHttpDate(value);
+        break;
+    case KnownProperty::ContentLength:
+        entry->hasContentLength = true;
+        entry->contentLength = value.toLongLong(&ok);
+        if (!ok)
+            entry->contentLength = -1;
+        break;
+    case KnownProperty::Etag:
+        entry->hasEtag = true;
+        entry->etag = value.toUtf8();
+        break;
+    case KnownProperty::Id:
+        entry->fileId = value.toUtf8();
+        break;
+    case KnownProperty::FileId:
+        entry->numericFileId = value.toUtf8();
+        break;
+    case KnownProperty::Size:
+        entry->size = value.toLongLong(&ok);
+        if (!ok)
+            entry->size = -1;
+        break;
+    case KnownProperty::DownloadUrl:
+        entry->downloadUrl = value.toUtf8();
+        break;
+    case KnownProperty::DownloadCookies:
+        entry->downloadCookies = value.toUtf8();
+        break;
+    case KnownProperty::Permissions:
+        entry->remotePerm = RemotePermissions(value);
+        break;
+    case KnownProperty::Checksums:
+        entry->checksums = value.toUtf8();
+        break;
+    case KnownProperty::DataFingerprint:
+        entry->hasDataFingerprint = true;
+        entry->dataFingerprint = value.toUtf8();
+        break;
+    case KnownProperty::ResourceType:
+    case KnownProperty::ShareTypes:
+    case KnownProperty::Unknown:
+        break;
+    }
+}
+
+// Reads the children of the current element and returns whether there was
+// any child element, and whether one of them was named childName.
+static bool readChildElements(QXmlStreamReader &reader, QLatin1String childName, bool *found)
+{
+    bool any = false;
+    int level = 0;
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType type = reader.readNext();
+        if (type == QXmlStreamReader::StartElement) {
+            level++;
+            any = true;
+            if (reader.name() == childName)
+                *found = true;
+        } else if (type == QXmlStreamReader::EndElement) {
+            level--;
+            if (level < 0)
+                break;
+        }
+    }
+    return any;
+}
+
 LsColXMLParser::LsColXMLParser() = default;
 
 bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
@@ -191,10 +330,15 @@ bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo
     QXmlStreamReader reader(xml);
     reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
 
+    // Building the string map is expensive, only do it for listeners that want it
+    const bool wantPropertyMap = isSignalConnected(QMetaMethod::fromSignal(&LsColXMLParser::directoryListingIterated));
+
     QStringList folders;
     QString currentHref;
     QMap<QString, QString> currentTmpProperties;
     QMap<QString, QString> currentHttp200Properties;
+    LsColEntry currentTmpEntry;
+    LsColEntry currentHttp200Entry;
     bool currentPropsHaveHttp200 = false;
     bool insidePropstat = false;
     bool insideProp = false;
@@ -202,9 +346,9 @@ bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo
 
     while (!reader.atEnd()) {
         QXmlStreamReader::TokenType type = reader.readNext();
-        QString name = reader.name().toString();
         // Start elements with DAV:
         if (type == QXmlStreamReader::StartElement && reader.namespaceUri() == QLatin1String("DAV:")) {
+            const QStringRef name = reader.name();
             if (name == QLatin1String("href")) {
                 // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
                 // but the result will have URL encoding..
@@ -237,19 +381,43 @@ bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo
 
         if (type == QXmlStreamReader::StartElement && insidePropstat && insideProp) {
             // All those elements are properties
-            QString propertyContent = readContentsAsString(reader);
-            if (name == QLatin1String("resourcetype") && propertyContent.contains("collection")) {
+            const KnownProperty property = knownProperty(reader.name());
+            if (wantPropertyMap || property == KnownProperty::Unknown) {
+                const QString name = reader.name().toString();
+                const QString propertyContent = readContentsAsString(reader);
+                if (property == KnownProperty::ResourceType) {
+                    currentTmpEntry.hasResourceType = true;
+                    currentTmpEntry.isCollection = propertyContent.contains("collection");
+                } else if (property == KnownProperty::ShareTypes) {
+                    currentTmpEntry.isShared = !propertyContent.isEmpty();
+                } else if (property == KnownProperty::Unknown) {
+                    currentTmpEntry.otherProperties.insert(name, propertyContent);
+                } else {
+                    applyTextProperty(property, propertyContent, &currentTmpEntry);
+                }
+                if (wantPropertyMap)
+                    currentTmpProperties.insert(name, propertyContent);
+            } else if (property == KnownProperty::ResourceType) {
+                currentTmpEntry.hasResourceType = true;
+                readChildElements(reader, QLatin1String("collection"), &currentTmpEntry.isCollection);
+            } else if (property == KnownProperty::ShareTypes) {
+                bool unused = false;
+                currentTmpEntry.isShared = readChildElements(reader, QLatin1String("share-type"), &unused);
+            } else {
+                applyTextProperty(property, reader.readElementText(QXmlStreamReader::IncludeChildElements), &currentTmpEntry);
+            }
+
+            if (property == KnownProperty::ResourceType && currentTmpEntry.isCollection) {
                 folders.append(currentHref);
-            } else if (name == QLatin1String("size")) {
-                bool ok = false;
-                auto s = propertyContent.toLongLong(&ok);
-                if (ok && fileInfo) {
-                    (*fileInfo)[currentHref].size = s;
+            } else if (property == KnownProperty::Size) {
+                if (currentTmpEntry.size >= 0 && fileInfo) {
+                    (*fileInfo)[currentHref].size = currentTmpEntry.size;
+                }
+            } else if (property == KnownProperty::FileId) {
+                if (fileInfo) {
+                    (*fileInfo)[currentHref].fileId = currentTmpEntry.numericFileId;
                 }
-            } else if (name == QLatin1String("fileid")) {
-                (*fileInfo)[currentHref].fileId = propertyContent.toUtf8();
             }
-            currentTmpProperties.insert(reader.name().toString(), propertyContent);
         }
 
         // End elements with DAV:
@@ -259,15 +427,20 @@ bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo
                     if (currentHref.endsWith('/')) {
                         currentHref.chop(1);
                     }
-                    emit directoryListingIterated(currentHref, currentHttp200Properties);
+                    if (wantPropertyMap)
+                        emit directoryListingIterated(currentHref, currentHttp200Properties);
+                    emit directoryListingEntry(currentHref, currentHttp200Entry);
                     currentHref.clear();
                     currentHttp200Properties.clear();
+                    currentHttp200Entry = LsColEntry();
                 } else if (reader.name() == "propstat") {
                     insidePropstat = false;
                     if (currentPropsHaveHttp200) {
                         currentHttp200Properties = QMap<QString, QString>(currentTmpProperties);
+                        currentHttp200Entry = std::move(currentTmpEntry);
                     }
                     currentTmpProperties.clear();
+                    currentTmpEntry = LsColEntry();
                     currentPropsHaveHttp200 = false;
                 } else if (reader.name() == "prop") {
                     insideProp = false;
@@ -367,8 +540,12 @@ bool LsColJob::finished()
         LsColXMLParser parser;
         connect(&parser, &LsColXMLParser::directoryListingSubfolders,
             this, &LsColJob::directoryListingSubfolders);
-        connect(&parser, &LsColXMLParser::directoryListingIterated,
-            this, &LsColJob::directoryListingIterated);
+        if (isSignalConnected(QMetaMethod::fromSignal(&LsColJob::directoryListingIterated))) {
+            connect(&parser, &LsColXMLParser::directoryListingIterated,
+                this, &LsColJob::directoryListingIterated);
+        }
+        connect(&parser, &LsColXMLParser::directoryListingEntry,
+            this, &LsColJob::directoryListingEntry);
         connect(&parser, &LsColXMLParser::finishedWithError,
             this, &LsColJob::finishedWithError);
         connect(&parser, &LsColXMLParser::finishedWithoutError,
@@ -642,11 +819,30 @@ AvatarJob::AvatarJob(AccountPtr account, const QString &userId, int size, QObjec
 
 void AvatarJob::start()
 {
+    auto cache = ImageCache::instance();
+    _cached = cache->lookup(_avatarUrl);
+    if (cache->isFresh(_cached)) {
+        qCDebug(lcAvatarJob) << "Using cached avatar" << _avatarUrl;
+        QTimer::singleShot(0, this, [this] { emitAvatar(_cached.data); });
+        return;
+    }
+
     QNetworkRequest req;
+    cache->prepareRequest(req, _cached);
     sendRequest("GET", _avatarUrl, req);
     AbstractNetworkJob::start();
 }
 
+void AvatarJob::emitAvatar(const QByteArray &data)
+{
+    ImageCache::decodeAsync(data, this, [this](const QImage &avImage) {
+        if (!avImage.isNull())
+            qCDebug(lcAvatarJob) << "Retrieved Avatar pixmap!";
+        emit avatarPixmap(avImage);
+        deleteLater();
+    });
+}
+
 QImage AvatarJob::makeCircularAvatar(const QImage &baseAvatar)
 {
     int dim = baseAvatar.width();
@@ -669,20 +865,9 @@ QImage AvatarJob::makeCircularAvatar(const QImage &baseAvatar)
 
 bool AvatarJob::finished()
 {
-    int http_result_code = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-
-    QImage avImage;
-
-    if (http_result_code == 200) {
-        QByteArray pngData = reply()->readAll();
-        if (pngData.size()) {
-            if (avImage.loadFromData(pngData)) {
-                qCDebug(lcAvatarJob) << "Retrieved Avatar pixmap!";
-            }
-        }
-    }
-    emit(avatarPixmap(avImage));
-    return true;
+    // Decoding happens in the thread pool, the job deletes itself once it is done
+    emitAvatar(ImageCache::instance()->handleReply(_avatarUrl, reply(), _cached));
+    return false;
 }
 #endif
 
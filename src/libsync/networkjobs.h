@@ -17,9 +17,12 @@
 #define NETWORKJOBS_H
 
 #include "abstractnetworkjob.h"
+#include "common/remotepermissions.h"
+#include "imagecache.h"
 
 #include <QBuffer>
 #include <QUrlQuery>
+#include <ctime>
 #include <functional>
 
 class QUrl;
@@ -71,6 +74,33 @@ struct ExtraFolderInfo {
     qint64 size = -1;
 };
 
+/**
+ * One entry of a PROPFIND reply, with the well-known properties already decoded.
+ *
+ * Properties without a field here are kept as strings in otherProperties.
+ */
+struct LsColEntry
+{
+    bool hasResourceType = false;
+    bool isCollection = false;
+    time_t modtime = 0;
+    bool hasContentLength = false;
+    qint64 contentLength = -1; // -1 if the value could not be parsed
+    qint64 size = -1; // oc:size
+    bool hasEtag = false;
+    QByteArray etag; // as sent by the server, not normalized
+    QByteArray fileId; // oc:id
+    QByteArray numericFileId; // oc:fileid
+    QByteArray downloadUrl;
+    QByteArray downloadCookies; // oc:dDC
+    RemotePermissions remotePerm;
+    QByteArray checksums;
+    bool isShared = false; // oc:share-types is not empty
+    bool hasDataFingerprint = false;
+    QByteArray dataFingerprint;
+    QMap<QString, QString> otherProperties;
+};
+
 /**
  * @brief The LsColJob class
  * @ingroup libsync
@@ -87,7 +117,13 @@ public:
 
 signals:
     void directoryListingSubfolders(const QStringList &items);
+    /**
+     * Each entry with all its properties as strings.
+     *
+     * Only built if something is connected; prefer directoryListingEntry().
+     */
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
+    void directoryListingEntry(const QString &name, const LsColEntry &entry);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
 };
@@ -115,6 +151,7 @@ public:
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
+    void directoryListingEntry(const QString &name, const LsColEntry &entry);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
 
@@ -199,7 +236,10 @@ private slots:
     bool finished() override;
 
 private:
+    void emitAvatar(const QByteArray &data);
+
     QUrl _avatarUrl;
+    ImageCache::Entry _cached;
 };
 #endif
 
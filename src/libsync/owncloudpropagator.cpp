@@ -26,6 +26,7 @@
 #include "common/utility.h"
 #include "account.h"
 #include "common/asserts.h"
+#include "common/tracing.h"
 
 #ifdef Q_OS_WIN
 #include <windef.h>
@@ -41,6 +42,10 @@
 #include <QTimerEvent>
 #include <qmath.h>
 
+OC_TRACE_SEMAPHORE(propagator_schedule);
+OC_TRACE_SEMAPHORE(job_started);
+OC_TRACE_SEMAPHORE(job_finished);
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcPropagator, "nextcloud.sync.propagator", QtInfoMsg)
@@ -87,6 +92,32 @@ int OwncloudPropagator::maximumActiveTransferJob()
     return qMin(3, qCeil(hardMaximumActiveJob() / 2.));
 }
 
+bool OwncloudPropagator::canStartJob(PropagateItemJob::JobClass jobClass)
+{
+    const int hardMaximum = hardMaximumActiveJob();
+    if (_activeJobList.count() >= hardMaximum)
+        return false;
+    if (jobClass == PropagateItemJob::MetadataJob)
+        return true;
+
+    int transfers = 0;
+    int largeTransfers = 0;
+    for (auto job : _activeJobList) {
+        const auto activeClass = job->jobClass();
+        if (activeClass != PropagateItemJob::MetadataJob)
+            ++transfers;
+        if (activeClass == PropagateItemJob::LargeTransferJob)
+            ++largeTransfers;
+    }
+
+    const bool bandwidthLimited = _downloadLimit.fetchAndAddAcquire(0) != 0
+        || _uploadLimit.fetchAndAddAcquire(0) != 0;
+    const int maximumTransfers = bandwidthLimited ? maximumActiveTransferJob() : qMax(1, hardMaximum - 1);
+    if (transfers >= maximumTransfers)
+        return false;
+    return jobClass == PropagateItemJob::SmallTransferJob || largeTransfers < maximumActiveTransferJob();
+}
+
 /* The maximum number of active jobs in parallel  */
 int OwncloudPropagator::hardMaximumActiveJob()
 {
@@ -97,7 +128,26 @@ int OwncloudPropagator::hardMaximumActiveJob()
         return max;
     if (_account->isHttp2Supported())
         return 20;
-    return 6; // (Qt cannot do more anyway)
+    // Qt cannot do more than 6 connections per host and QNAM
+    return 6 * _account->networkAccessManagerPoolSize();
+}
+
+bool PropagateItemJob::scheduleSelfOrChild()
+{
+    if (_state != NotYetStarted) {
+        return false;
+    }
+    if (!propagator()->canStartJob(jobClass())) {
+        return false;
+    }
+    const char *instruction_str = csync_instruction_str(_item->_instruction);
+    qCInfo(lcPropagator) << "Starting" << instruction_str << "propagation of" << _item->_file << "by" << this;
+    if (OC_TRACE_ENABLED(job_started))
+        OC_TRACE(job_started, this, _item->_file.toUtf8().constData(), int(_item->_instruction), _item->_size);
+
+    _state = Running;
+    QMetaObject::invokeMethod(this, "start"); // We could be in a different thread (neon jobs)
+    return true;
 }
 
 PropagateItemJob::~PropagateItemJob()
@@ -276,6 +326,8 @@ void PropagateItemJob::done(SyncFileItem::Status statusArg, const QString &error
         qCWarning(lcPropagator) << "Could not complete propagation of" << _item->destination() << "by" << this << "with status" << _item->_status << "and error:" << _item->_errorString;
     else
         qCInfo(lcPropagator) << "Completed propagation of" << _item->destination() << "by" << this << "with status" << _item->_status;
+    if (OC_TRACE_ENABLED(job_finished))
+        OC_TRACE(job_finished, this, _item->_file.toUtf8().constData(), int(_item->_status), _item->_size);
     emit propagator()->itemCompleted(_item);
     emit finished(_item->_status);
 
@@ -524,6 +576,13 @@ void OwncloudPropagator::setSyncOptions(const SyncOptions &syncOptions)
     _chunkSize = syncOptions._initialChunkSize;
 }
 
+FileSystem::Trash *OwncloudPropagator::trash()
+{
+    if (!_trash)
+        _trash.reset(new FileSystem::Trash);
+    return _trash.data();
+}
+
 bool OwncloudPropagator::localFileNameClash(const QString &relFile)
 {
     bool re = false;
@@ -620,27 +679,14 @@ void OwncloudPropagator::scheduleNextJobImpl()
     // Down-scaling on slow networks? https://github.com/owncloud/client/issues/3382
     // Making sure we do up/down at same time? https://github.com/owncloud/client/issues/1633
 
-    if (_activeJobList.count() < maximumActiveTransferJob()) {
+    // Each job checks the budget of its class, see canStartJob(). One that
+    // can't start is passed over in favor of later jobs, also in other
+    // directories, so large transfers don't hold up the small ones.
+    OC_TRACE(propagator_schedule, _activeJobList.count());
+    if (_activeJobList.count() < hardMaximumActiveJob()) {
         if (_rootJob->scheduleSelfOrChild()) {
             scheduleNextJob();
         }
-    } else if (_activeJobList.count() < hardMaximumActiveJob()) {
-        int likelyFinishedQuicklyCount = 0;
-        // NOTE: Only counts the first 3 jobs! Then for each
-        // one that is likely finished quickly, we can launch another one.
-        // When a job finishes another one will "move up" to be one of the first 3 and then
-        // be counted too.
-        for (int i = 0; i < maximumActiveTransferJob() && i < _activeJobList.count(); i++) {
-            if (_activeJobList.at(i)->isLikelyFinishedQuickly()) {
-                likelyFinishedQuicklyCount++;
-            }
-        }
-        if (_activeJobList.count() < maximumActiveTransferJob() + likelyFinishedQuicklyCount) {
-            qCDebug(lcPropagator) << "Can pump in another request! activeJobs =" << _activeJobList.count();
-            if (_rootJob->scheduleSelfOrChild()) {
-                scheduleNextJob();
-            }
-        }
     }
 }
 
@@ -796,12 +842,16 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     }
 
     // Ask all the running composite jobs if they have something new to schedule.
+    // Jobs that couldn't start yet are asked again, before the jobs behind them.
+    int waitingJobs = 0;
     for (int i = 0; i < _runningJobs.size(); ++i) {
-        ASSERT(_runningJobs.at(i)->_state == Running);
+        ASSERT(_runningJobs.at(i)->_state != Finished);
 
         if (possiblyRunNextJob(_runningJobs.at(i))) {
             return true;
         }
+        if (_runningJobs.at(i)->_state == NotYetStarted)
+            ++waitingJobs;
 
         // If any of the running sub jobs is not parallel, we have to cancel the scheduling
         // of the rest of the list and wait for the blocking job to finish and schedule the next one.
@@ -811,6 +861,11 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
         }
     }
 
+    // Look at most this far ahead for a job that can start
+    if (waitingJobs >= propagator()->hardMaximumActiveJob()) {
+        return false;
+    }
+
     // Now it's our turn, check if we have something left to do.
     // First, convert a task to a job if necessary
     while (_jobsToDo.isEmpty() && !_tasksToDo.isEmpty()) {
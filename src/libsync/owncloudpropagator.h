@@ -28,6 +28,7 @@
 #include "csync_util.h"
 #include "syncfileitem.h"
 #include "common/syncjournaldb.h"
+#include "common/filesystembase.h"
 #include "bandwidthmanager.h"
 #include "accountfwd.h"
 #include "syncoptions.h"
@@ -186,18 +187,19 @@ public:
     }
     ~PropagateItemJob();
 
-    bool scheduleSelfOrChild() override
-    {
-        if (_state != NotYetStarted) {
-            return false;
-        }
-        const char *instruction_str = csync_instruction_str(_item->_instruction);
-        qCInfo(lcPropagator) << "Starting" << instruction_str << "propagation of" << _item->_file << "by" << this;
+    /** The concurrency budget a job counts against, see OwncloudPropagator::canStartJob() */
+    enum JobClass {
+        MetadataJob,
+        SmallTransferJob,
+        LargeTransferJob
+    };
+    virtual JobClass jobClass() { return MetadataJob; }
 
-        _state = Running;
-        QMetaObject::invokeMethod(this, "start"); // We could be in a different thread (neon jobs)
-        return true;
-    }
+    /** Starts the job, unless the budget of its class is used up.
+     *
+     * The job then stays NotYetStarted and its composite job looks further.
+     */
+    bool scheduleSelfOrChild() override;
 
     SyncFileItemPtr _item;
 
@@ -269,7 +271,8 @@ private slots:
     bool possiblyRunNextJob(PropagatorJob *next)
     {
         if (next->_state == NotYetStarted) {
-            connect(next, &PropagatorJob::finished, this, &PropagatorCompositeJob::slotSubJobFinished);
+            // A job can be asked several times when its class has no budget left
+            connect(next, &PropagatorJob::finished, this, &PropagatorCompositeJob::slotSubJobFinished, Qt::UniqueConnection);
         }
         return next->scheduleSelfOrChild();
     }
@@ -393,6 +396,9 @@ public:
     const SyncOptions &syncOptions() const;
     void setSyncOptions(const SyncOptions &syncOptions);
 
+    /** Used by the local removals of this sync when moving files to the trash */
+    FileSystem::Trash *trash();
+
     QAtomicInt _downloadLimit;
     QAtomicInt _uploadLimit;
     BandwidthManager _bandwidthManager;
@@ -423,9 +429,18 @@ public:
      */
     QHash<QString, quint64> _folderQuota;
 
-    /* the maximum number of jobs using bandwidth (uploads or downloads, in parallel) */
+    /* the maximum number of large uploads or downloads in parallel */
     int maximumActiveTransferJob();
 
+    /** Whether a job of the class may start with the current _activeJobList
+     *
+     * All jobs share hardMaximumActiveJob(). Large transfers get at most
+     * maximumActiveTransferJob() of it, small transfers all but one slot,
+     * which stays free for metadata jobs like MKCOL, MOVE and DELETE.
+     * With a bandwidth limit, all transfers share maximumActiveTransferJob().
+     */
+    bool canStartJob(PropagateItemJob::JobClass jobClass);
+
     /** The size to use for upload chunks.
      *
      * Will be dynamically adjusted after each chunk upload finishes
@@ -552,6 +567,7 @@ private:
     AccountPtr _account;
     QScopedPointer<PropagateDirectory> _rootJob;
     SyncOptions _syncOptions;
+    QScopedPointer<FileSystem::Trash> _trash;
 };
 
 
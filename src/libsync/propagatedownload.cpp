@@ -42,6 +42,9 @@ namespace OCC {
 Q_LOGGING_CATEGORY(lcGetJob, "nextcloud.sync.networkjob.get", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateDownload, "nextcloud.sync.propagator.download", QtInfoMsg)
 
+// Downloads up to this size are written to an anonymous file, see startDownload()
+static const quint64 anonymousTmpFileMaxSize = 10 * 1024 * 1024;
+
 // Always coming in with forward slashes.
 // In csync_excluded_no_ctx we ignore all files with longer than 254 chars
 // This function also adds a dot at the beginning of the filename to hide the file on OS X and Linux
@@ -142,6 +145,7 @@ void GETFileJob::start()
 void GETFileJob::newReplyHook(QNetworkReply *reply)
 {
     reply->setReadBufferSize(16 * 1024); // keep low so we can easier limit the bandwidth
+    _saveBodyToFile = false;
 
     connect(reply, &QNetworkReply::metaDataChanged, this, &GETFileJob::slotMetaDataChanged);
     connect(reply, &QIODevice::readyRead, this, &GETFileJob::slotReadyRead);
@@ -266,7 +270,7 @@ void GETFileJob::slotReadyRead()
     int bufferSize = qMin(1024 * 8ll, reply()->bytesAvailable());
     QByteArray buffer(bufferSize, Qt::Uninitialized);
 
-    while (reply()->bytesAvailable() > 0) {
+    while (reply()->bytesAvailable() > 0 && _saveBodyToFile) {
         if (_bandwidthChoked) {
             qCWarning(lcGetJob) << "Download choked";
             break;
@@ -300,7 +304,11 @@ void GETFileJob::slotReadyRead()
         }
     }
 
-    if (reply()->isFinished() && reply()->bytesAvailable() == 0) {
+    // The request is sent again with renewed credentials, keep going then
+    if (isRenewingCredentials())
+        return;
+
+    if (reply()->isFinished() && (reply()->bytesAvailable() == 0 || !_saveBodyToFile)) {
         qCDebug(lcGetJob) << "Actually finished!";
         if (_bandwidthManager) {
             _bandwidthManager->unregisterDownloadJob(this);
@@ -444,14 +452,34 @@ void PropagateDownloadFile::startDownload()
         }
     }
 
-    if (tmpFileName.isEmpty()) {
-        tmpFileName = createDownloadTmpFileName(_item->_file);
+    // Small downloads that don't resume go to a file without a name which only
+    // appears once it is complete: no temporary file for the watcher to see or
+    // to be left behind by a crash. Larger ones keep a named one to be resumable.
+    if (_anonymousTmpFd != -1) {
+        removeTmpFile(); // from a failed direct download
+    }
+    if (tmpFileName.isEmpty() && !_isEncrypted && _item->_size < anonymousTmpFileMaxSize) {
+        _anonymousTmpFd = FileSystem::openAnonymousFile(QFileInfo(propagator()->getFilePath(_item->_file)).path());
     }
 
-    _tmpFile.setFileName(propagator()->getFilePath(tmpFileName));
-    if (!_tmpFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
-        done(SyncFileItem::NormalError, _tmpFile.errorString());
-        return;
+    if (_anonymousTmpFd != -1) {
+        _tmpFile.setFileName(FileSystem::anonymousFilePath(_anonymousTmpFd));
+        if (!_tmpFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
+            // Without /proc the descriptor can't be opened again
+            qCInfo(lcPropagateDownload) << "Could not open the anonymous file" << _tmpFile.fileName()
+                                        << _tmpFile.errorString() << ", using a named temporary file";
+            removeTmpFile();
+        }
+    }
+    if (_anonymousTmpFd == -1) {
+        if (tmpFileName.isEmpty()) {
+            tmpFileName = createDownloadTmpFileName(_item->_file);
+        }
+        _tmpFile.setFileName(propagator()->getFilePath(tmpFileName));
+        if (!_tmpFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
+            done(SyncFileItem::NormalError, _tmpFile.errorString());
+            return;
+        }
     }
 
     FileSystem::setFileHidden(_tmpFile.fileName(), true);
@@ -483,13 +511,13 @@ void PropagateDownloadFile::startDownload()
 
         // Remove the temporary, if empty.
         if (_resumeStart == 0) {
-            _tmpFile.remove();
+            removeTmpFile();
         }
 
         return;
     }
 
-    {
+    if (_anonymousTmpFd == -1) {
         SyncJournalDb::DownloadInfo pi;
         pi._etag = _item->_etag;
         pi._tmpfile = tmpFileName;
@@ -573,8 +601,7 @@ void PropagateDownloadFile::slotGetFinished()
         // Don't keep the temporary file if it is empty or we
         // used a bad range header or the file's not on the server anymore.
         if (_tmpFile.size() == 0 || badRangeHeader || fileNotFound) {
-            _tmpFile.close();
-            FileSystem::remove(_tmpFile.fileName());
+            removeTmpFile();
             propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
         }
 
@@ -643,7 +670,7 @@ void PropagateDownloadFile::slotGetFinished()
         // Strange bug with broken webserver or webfirewall https://github.com/owncloud/client/issues/3373#issuecomment-122672322
         // This happened when trying to resume a file. The Content-Range header was files, Content-Length was == 0
         qCDebug(lcPropagateDownload) << bodySize << _item->_size << _tmpFile.size() << job->resumeStart();
-        FileSystem::remove(_tmpFile.fileName());
+        removeTmpFile();
         done(SyncFileItem::SoftError, QLatin1String("Broken webserver returning empty content length for non-empty file on resume"));
         return;
     }
@@ -656,7 +683,7 @@ void PropagateDownloadFile::slotGetFinished()
     }
 
     if (_tmpFile.size() == 0 && _item->_size > 0) {
-        FileSystem::remove(_tmpFile.fileName());
+        removeTmpFile();
         done(SyncFileItem::NormalError,
             tr("The downloaded file is empty despite that the server announced it should have been %1.")
                 .arg(Utility::octetsToString(_item->_size)));
@@ -700,7 +727,7 @@ void PropagateDownloadFile::slotGetFinished()
 
 void PropagateDownloadFile::slotChecksumFail(const QString &errMsg)
 {
-    FileSystem::remove(_tmpFile.fileName());
+    removeTmpFile();
     propagator()->_anotherSyncNeeded = true;
     done(SyncFileItem::SoftError, errMsg); // tr("The file downloaded with a broken checksum, will be redownloaded."));
 }
@@ -840,6 +867,35 @@ void PropagateDownloadFile::contentChecksumComputed(const QByteArray &checksumTy
     }
 }
 
+void PropagateDownloadFile::removeTmpFile()
+{
+    _tmpFile.close();
+    if (_anonymousTmpFd != -1) {
+#ifdef Q_OS_UNIX
+        ::close(_anonymousTmpFd);
+#endif
+        _anonymousTmpFd = -1;
+    } else {
+        FileSystem::remove(_tmpFile.fileName());
+    }
+}
+
+bool PropagateDownloadFile::linkTmpFile(const QString &fileName, QString *error)
+{
+    if (!FileSystem::fileExists(fileName))
+        return FileSystem::linkAnonymousFile(_anonymousTmpFd, fileName, error);
+
+    // linkat() can't replace, link it next to the file and rename that over it
+    const QString tmpFileName = propagator()->getFilePath(createDownloadTmpFileName(_item->_file));
+    if (!FileSystem::linkAnonymousFile(_anonymousTmpFd, tmpFileName, error))
+        return false;
+    if (!FileSystem::uncheckedRenameReplace(tmpFileName, fileName, error)) {
+        FileSystem::remove(tmpFileName);
+        return false;
+    }
+    return true;
+}
+
 void PropagateDownloadFile::downloadFinished()
 {
     QString fn = propagator()->getFilePath(_item->_file);
@@ -864,7 +920,9 @@ void PropagateDownloadFile::downloadFinished()
     FileSystem::setModTime(_tmpFile.fileName(), _item->_modtime);
     // We need to fetch the time again because some file systems such as FAT have worse than a second
     // Accuracy, and we really need the time from the file system. (#3103)
-    _item->_modtime = FileSystem::getModTime(_tmpFile.fileName());
+    // The stat of an anonymous file's path would be the one of the /proc link, see below.
+    if (_anonymousTmpFd == -1)
+        _item->_modtime = FileSystem::getModTime(_tmpFile.fileName());
 
     if (FileSystem::fileExists(fn)) {
         // Preserve the existing file permissions.
@@ -893,7 +951,10 @@ void PropagateDownloadFile::downloadFinished()
     QString error;
     emit propagator()->touchedFile(fn);
     // The fileChanged() check is done above to generate better error messages.
-    if (!FileSystem::uncheckedRenameReplace(_tmpFile.fileName(), fn, &error)) {
+    const bool moved = _anonymousTmpFd != -1
+        ? linkTmpFile(fn, &error)
+        : FileSystem::uncheckedRenameReplace(_tmpFile.fileName(), fn, &error);
+    if (!moved) {
         qCWarning(lcPropagateDownload) << QString("Rename failed: %1 => %2").arg(_tmpFile.fileName()).arg(fn);
 
         // If we moved away the original file due to a conflict but can't
@@ -921,6 +982,11 @@ void PropagateDownloadFile::downloadFinished()
     }
     FileSystem::setFileHidden(fn, false);
 
+    if (_anonymousTmpFd != -1) {
+        removeTmpFile(); // only closes it now that it has a name
+        _item->_modtime = FileSystem::getModTime(fn);
+    }
+
     // Maybe we downloaded a newer version of the file than we thought we would...
     // Get up to date information for the journal.
     _item->_size = FileSystem::getSize(fn);
@@ -973,6 +1039,13 @@ void PropagateDownloadFile::slotDownloadProgress(qint64 received, qint64)
 }
 
 
+PropagateDownloadFile::~PropagateDownloadFile()
+{
+    // A named temporary file is kept for resuming the download later
+    if (_anonymousTmpFd != -1)
+        removeTmpFile();
+}
+
 void PropagateDownloadFile::abort(PropagatorJob::AbortType abortType)
 {
     if (_job && _job->reply())
@@ -67,7 +67,7 @@ public:
     void start() override;
     bool finished() override
     {
-        if (reply()->bytesAvailable()) {
+        if (_saveBodyToFile && reply()->bytesAvailable()) {
             return false;
         } else {
             if (_bandwidthManager) {
@@ -159,11 +159,13 @@ public:
         , _deleteExisting(false)
     {
     }
+    ~PropagateDownloadFile();
     void start() override;
     qint64 committedDiskSpace() const override;
 
     // We think it might finish quickly because it is a small file.
     bool isLikelyFinishedQuickly() override { return _item->_size < propagator()->smallFileSize(); }
+    JobClass jobClass() override { return isLikelyFinishedQuickly() ? SmallTransferJob : LargeTransferJob; }
 
     /**
      * Whether an existing folder with the same name may be deleted before
@@ -199,11 +201,16 @@ private slots:
 private:
     void startAfterIsEncryptedIsChecked();
     void deleteExistingFolder();
+    /// Closes or removes the temporary file, the downloaded data is gone
+    void removeTmpFile();
+    /// Gives the anonymous temporary file its final name
+    bool linkTmpFile(const QString &fileName, QString *error);
 
     quint64 _resumeStart;
     qint64 _downloadProgress;
     QPointer<GETFileJob> _job;
     QFile _tmpFile;
+    int _anonymousTmpFd = -1; // _tmpFile is opened through it if it isn't -1
     bool _deleteExisting;
     bool _isEncrypted = false;
     EncryptedFile _encryptedInfo;
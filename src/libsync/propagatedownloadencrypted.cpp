@@ -65,7 +65,8 @@ void PropagateDownloadEncrypted::checkFolderId(const QStringList &list)
   const ExtraFolderInfo &folderInfo = job->_folderInfos.value(folderId);
 
   // Now that we have the folder-id we need it's JSON metadata
-  auto metadataJob = new GetMetadataApiJob(_propagator->account(), folderInfo.fileId);
+  _folderId = folderInfo.fileId;
+  auto metadataJob = new GetMetadataApiJob(_propagator->account(), _folderId);
   connect(metadataJob, &GetMetadataApiJob::jsonReceived,
           this, &PropagateDownloadEncrypted::checkFolderEncryptedMetadata);
 
@@ -76,9 +77,14 @@ void PropagateDownloadEncrypted::checkFolderEncryptedMetadata(const QJsonDocumen
 {
   qCDebug(lcPropagateDownloadEncrypted) << "Metadata Received reading" <<
                                            csync_instruction_str(_item->_instruction) << _item->_file << _item->_encryptedFileName;
+  FolderMetadata::setupAsync(_propagator->account(), _folderId, json, -1, this,
+      [this](const FolderMetadata &metadata) { findEncryptedFile(metadata); });
+}
+
+void PropagateDownloadEncrypted::findEncryptedFile(const FolderMetadata &metadata)
+{
   const QString filename = _info.fileName();
-  auto meta = new FolderMetadata(_propagator->account(), json.toJson(QJsonDocument::Compact));
-  const QVector<EncryptedFile> files = meta->files();
+  const QVector<EncryptedFile> files = metadata.files();
 
   const QString encryptedFilename = _item->_instruction == CSYNC_INSTRUCTION_NEW ?
               _item->_file.section(QLatin1Char('/'), -1) :
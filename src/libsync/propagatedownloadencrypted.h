@@ -36,9 +36,12 @@ signals:
   void decryptionFinished();
 
 private:
+  void findEncryptedFile(const FolderMetadata &metadata);
+
   OwncloudPropagator *_propagator;
   SyncFileItemPtr _item;
   QFileInfo _info;
+  QByteArray _folderId;
   EncryptedFile _encryptedInfo;
   QString _errorString;
 };
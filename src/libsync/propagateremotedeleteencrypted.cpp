@@ -70,9 +70,12 @@ void PropagateRemoteDeleteEncrypted::slotFolderEncryptedMetadataReceived(const Q
 
     qCDebug(PROPAGATE_REMOVE_ENCRYPTED) << "Metadata Received, Preparing it for the new file.";
 
-    // Encrypt File!
-    FolderMetadata metadata(_propagator->account(), json.toJson(QJsonDocument::Compact), statusCode);
+    FolderMetadata::setupAsync(_propagator->account(), _folderId, json, statusCode, this,
+        [this](const FolderMetadata &metadata) { removeFileFromMetadata(metadata); });
+}
 
+void PropagateRemoteDeleteEncrypted::removeFileFromMetadata(FolderMetadata metadata)
+{
     QFileInfo info(_propagator->_localDir + QDir::separator() + _item->_file);
     const QString fileName = info.fileName();
 
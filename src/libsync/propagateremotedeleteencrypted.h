@@ -9,6 +9,7 @@
 namespace OCC {
 
 class OwncloudPropagator;
+class FolderMetadata;
 class PropagateRemoteDeleteEncrypted : public QObject
 {
     Q_OBJECT
@@ -25,6 +26,7 @@ private:
     void slotTryLock(const QByteArray &folderId);
     void slotFolderLockedSuccessfully(const QByteArray &fileId, const QByteArray &token);
     void slotFolderEncryptedMetadataReceived(const QJsonDocument &json, int statusCode);
+    void removeFileFromMetadata(FolderMetadata metadata);
     void unlockFolder();
     void taskFailed();
 
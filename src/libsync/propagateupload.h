@@ -252,6 +252,7 @@ public:
     void startUploadFile();
     void callUnlockFolder();
     bool isLikelyFinishedQuickly() override { return _item->_size < propagator()->smallFileSize(); }
+    JobClass jobClass() override { return isLikelyFinishedQuickly() ? SmallTransferJob : LargeTransferJob; }
 
 private slots:
     void slotComputeContentChecksum();
@@ -124,9 +124,16 @@ void PropagateUploadEncrypted::slotFolderEncryptedMetadataReceived(const QJsonDo
 {
   qCDebug(lcPropagateUploadEncrypted) << "Metadata Received, Preparing it for the new file." << json.toVariant();
 
-  // Encrypt File!
-  _metadata = new FolderMetadata(_propagator->account(), json.toJson(QJsonDocument::Compact), statusCode);
+  FolderMetadata::setupAsync(_propagator->account(), _folderId, json, statusCode, this,
+      [this, statusCode](const FolderMetadata &metadata) {
+          _metadata = new FolderMetadata(metadata);
+          encryptFile(statusCode);
+      });
+}
 
+void PropagateUploadEncrypted::encryptFile(int statusCode)
+{
+  // Encrypt File!
   QFileInfo info(_propagator->_localDir + QDir::separator() + _item->_file);
   const QString fileName = info.fileName();
 
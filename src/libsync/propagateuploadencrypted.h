@@ -63,6 +63,8 @@ signals:
     void folerNotEncrypted();
 
 private:
+  void encryptFile(int statusCode);
+
   OwncloudPropagator *_propagator;
   SyncFileItemPtr _item;
 
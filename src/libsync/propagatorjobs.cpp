@@ -29,6 +29,11 @@
 #include <QDateTime>
 #include <qstack.h>
 #include <QCoreApplication>
+#include <QMutex>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 #include <time.h>
 
@@ -45,67 +50,146 @@ QByteArray localFileIdFromFullId(const QByteArray &id)
 }
 
 /**
- * Code inspired from Qt5's QDir::removeRecursively
- * The code will update the database in case of error.
- * If everything goes well (no error, returns true), the caller is responsible for removing the entries
- * in the database.  But in case of error, we need to remove the entries from the database of the files
- * that were deleted.
+ * Removes the directory \a absolute with all its contents, in a worker thread.
+ *
+ * The tree is listed first, then the files are removed in parallel and the
+ * directories deepest first. Only the failures are returned, as paths relative
+ * to \a absolute with the error message; an empty path stands for \a absolute.
  *
- * \a path is relative to propagator()->_localDir + _item->_file and should start with a slash
+ * Nothing more is removed once \a aborted is set.
  */
-bool PropagateLocalRemove::removeRecursively(const QString &path)
+static PropagateLocalRemove::RemoveFailures removeRecursivelyNow(const QString &absolute, QSharedPointer<QAtomicInt> aborted)
 {
-    bool success = true;
-    QString absolute = propagator()->_localDir + _item->_file + path;
-    QDirIterator di(absolute, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
-
-    QVector<QPair<QString, bool>> deleted;
-
-    while (di.hasNext()) {
-        di.next();
-        const QFileInfo &fi = di.fileInfo();
-        bool ok = false;
-        // The use of isSymLink here is okay:
-        // we never want to go into this branch for .lnk files
-        bool isDir = fi.isDir() && !fi.isSymLink() && !FileSystem::isJunction(fi.absoluteFilePath());
-        if (isDir) {
-            ok = removeRecursively(path + QLatin1Char('/') + di.fileName()); // recursive
-        } else {
-            QString removeError;
-            ok = FileSystem::remove(di.filePath(), &removeError);
-            if (!ok) {
-                _error += PropagateLocalRemove::tr("Error removing '%1': %2;").arg(QDir::toNativeSeparators(di.filePath()), removeError) + " ";
-                qCWarning(lcPropagateLocalRemove) << "Error removing " << di.filePath() << ':' << removeError;
+    QStringList files;
+    QStringList dirs;
+    QStringList toList(absolute);
+    while (!toList.isEmpty()) {
+        QDirIterator di(toList.takeLast(), QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        while (di.hasNext()) {
+            di.next();
+            const QFileInfo &fi = di.fileInfo();
+            // The use of isSymLink here is okay:
+            // we never want to go into this branch for .lnk files
+            bool isDir = fi.isDir() && !fi.isSymLink() && !FileSystem::isJunction(fi.absoluteFilePath());
+            if (isDir) {
+                dirs.append(di.filePath());
+                toList.append(di.filePath());
+            } else {
+                files.append(di.filePath());
             }
         }
-        if (success && !ok) {
-            // We need to delete the entries from the database now from the deleted vector
-            foreach (const auto &it, deleted) {
-                propagator()->_journal->deleteFileRecord(_item->_originalFile + path + QLatin1Char('/') + it.first,
-                    it.second);
-            }
-            success = false;
-            deleted.clear();
+    }
+
+    QMutex mutex;
+    PropagateLocalRemove::RemoveFailures failures;
+    const int prefixLength = absolute.size() + 1;
+    QtConcurrent::blockingMap(files, [&](const QString &file) {
+        if (aborted->load())
+            return;
+        QString removeError;
+        if (!FileSystem::remove(file, &removeError)) {
+            qCWarning(lcPropagateLocalRemove) << "Error removing " << file << ':' << removeError;
+            QMutexLocker locker(&mutex);
+            failures.append(qMakePair(file.mid(prefixLength), removeError));
         }
-        if (success) {
-            deleted.append(qMakePair(di.fileName(), isDir));
+    });
+
+    // Folders that still contain something are not attempted, nor reported
+    QSet<QString> notEmpty;
+    auto markParents = [&](QString path) {
+        while (path.size() > absolute.size()) {
+            path = path.left(path.lastIndexOf(QLatin1Char('/')));
+            notEmpty.insert(path);
         }
-        if (!success && ok) {
-            // This succeeded, so we need to delete it from the database now because the caller won't
-            propagator()->_journal->deleteFileRecord(_item->_originalFile + path + QLatin1Char('/') + di.fileName(),
-                isDir);
+    };
+    for (const auto &failure : failures)
+        markParents(absolute + QLatin1Char('/') + failure.first);
+
+    // Children have longer paths than their parents, remove them first
+    dirs.append(absolute);
+    std::sort(dirs.begin(), dirs.end(), [](const QString &a, const QString &b) { return a.size() > b.size(); });
+    for (const auto &dir : dirs) {
+        if (aborted->load())
+            break;
+        if (notEmpty.contains(dir))
+            continue;
+        if (!QDir().rmdir(dir)) {
+            qCWarning(lcPropagateLocalRemove) << "Error removing folder" << dir;
+            failures.append(qMakePair(dir.mid(prefixLength), QString()));
+            markParents(dir);
         }
     }
-    if (success) {
-        success = QDir().rmdir(absolute);
-        if (!success) {
-            _error += PropagateLocalRemove::tr("Could not remove folder '%1'")
-                          .arg(QDir::toNativeSeparators(absolute))
+    return failures;
+}
+
+void PropagateLocalRemove::slotRemoveRecursivelyFinished()
+{
+    const auto failures = _watcher.result();
+    if (failures.isEmpty()) {
+        finalize();
+        return;
+    }
+
+    // Keep the records of what is still there, so the removal is attempted again
+    // by the next sync. Everything else goes with one recursive delete.
+    const QString root = _item->_originalFile;
+    QString error;
+    QMap<QString, SyncJournalFileRecord> kept;
+    for (const auto &failure : failures) {
+        if (failure.second.isEmpty()) {
+            error += tr("Could not remove folder '%1'")
+                         .arg(QDir::toNativeSeparators(propagator()->_localDir + _item->_file + QLatin1Char('/') + failure.first))
                 + " ";
-            qCWarning(lcPropagateLocalRemove) << "Error removing folder" << absolute;
+        } else {
+            error += tr("Error removing '%1': %2;")
+                         .arg(QDir::toNativeSeparators(propagator()->_localDir + _item->_file + QLatin1Char('/') + failure.first), failure.second)
+                + " ";
+        }
+        QString path = failure.first.isEmpty() ? root : root + QLatin1Char('/') + failure.first;
+        while (!kept.contains(path)) {
+            SyncJournalFileRecord rec;
+            propagator()->_journal->getFileRecord(path, &rec);
+            kept.insert(path, rec);
+            if (path == root)
+                break;
+            path = path.left(path.lastIndexOf(QLatin1Char('/')));
+        }
+    }
+    propagator()->_journal->deleteFileRecord(root, true);
+    for (const auto &rec : kept) {
+        if (rec.isValid())
+            propagator()->_journal->setFileRecord(rec);
+    }
+    propagator()->_journal->commit("Local remove");
+    done(SyncFileItem::NormalError, error);
+}
+
+void PropagateLocalRemove::abort(PropagatorJob::AbortType abortType)
+{
+    // The journal is left alone, the next sync sees what is still there
+    _removeAborted->store(1);
+    disconnect(&_watcher, &QFutureWatcherBase::finished,
+        this, &PropagateLocalRemove::slotRemoveRecursivelyFinished);
+    if (_watcher.isRunning()) {
+        if (abortType == AbortType::Asynchronous) {
+            connect(&_watcher, &QFutureWatcherBase::finished, this, [this] { emit abortFinished(); });
+            return;
         }
+        // Nothing may be removed after a synchronous abort returned
+        _watcher.waitForFinished();
+    }
+
+    if (abortType == AbortType::Asynchronous) {
+        emit abortFinished();
     }
-    return success;
+}
+
+void PropagateLocalRemove::finalize()
+{
+    propagator()->reportProgress(*_item, 0);
+    propagator()->_journal->deleteFileRecord(_item->_originalFile, _item->isDirectory());
+    propagator()->_journal->commit("Local remove");
+    done(SyncFileItem::Success);
 }
 
 void PropagateLocalRemove::start()
@@ -126,15 +210,18 @@ void PropagateLocalRemove::start()
 
     QString removeError;
     if (_moveToTrash) {
-        if ((QDir(filename).exists() || FileSystem::fileExists(filename))
-            && !FileSystem::moveToTrash(filename, &removeError)) {
+        // Only check whether the file is still there if moving it failed
+        if (!propagator()->trash()->move(filename, &removeError)
+            && (QDir(filename).exists() || FileSystem::fileExists(filename))) {
             done(SyncFileItem::NormalError, removeError);
             return;
         }
     } else {
         if (_item->isDirectory()) {
-            if (QDir(filename).exists() && !removeRecursively(QString())) {
-                done(SyncFileItem::NormalError, _error);
+            if (QDir(filename).exists()) {
+                connect(&_watcher, &QFutureWatcherBase::finished,
+                    this, &PropagateLocalRemove::slotRemoveRecursivelyFinished);
+                _watcher.setFuture(QtConcurrent::run(removeRecursivelyNow, filename, _removeAborted));
                 return;
             }
         } else {
@@ -145,10 +232,7 @@ void PropagateLocalRemove::start()
             }
         }
     }
-    propagator()->reportProgress(*_item, 0);
-    propagator()->_journal->deleteFileRecord(_item->_originalFile, _item->isDirectory());
-    propagator()->_journal->commit("Local remove");
-    done(SyncFileItem::Success);
+    finalize();
 }
 
 void PropagateLocalMkdir::start()
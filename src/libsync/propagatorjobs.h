@@ -17,6 +17,8 @@
 
 #include "owncloudpropagator.h"
 #include <QFile>
+#include <QFutureWatcher>
+#include <QSharedPointer>
 
 namespace OCC {
 
@@ -37,13 +39,23 @@ class PropagateLocalRemove : public PropagateItemJob
 public:
     PropagateLocalRemove(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
         : PropagateItemJob(propagator, item)
+        , _removeAborted(new QAtomicInt(0))
     {
     }
     void start() override;
+    void abort(PropagatorJob::AbortType abortType) override;
+
+    /// Paths that could not be removed, with the error message
+    using RemoveFailures = QVector<QPair<QString, QString>>;
+
+private slots:
+    void slotRemoveRecursivelyFinished();
 
 private:
-    bool removeRecursively(const QString &path);
-    QString _error;
+    void finalize();
+
+    QFutureWatcher<RemoveFailures> _watcher;
+    QSharedPointer<QAtomicInt> _removeAborted; // shared with the worker, which may outlive the job
     bool _moveToTrash;
 };
 
@@ -26,7 +26,9 @@
 #include "propagateremotedelete.h"
 #include "propagatedownload.h"
 #include "common/asserts.h"
+#include "common/iogovernor.h"
 #include "configfile.h"
+#include "syncrecorder.h"
 
 
 #ifdef Q_OS_WIN
@@ -413,6 +415,20 @@ int SyncEngine::treewalkFile(csync_file_stat_t *file, csync_file_stat_t *other,
         }
     }
 
+    // Unchanged on both sides: the item would be dropped right away, only
+    // record the path for postSyncCleanup().
+    if (instruction == CSYNC_INSTRUCTION_NONE
+        && file->error_status == CSYNC_STATUS_OK
+        && (!other || other->instruction == CSYNC_INSTRUCTION_NONE)
+        && !_syncItemMap.contains(fileUtf8)) {
+        _seenFiles.insert(fileUtf8);
+        if (!renameTarget.isEmpty())
+            _seenFiles.insert(renameTarget);
+        if (file->type != ItemTypeDirectory)
+            _hasNoneFiles = true;
+        return 0;
+    }
+
     // key is the handle that the SyncFileItem will have in the map.
     QString key = fileUtf8;
     if (instruction == CSYNC_INSTRUCTION_RENAME) {
@@ -852,12 +868,29 @@ void SyncEngine::startSync()
     _excludedFiles->setExcludeConflictFiles(!_account->capabilities().uploadConflictFiles());
 
     _csync_ctx->read_remote_from_db = true;
+    _csync_ctx->discovery_memory_budget = _syncOptions._discoveryMemoryBudget;
+    _csync_ctx->sync_mode = _syncOptions._syncMode;
+    if (_syncOptions._syncMode == SyncMode::DownloadOnly) {
+        qCInfo(lcEngine) << "Download only: local changes will be reverted";
+    } else if (_syncOptions._syncMode == SyncMode::UploadOnly) {
+        qCInfo(lcEngine) << "Upload only: remote changes will be ignored";
+    }
 
     _lastLocalDiscoveryStyle = _localDiscoveryStyle;
     _csync_ctx->should_discover_locally_fn = [this](const QByteArray &path) {
         return shouldDiscoverLocally(path);
     };
 
+    _lastSyncWasScoped = !_syncScope.empty();
+    if (_lastSyncWasScoped) {
+        qCInfo(lcEngine) << "Sync restricted to" << _syncScope.size() << "paths";
+        // The parent directories are only listed in part. Keep their etags
+        // invalid, so the next full sync doesn't read their contents from the db.
+        for (const auto &path : _syncScope)
+            _journal->avoidReadFromDbOnNextSync(path);
+        _csync_ctx->sync_scope = _syncScope;
+    }
+
     bool ok = false;
     auto selectiveSyncBlackList = _journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncBlackList, &ok);
     if (ok) {
@@ -869,6 +902,20 @@ void SyncEngine::startSync()
         finalize(false);
         return;
     }
+
+    const QString recordingDir = QString::fromLocal8Bit(qgetenv("OWNCLOUD_SYNC_RECORDING_DIR"));
+    if (!recordingDir.isEmpty()) {
+        _syncRecorder.reset(new SyncRecorder(recordingDir, _account->url(), _account->davUrl(), _remotePath));
+        if (_syncRecorder->isOpen()) {
+            _syncRecorder->recordSession(_localPath, selectiveSyncBlackList);
+            _syncRecorder->recordJournal(_journal);
+            _syncRecorder->recordLocalTree(_localPath);
+            _account->setSyncRecorder(_syncRecorder.data());
+        } else {
+            _syncRecorder.reset();
+        }
+    }
+
     csync_set_userdata(_csync_ctx.data(), this);
 
     // Set up checksumming hook
@@ -996,6 +1043,7 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     bool walkOk = true;
     _seenFiles.clear();
     _temporarilyUnavailablePaths.clear();
+    _unchangedSubtrees.clear();
     _renamedFolders.clear();
 
     if (csync_walk_local_tree(_csync_ctx.data(), [this](csync_file_stat_t *f, csync_file_stat_t *o) { return treewalkFile(f, o, false); }) < 0) {
@@ -1006,6 +1054,20 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
         qCWarning(lcEngine) << "Error in remote treewalk.";
     }
 
+    // Files that stayed spilled during discovery are unchanged on both sides.
+    // The journal keeps track of them for postSyncCleanup().
+    if (_csync_ctx->spilled_files_matched > 0) {
+        qCInfo(lcEngine) << _csync_ctx->spilled_files_matched << "unchanged files were not loaded into memory";
+        _hasNoneFiles = true;
+    }
+    for (const auto &dir : _csync_ctx->clean_subtrees) {
+        _unchangedSubtrees.insert(QString::fromUtf8(dir));
+    }
+    if (!_unchangedSubtrees.isEmpty()) {
+        qCInfo(lcEngine) << _unchangedSubtrees.size() << "directories were unchanged on both sides and not loaded";
+        _hasNoneFiles = true;
+    }
+
     qCInfo(lcEngine) << "Permissions of the root folder: " << _csync_ctx->remote.root_perms.toString();
 
     // The map was used for merging trees, convert it to a list:
@@ -1056,11 +1118,13 @@ void SyncEngine::slotDiscoveryJobFinished(int discoveryResult)
     auto databaseFingerprint = _journal->dataFingerprint();
     // If databaseFingerprint is empty, this means that there was no information in the database
     // (for example, upgrading from a previous version, or first sync, or server not supporting fingerprint)
-    if (!databaseFingerprint.isEmpty()
+    // The one-way modes never turn downloads into uploads, so there's nothing to restore
+    const bool bidirectional = _syncOptions._syncMode == SyncMode::Bidirectional;
+    if (bidirectional && !databaseFingerprint.isEmpty()
         && _discoveryMainThread->_dataFingerprint != databaseFingerprint) {
         qCInfo(lcEngine) << "data fingerprint changed, assume restore from backup" << databaseFingerprint << _discoveryMainThread->_dataFingerprint;
         restoreOldFiles(syncItems);
-    } else if (!_hasForwardInTimeFiles && _backInTimeFiles >= 2
+    } else if (bidirectional && !_hasForwardInTimeFiles && _backInTimeFiles >= 2
         && _account->serverVersionInt() < Account::makeServerVersion(9, 1, 0)) {
         // The server before ownCloud 9.1 did not have the data-fingerprint property. So in that
         // case we use heuristics to detect restored backup.  This is disabled with newer version
@@ -1230,7 +1294,17 @@ void SyncEngine::slotFinished(bool success)
         _journal->setDataFingerprint(_discoveryMainThread->_dataFingerprint);
     }
 
-    if (!_journal->postSyncCleanup(_seenFiles, _temporarilyUnavailablePaths)) {
+    // The parents of the scope were only listed in part, the propagation may
+    // have stored their new etags. Invalidate them again, so the next full
+    // sync lists their other children.
+    if (_lastSyncWasScoped) {
+        for (const auto &path : _syncScope)
+            _journal->avoidReadFromDbOnNextSync(path);
+    }
+
+    // The records outside of a scoped sync were not seen, but are still valid
+    if (!_lastSyncWasScoped
+        && !_journal->postSyncCleanup(_seenFiles, _temporarilyUnavailablePaths, _unchangedSubtrees)) {
         qCDebug(lcEngine) << "Cleaning of synced ";
     }
 
@@ -1256,8 +1330,15 @@ void SyncEngine::finalize(bool success)
     _csync_ctx->reinitialize();
     _journal->close();
 
+    if (_syncRecorder) {
+        _account->setSyncRecorder(nullptr);
+        qCInfo(lcEngine) << "Sync recorded to" << _syncRecorder->filePath();
+        _syncRecorder.reset();
+    }
+
     qCInfo(lcEngine) << "CSync run took " << _stopWatch.addLapTime(QLatin1String("Sync Finished")) << "ms";
     _stopWatch.stop();
+    qCInfo(lcEngine) << "Discovery and checksum I/O:" << IoGovernor::instance()->takeStats();
 
     s_anySyncRunning = false;
     _syncRunning = false;
@@ -1267,10 +1348,12 @@ void SyncEngine::finalize(bool success)
     _propagator.clear();
     _seenFiles.clear();
     _temporarilyUnavailablePaths.clear();
+    _unchangedSubtrees.clear();
     _renamedFolders.clear();
     _uniqueErrors.clear();
     _localDiscoveryPaths.clear();
     _localDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
+    _syncScope.clear();
 
     _clearTouchedFilesTimer.start();
 }
@@ -1681,6 +1764,11 @@ void SyncEngine::setLocalDiscoveryOptions(LocalDiscoveryStyle style, std::set<QB
     _localDiscoveryPaths = std::move(paths);
 }
 
+void SyncEngine::setSyncScope(std::set<QByteArray> paths)
+{
+    _syncScope = std::move(paths);
+}
+
 bool SyncEngine::shouldDiscoverLocally(const QByteArray &path) const
 {
     if (_localDiscoveryStyle == LocalDiscoveryStyle::FilesystemOnly)
@@ -47,6 +47,7 @@ namespace OCC {
 class SyncJournalFileRecord;
 class SyncJournalDb;
 class OwncloudPropagator;
+class SyncRecorder;
 
 enum AnotherSyncNeeded {
     NoFollowUpSync,
@@ -125,6 +126,27 @@ public:
     /** Access the last sync run's local discovery style */
     LocalDiscoveryStyle lastLocalDiscoveryStyle() const { return _lastLocalDiscoveryStyle; }
 
+    /**
+     * Restricts the next sync to the given folder-relative paths.
+     *
+     * Only the paths, their contents and their parent directories are
+     * discovered on either side. Everything else is neither synced nor
+     * touched in the journal. Like the local discovery options, the scope
+     * is only retained for the next sync.
+     */
+    void setSyncScope(std::set<QByteArray> paths);
+
+    /** Whether the last sync run was restricted by setSyncScope() */
+    bool lastSyncWasScoped() const { return _lastSyncWasScoped; }
+
+    /**
+     * Directories that were unchanged on both sides in the current sync.
+     *
+     * Nothing below them is walked, so no items are produced for their
+     * contents. Filled before aboutToPropagate() is emitted.
+     */
+    const QSet<QString> &unchangedSubtrees() const { return _unchangedSubtrees; }
+
 signals:
     void csyncUnavailable();
 
@@ -252,12 +274,17 @@ private:
     // while the remote says storage not available.
     QSet<QString> _temporarilyUnavailablePaths;
 
+    // Directories whose contents were unchanged on both sides and therefore
+    // not loaded during discovery. Their syncdb entries are kept as well.
+    QSet<QString> _unchangedSubtrees;
+
     QThread _thread;
 
     QScopedPointer<ProgressInfo> _progressInfo;
 
     QScopedPointer<ExcludedFiles> _excludedFiles;
     QScopedPointer<SyncFileStatusTracker> _syncFileStatusTracker;
+    QScopedPointer<SyncRecorder> _syncRecorder; // only while OWNCLOUD_SYNC_RECORDING_DIR is set
     Utility::StopWatch _stopWatch;
 
     // maps the origin and the target of the folders that have been renamed
@@ -311,6 +338,9 @@ private:
     LocalDiscoveryStyle _lastLocalDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
     LocalDiscoveryStyle _localDiscoveryStyle = LocalDiscoveryStyle::FilesystemOnly;
     std::set<QByteArray> _localDiscoveryPaths;
+
+    std::set<QByteArray> _syncScope;
+    bool _lastSyncWasScoped = false;
 };
 }
 
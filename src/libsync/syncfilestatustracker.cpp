@@ -216,6 +216,19 @@ void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
     ProblemsMap oldProblems;
     std::swap(_syncProblems, oldProblems);
 
+    // Nothing below an unchanged subtree produces items, keep its problems
+    const QSet<QString> &unchangedSubtrees = _syncEngine->unchangedSubtrees();
+    if (!unchangedSubtrees.isEmpty()) {
+        for (const auto &problem : oldProblems) {
+            for (int slash = problem.first.lastIndexOf('/'); slash > 0; slash = problem.first.lastIndexOf('/', slash - 1)) {
+                if (unchangedSubtrees.contains(problem.first.left(slash))) {
+                    _syncProblems.insert(problem);
+                    break;
+                }
+            }
+        }
+    }
+
     foreach (const SyncFileItemPtr &item, items) {
         qCDebug(lcStatusTracker) << "Investigating" << item->destination() << item->_status << item->_instruction;
         _dirtyPaths.remove(item->destination());
@@ -17,6 +17,7 @@
 #include "owncloudlib.h"
 #include <QString>
 #include <chrono>
+#include <csync.h>
 
 
 namespace OCC {
@@ -59,6 +60,22 @@ struct SyncOptions
 
     /** Whether parallel network jobs are allowed. */
     bool _parallelNetworkJobs = true;
+
+    /** Approximate memory budget in bytes for the discovered file trees.
+     *
+     * Beyond it, unchanged local files are kept in a temporary table of the
+     * sync journal instead of in memory. 0 means unlimited.
+     */
+    qint64 _discoveryMemoryBudget = 0;
+
+    /** Which directions are synced.
+     *
+     * Download-only reverts local changes: local-only files are removed and
+     * locally modified or deleted files are downloaded again. Upload-only
+     * doesn't download anything and only lists the remote directories that
+     * contain local changes.
+     */
+    SyncMode _syncMode = SyncMode::Bidirectional;
 };
 
 
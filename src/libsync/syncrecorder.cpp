@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "syncrecorder.h"
+#include "common/syncjournaldb.h"
+#include "common/utility.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QNetworkReply>
+
+#include "csync/vio/csync_vio_local.h"
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcSyncRecorder, "nextcloud.sync.recorder", QtInfoMsg)
+
+// Error bodies beyond this size are cut
+static const int maxErrorBodySize = 64 * 1024;
+
+static const char *const requestHeaders[] = {
+    "Depth", "Destination", "Range", "If-Match", "X-OC-Mtime", "OC-Checksum",
+    "OC-Total-Length", "OC-Chunk-Size", "OC-Chunked", "OC-Async"
+};
+
+static const char *const replyHeaders[] = {
+    "ETag", "OC-ETag", "OC-FileId", "X-OC-MTime", "OC-Checksum", "Content-Type",
+    "Content-Length", "Content-Range", "OC-JobStatus-Location", "Retry-After"
+};
+
+static bool isSyncMetadataFile(const QString &name)
+{
+    return ((name.startsWith(QLatin1String("._sync_")) || name.startsWith(QLatin1String(".sync_")))
+               && name.contains(QLatin1String(".db")))
+        || name.startsWith(QLatin1String(".csync_journal.db"))
+        || name.startsWith(QLatin1String(".owncloudsync.log"));
+}
+
+SyncRecorder::SyncRecorder(const QString &dir, const QUrl &accountUrl, const QUrl &davUrl,
+    const QString &remotePath, QObject *parent)
+    : QObject(parent)
+    , _accountUrl(accountUrl)
+    , _davUrl(davUrl)
+    , _remotePath(remotePath)
+{
+    _accountPath = accountUrl.path(QUrl::FullyEncoded);
+    if (!_accountPath.endsWith(QLatin1Char('/')))
+        _accountPath += QLatin1Char('/');
+
+    QDir().mkpath(dir);
+    _file.setFileName(QDir(dir).filePath(QStringLiteral("sync-%1.jsonl")
+                                             .arg(QDateTime::currentDateTimeUtc().toString(QStringLiteral("yyyyMMdd-hhmmss-zzz")))));
+    if (!_file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcSyncRecorder) << "Could not open" << _file.fileName() << _file.errorString();
+        return;
+    }
+    qCInfo(lcSyncRecorder) << "Recording the sync to" << _file.fileName();
+    _clock.start();
+}
+
+void SyncRecorder::write(const QJsonObject &object)
+{
+    if (!_file.isOpen())
+        return;
+    _file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    _file.write("\n");
+}
+
+void SyncRecorder::recordSession(const QString &localPath, const QStringList &selectiveSyncBlackList)
+{
+    QString davPath = _davUrl.path(QUrl::FullyEncoded);
+    if (davPath.startsWith(_accountPath))
+        davPath = davPath.mid(_accountPath.size());
+
+    QJsonObject session;
+    session[QStringLiteral("kind")] = QStringLiteral("session");
+    session[QStringLiteral("version")] = formatVersion;
+    session[QStringLiteral("started")] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    session[QStringLiteral("accountPath")] = _accountPath;
+    session[QStringLiteral("davPath")] = davPath;
+    session[QStringLiteral("remotePath")] = _remotePath;
+    session[QStringLiteral("localPath")] = localPath;
+    session[QStringLiteral("selectiveSyncBlackList")] = QJsonArray::fromStringList(selectiveSyncBlackList);
+    write(session);
+}
+
+void SyncRecorder::recordJournal(SyncJournalDb *journal)
+{
+    int count = 0;
+    journal->getFilesBelowPath(QByteArray(), [this, &count](const SyncJournalFileRecord &rec) {
+        QJsonObject entry;
+        entry[QStringLiteral("kind")] = QStringLiteral("journal");
+        entry[QStringLiteral("path")] = QString::fromUtf8(rec._path);
+        entry[QStringLiteral("type")] = static_cast<int>(rec._type);
+        entry[QStringLiteral("inode")] = QString::number(rec._inode);
+        entry[QStringLiteral("mtime")] = rec._modtime;
+        entry[QStringLiteral("size")] = rec._fileSize;
+        entry[QStringLiteral("etag")] = QString::fromUtf8(rec._etag);
+        entry[QStringLiteral("fileId")] = QString::fromUtf8(rec._fileId);
+        entry[QStringLiteral("permissions")] = QString::fromUtf8(rec._remotePerm.toString());
+        entry[QStringLiteral("checksum")] = QString::fromUtf8(rec._checksumHeader);
+        if (rec._serverHasIgnoredFiles)
+            entry[QStringLiteral("serverHasIgnoredFiles")] = true;
+        if (!rec._e2eMangledName.isEmpty())
+            entry[QStringLiteral("e2eMangledName")] = QString::fromUtf8(rec._e2eMangledName);
+        write(entry);
+        ++count;
+    });
+    qCInfo(lcSyncRecorder) << "Recorded" << count << "journal entries";
+}
+
+void SyncRecorder::recordLocalTree(const QString &localPath)
+{
+    int count = 0;
+    QDirIterator it(localPath, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+        QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        if (isSyncMetadataFile(it.fileName()))
+            continue;
+
+        csync_file_stat_t stat;
+        if (csync_vio_local_stat(path.toUtf8().constData(), &stat) < 0)
+            continue;
+
+        QJsonObject entry;
+        entry[QStringLiteral("kind")] = QStringLiteral("local");
+        entry[QStringLiteral("path")] = path.mid(localPath.size());
+        entry[QStringLiteral("type")] = static_cast<int>(stat.type);
+        entry[QStringLiteral("inode")] = QString::number(stat.inode);
+        entry[QStringLiteral("mtime")] = static_cast<qint64>(stat.modtime);
+        entry[QStringLiteral("size")] = stat.size;
+        write(entry);
+        ++count;
+    }
+    qCInfo(lcSyncRecorder) << "Recorded" << count << "local entries";
+}
+
+void SyncRecorder::recordRequest(const QByteArray &verb, QNetworkReply *reply, QIODevice *requestBody)
+{
+    // Only what is below the account, never requests to other hosts
+    const QUrl url = reply->request().url();
+    QString path = url.path(QUrl::FullyEncoded);
+    if (url.host() != _accountUrl.host() || !path.startsWith(_accountPath))
+        return;
+    path = path.mid(_accountPath.size());
+
+    PendingRequest pending;
+    pending.id = ++_requestCount;
+    pending.verb = verb;
+    pending.path = path;
+    pending.started = _clock.elapsed();
+    pending.bytesSent = requestBody ? requestBody->size() : 0;
+    pending.bytesReceived = 0;
+    _pending.insert(reply, pending);
+
+    // Connected before the job's own connections, so the body can still be peeked
+    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply](qint64 received, qint64) {
+        auto it = _pending.find(reply);
+        if (it != _pending.end())
+            it->bytesReceived = received;
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply] { recordReply(reply); });
+    connect(reply, &QObject::destroyed, this, [this, reply] { _pending.remove(reply); });
+}
+
+void SyncRecorder::recordReply(QNetworkReply *reply)
+{
+    auto it = _pending.find(reply);
+    if (it == _pending.end())
+        return;
+    const PendingRequest pending = *it;
+    _pending.erase(it);
+
+    const QNetworkRequest request = reply->request();
+    QJsonObject sentHeaders;
+    for (auto name : requestHeaders) {
+        if (!request.hasRawHeader(name))
+            continue;
+        QByteArray value = request.rawHeader(name);
+        if (qstrcmp(name, "Destination") == 0) {
+            // Host independent, like the request path
+            const QString destination = QUrl::fromEncoded(value).path(QUrl::FullyEncoded);
+            value = destination.startsWith(_accountPath) ? destination.mid(_accountPath.size()).toUtf8() : QByteArray();
+        }
+        sentHeaders[QString::fromLatin1(name)] = QString::fromUtf8(value);
+    }
+    QJsonObject receivedHeaders;
+    for (auto name : replyHeaders) {
+        if (reply->hasRawHeader(name))
+            receivedHeaders[QString::fromLatin1(name)] = QString::fromUtf8(reply->rawHeader(name));
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QJsonObject entry;
+    entry[QStringLiteral("kind")] = QStringLiteral("request");
+    entry[QStringLiteral("id")] = pending.id;
+    entry[QStringLiteral("verb")] = QString::fromLatin1(pending.verb);
+    entry[QStringLiteral("path")] = pending.path;
+    entry[QStringLiteral("requestHeaders")] = sentHeaders;
+    entry[QStringLiteral("started")] = pending.started;
+    entry[QStringLiteral("duration")] = _clock.elapsed() - pending.started;
+    entry[QStringLiteral("status")] = status;
+    entry[QStringLiteral("error")] = static_cast<int>(reply->error());
+    entry[QStringLiteral("replyHeaders")] = receivedHeaders;
+    entry[QStringLiteral("bytesSent")] = pending.bytesSent;
+
+    const bool keepBody = pending.verb == "PROPFIND" || status >= 400;
+    const QByteArray body = keepBody ? reply->peek(reply->bytesAvailable()) : QByteArray();
+    entry[QStringLiteral("bytesReceived")] = qMax(pending.bytesReceived, qint64(body.size()));
+    if (!body.isEmpty()) {
+        entry[QStringLiteral("body")] = QString::fromUtf8(pending.verb == "PROPFIND" ? body : body.left(maxErrorBodySize));
+    }
+    write(entry);
+}
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) by Nextcloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef SYNCRECORDER_H
+#define SYNCRECORDER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QUrl>
+
+#include "owncloudlib.h"
+
+class QIODevice;
+class QJsonObject;
+class QNetworkReply;
+
+namespace OCC {
+
+class SyncJournalDb;
+
+/**
+ * @brief Records the metadata of a sync run, so it can be replayed offline
+ *
+ * Enabled by setting OWNCLOUD_SYNC_RECORDING_DIR, each sync then writes a
+ * new file there. It holds one JSON object per line, "kind" tells which:
+ * - "session": the account and folder the sync ran against
+ * - "journal": a file record of the sync journal at the start of the sync
+ * - "local": an entry of the local folder at the start of the sync
+ * - "request": a network request of the sync with its reply
+ *
+ * Requests keep their verb, path, a fixed set of headers, status, sizes and
+ * timings. Of the bodies, only PROPFIND replies and error replies are kept.
+ * File contents are never recorded, file names, etags and ids are.
+ *
+ * test/benchmarks/benchreplay.cpp replays a recording against a fake server.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT SyncRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    static const int formatVersion = 1;
+
+    /// Starts a new recording in dir, check isOpen()
+    SyncRecorder(const QString &dir, const QUrl &accountUrl, const QUrl &davUrl,
+        const QString &remotePath, QObject *parent = nullptr);
+
+    bool isOpen() const { return _file.isOpen(); }
+    QString filePath() const { return _file.fileName(); }
+
+    void recordSession(const QString &localPath, const QStringList &selectiveSyncBlackList);
+    void recordJournal(SyncJournalDb *journal);
+    void recordLocalTree(const QString &localPath);
+
+    /// Records the request and, once finished, the reply
+    void recordRequest(const QByteArray &verb, QNetworkReply *reply, QIODevice *requestBody);
+
+private:
+    void write(const QJsonObject &object);
+    void recordReply(QNetworkReply *reply);
+
+    struct PendingRequest
+    {
+        int id;
+        QByteArray verb;
+        QString path;
+        qint64 started;
+        qint64 bytesSent;
+        qint64 bytesReceived;
+    };
+
+    QFile _file;
+    QUrl _accountUrl;
+    QUrl _davUrl;
+    QString _remotePath;
+    QString _accountPath; // fully encoded, with trailing slash
+    QElapsedTimer _clock;
+    int _requestCount = 0;
+    QHash<QNetworkReply *, PendingRequest> _pending;
+};
+}
+
+#endif // SYNCRECORDER_H
@@ -0,0 +1,86 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtCore>
+#include <random>
+
+#include "common/syncjournaldb.h"
+#include "common/syncjournalfilerecord.h"
+
+using namespace OCC;
+
+QVector<QByteArray> files;
+QVector<QByteArray> dirs;
+
+template <int filesPerDir, int dirPerDir, int maxDepth>
+void addBunchOfFiles(int depth, const QByteArray &path, SyncJournalDb &db)
+{
+    for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
+        QByteArray name = "file" + QByteArray::number(fileNum) + ".txt";
+        SyncJournalFileRecord record;
+        record._path = path.isEmpty() ? name : path + "/" + name;
+        record._type = ItemTypeFile;
+        record._inode = files.size() + dirs.size() + 1;
+        record._etag = "etag";
+        record._fileId = "fileid" + QByteArray::number(record._inode);
+        record._checksumHeader = "SHA1:da39a3ee5e6b4b0d3255bfef95601890afd80709";
+        db.setFileRecord(record);
+        files.append(record._path);
+    }
+    if (depth >= maxDepth)
+        return;
+    for (int dirNum = 1; dirNum <= dirPerDir; ++dirNum) {
+        QByteArray name = "dir" + QByteArray::number(dirNum);
+        SyncJournalFileRecord record;
+        record._path = path.isEmpty() ? name : path + "/" + name;
+        record._type = ItemTypeDirectory;
+        record._inode = files.size() + dirs.size() + 1;
+        record._etag = "etag";
+        db.setFileRecord(record);
+        dirs.append(record._path);
+        addBunchOfFiles<filesPerDir, dirPerDir, maxDepth>(depth + 1, record._path, db);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QLoggingCategory::setFilterRules("*.info=false\n*.debug=false");
+
+    QTemporaryDir tempDir;
+    SyncJournalDb db(tempDir.path() + "/journal.db");
+
+    QElapsedTimer timer;
+    timer.start();
+    addBunchOfFiles<10, 8, 4>(0, "", db);
+    db.commit("bench");
+    qDebug() << "NUMFILES" << files.size() << "NUMDIRS" << dirs.size() << "INSERT:" << timer.restart() << "ms";
+
+    // Point lookups in random order, the way discovery and propagation hit the journal
+    std::mt19937 gen(42);
+    std::shuffle(files.begin(), files.end(), gen);
+    int found = 0;
+    for (const auto &file : files) {
+        SyncJournalFileRecord record;
+        db.getFileRecord(file, &record);
+        found += record.isValid();
+    }
+    qint64 ns = timer.nsecsElapsed();
+    qDebug() << "POINT LOOKUP:" << double(ns) / files.size() / 1000 << "us per record" << found;
+
+    // Range scans of the subtrees
+    timer.restart();
+    qint64 rows = 0;
+    for (const auto &dir : dirs) {
+        db.getFilesBelowPath(dir, [&rows](const SyncJournalFileRecord &) { ++rows; });
+    }
+    ns = timer.nsecsElapsed();
+    qDebug() << "RANGE SCAN:" << double(ns) / dirs.size() / 1000 << "us per directory," << rows << "rows";
+
+    db.close();
+    return found == files.size() ? 0 : -1;
+}
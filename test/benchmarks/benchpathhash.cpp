@@ -0,0 +1,112 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtCore>
+#include <unordered_map>
+#include <random>
+
+#include "common/c_jhash.h"
+#include "common/c_wyhash.h"
+
+// Paths shaped like a typical sync folder: a few levels of folders with
+// short names and many files with longer names and an extension.
+static QVector<QByteArray> makePaths(int count)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> depthDist(0, 7);
+    std::uniform_int_distribution<int> dirLenDist(3, 16);
+    std::uniform_int_distribution<int> fileLenDist(5, 40);
+    std::uniform_int_distribution<int> charDist('a', 'z');
+    static const char *extensions[] = { ".txt", ".jpg", ".pdf", ".docx", ".md", ".cpp", ".png", "" };
+
+    QVector<QByteArray> paths;
+    paths.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QByteArray path;
+        int depth = depthDist(gen);
+        for (int d = 0; d < depth; ++d) {
+            int len = dirLenDist(gen);
+            for (int c = 0; c < len; ++c)
+                path += char(charDist(gen));
+            path += '/';
+        }
+        int len = fileLenDist(gen);
+        for (int c = 0; c < len; ++c)
+            path += char(charDist(gen));
+        path += extensions[i % 8];
+        path += QByteArray::number(i);
+        paths.append(path);
+    }
+    return paths;
+}
+
+template <typename Hash>
+static void benchHash(const char *name, const QVector<QByteArray> &paths, Hash hash)
+{
+    const int rounds = 20;
+    quint64 sink = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto &path : paths)
+            sink += hash(path);
+    }
+    qint64 ns = timer.nsecsElapsed();
+    qDebug() << name << double(ns) / (rounds * paths.size()) << "ns per path" << (sink & 1);
+}
+
+template <typename Hash>
+static void benchMap(const char *name, const QVector<QByteArray> &paths)
+{
+    std::unordered_map<QByteArray, int, Hash> map;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < paths.size(); ++i)
+        map[paths[i]] = i;
+    qint64 insertMs = timer.restart();
+    int found = 0;
+    for (int r = 0; r < 10; ++r) {
+        for (const auto &path : paths)
+            found += map.count(path);
+    }
+    qDebug() << name << "insert:" << insertMs << "ms, 10x lookup:" << timer.elapsed() << "ms" << found;
+}
+
+struct QHashBitsHash { size_t operator()(const QByteArray &a) const { return qHashBits(a.constData(), a.size()); } };
+struct JHashHash { size_t operator()(const QByteArray &a) const { return c_jhash64((uint8_t *)a.constData(), a.size(), 0); } };
+struct WyHashHash { size_t operator()(const QByteArray &a) const { return c_wyhash64(a.constData(), a.size(), 0); } };
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const auto paths = makePaths(500000);
+
+    qint64 totalLen = 0;
+    for (const auto &path : paths)
+        totalLen += path.size();
+    qDebug() << "NUMPATHS" << paths.size() << "AVERAGE LENGTH" << double(totalLen) / paths.size();
+
+    benchHash("c_jhash64 ", paths, JHashHash());
+    benchHash("qHashBits ", paths, QHashBitsHash());
+    benchHash("c_wyhash64", paths, WyHashHash());
+
+    benchMap<JHashHash>("c_jhash64  map", paths);
+    benchMap<QHashBitsHash>("qHashBits  map", paths);
+    benchMap<WyHashHash>("c_wyhash64 map", paths);
+
+    // The phash is the primary key of the journal, count collisions
+    QSet<quint64> seen;
+    int collisions = 0;
+    for (const auto &path : paths) {
+        quint64 h = c_wyhash64(path.constData(), path.size(), 0);
+        if (seen.contains(h))
+            ++collisions;
+        seen.insert(h);
+    }
+    qDebug() << "c_wyhash64 collisions" << collisions;
+    return collisions == 0 ? 0 : -1;
+}
@@ -0,0 +1,38 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+// Replays a recording of OWNCLOUD_SYNC_RECORDING_DIR:
+//   ReplayBench [--timing] sync-<date>.jsonl
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+    SyncReplay replay;
+    replay.setTiming(args.removeAll(QStringLiteral("--timing")) > 0);
+    if (args.size() != 1) {
+        qWarning() << "Usage:" << app.arguments().value(0) << "[--timing] <recording>";
+        return -1;
+    }
+    if (!replay.load(args.first()))
+        return -1;
+
+    FakeFolder fakeFolder{FileInfo{}};
+    replay.populate(fakeFolder);
+    qDebug() << "REQUESTS" << replay.requestCount();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool result = fakeFolder.syncOnce();
+    qDebug() << "SYNC: " << result << timer.elapsed();
+    qDebug() << "NOT IN THE RECORDING:" << replay.unmatchedCount();
+    return result ? 0 : -1;
+}
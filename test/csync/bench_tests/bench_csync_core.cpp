@@ -0,0 +1,359 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+/* Microbenchmarks of the csync building blocks, on synthetic trees.
+ *
+ * Usage: bench_csync_core [flat|deep|wide|unicode|all] [number of files] [rounds]
+ *
+ * Every benchmark prints the time and the number of heap allocations per
+ * operation, averaged over the rounds. Allocations are counted by wrapping
+ * malloc with glibc, and operator new elsewhere.
+ */
+#include "csync_update.cpp"
+#include "csync_reconcile.cpp"
+
+#include "csync_exclude.h"
+#include "csync_rename.h"
+#include "common/syncjournaldb.h"
+#include "common/syncjournalfilerecord.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static std::atomic<quint64> allocations{0};
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+// Only counts C++ allocations, Qt containers use malloc directly
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+enum class Shape {
+    Flat, //< all files in the root
+    Deep, //< a chain of 32 directories, the files spread over the levels
+    Wide, //< sqrt(n) directories with sqrt(n) files each
+    Unicode //< like wide, with long names mixing scripts
+};
+
+struct Entry
+{
+    QByteArray path;
+    ItemType type;
+};
+
+static const char *shapeName(Shape shape)
+{
+    switch (shape) {
+    case Shape::Flat:
+        return "flat";
+    case Shape::Deep:
+        return "deep";
+    case Shape::Wide:
+        return "wide";
+    case Shape::Unicode:
+        return "unicode";
+    }
+    return "";
+}
+
+static std::vector<Entry> makeTree(Shape shape, int files)
+{
+    std::vector<Entry> tree;
+    switch (shape) {
+    case Shape::Flat:
+        for (int i = 0; i < files; ++i)
+            tree.push_back({ "file" + QByteArray::number(i) + ".txt", ItemTypeFile });
+        break;
+    case Shape::Deep: {
+        const int depth = 32;
+        std::vector<QByteArray> levels;
+        QByteArray dir;
+        for (int level = 0; level < depth; ++level) {
+            dir += (dir.isEmpty() ? "" : "/") + QByteArray("level") + QByteArray::number(level);
+            tree.push_back({ dir, ItemTypeDirectory });
+            levels.push_back(dir);
+        }
+        for (int i = 0; i < files; ++i)
+            tree.push_back({ levels[i % depth] + "/file" + QByteArray::number(i) + ".txt", ItemTypeFile });
+        break;
+    }
+    case Shape::Wide:
+    case Shape::Unicode: {
+        const bool unicode = shape == Shape::Unicode;
+        const int dirs = qMax(1, int(std::sqrt(double(files))));
+        for (int d = 0; d < dirs; ++d) {
+            const QByteArray dir = (unicode ? QByteArray("Ordner \xc3\xa4\xc3\xb6\xc3\xbc \xe6\x96\x87\xe4\xbb\xb6 ") : QByteArray("dir"))
+                + QByteArray::number(d);
+            tree.push_back({ dir, ItemTypeDirectory });
+            for (int i = d; i < files; i += dirs) {
+                const QByteArray name = unicode
+                    // "Ünïcödé Файл 日本語のファイル" with a number
+                    ? QByteArray(QByteArray("\xc3\x9cn\xc3\xaf""c\xc3\xb6""d\xc3\xa9 \xd0\xa4\xd0\xb0\xd0\xb9\xd0\xbb "
+                                            "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\x95\xe3\x82\xa1\xe3\x82\xa4\xe3\x83\xab ")
+                          + QByteArray::number(i) + ".odt")
+                    : QByteArray("file" + QByteArray::number(i) + ".txt");
+                tree.push_back({ dir + "/" + name, ItemTypeFile });
+            }
+        }
+        break;
+    }
+    }
+    return tree;
+}
+
+static std::unique_ptr<csync_file_stat_t> makeFileStat(const Entry &entry, int index)
+{
+    std::unique_ptr<csync_file_stat_t> fs(new csync_file_stat_t);
+    fs->path = entry.path;
+    fs->type = entry.type;
+    fs->inode = index + 1;
+    fs->modtime = 1500000000 + index;
+    fs->size = entry.type == ItemTypeFile ? 1000 + index : 0;
+    fs->etag = "etag" + QByteArray::number(index);
+    fs->file_id = "fileid" + QByteArray::number(index);
+    return fs;
+}
+
+static OCC::SyncJournalFileRecord makeRecord(const Entry &entry, int index)
+{
+    OCC::SyncJournalFileRecord record;
+    record._path = entry.path;
+    record._type = entry.type;
+    record._inode = index + 1;
+    record._modtime = 1500000000 + index;
+    record._fileSize = entry.type == ItemTypeFile ? 1000 + index : 0;
+    record._etag = "etag" + QByteArray::number(index);
+    record._fileId = "fileid" + QByteArray::number(index);
+    record._checksumHeader = "SHA1:da39a3ee5e6b4b0d3255bfef95601890afd80709";
+    return record;
+}
+
+/* Runs setup() and then run() for every round, only run() is measured */
+template <typename Setup, typename Run>
+static void measure(const char *name, Shape shape, size_t ops, int rounds, Setup &&setup, Run &&run)
+{
+    qint64 nsecs = 0;
+    quint64 allocs = 0;
+    for (int round = 0; round < rounds; ++round) {
+        setup();
+        QElapsedTimer timer;
+        const quint64 allocsBefore = allocations.load(std::memory_order_relaxed);
+        timer.start();
+        run();
+        nsecs += timer.nsecsElapsed();
+        allocs += allocations.load(std::memory_order_relaxed) - allocsBefore;
+    }
+    const double total = double(ops) * rounds;
+    printf("%-32s %-8s %10.1f ns/op %8.2f allocs/op\n", name, shapeName(shape), nsecs / total, allocs / total);
+    fflush(stdout);
+}
+
+static void benchShape(Shape shape, int files, int rounds)
+{
+    const auto tree = makeTree(shape, files);
+    const size_t n = tree.size();
+    volatile size_t sink = 0;
+
+    // ByteArrayRef hashing and the FileMap
+    std::vector<ByteArrayRef> refs;
+    for (const auto &entry : tree)
+        refs.emplace_back(entry.path);
+
+    measure("ByteArrayRefHash", shape, n, rounds, [] {}, [&] {
+        size_t h = 0;
+        for (const auto &ref : refs)
+            h += ByteArrayRefHash()(ref);
+        sink = h;
+    });
+
+    csync_s::FileMap map;
+    std::vector<std::unique_ptr<csync_file_stat_t>> stats;
+    measure("FileMap insert", shape, n, rounds, [&] {
+        map.clear();
+        stats.clear();
+        for (size_t i = 0; i < n; ++i)
+            stats.push_back(makeFileStat(tree[i], int(i)));
+    }, [&] {
+        for (auto &fs : stats) {
+            QByteArray path = fs->path;
+            map[path] = std::move(fs);
+        }
+    });
+
+    measure("FileMap findFile", shape, n, rounds, [] {}, [&] {
+        size_t found = 0;
+        for (const auto &ref : refs)
+            found += map.findFile(ref) != nullptr;
+        sink = found;
+    });
+
+    // Exclude patterns of a default installation
+    ExcludedFiles excludes;
+    excludes.addExcludeFilePath(QStringLiteral(SOURCEDIR "/../../sync-exclude.lst"));
+    excludes.reloadExcludeFiles();
+
+    measure("traversalPatternMatch", shape, n, rounds, [] {}, [&] {
+        size_t excluded = 0;
+        for (const auto &entry : tree)
+            excluded += excludes.traversalPatternMatch(entry.path.constData(), entry.type) != CSYNC_NOT_EXCLUDED;
+        sink = excluded;
+    });
+
+    // fromSyncJournalFileRecord
+    std::vector<OCC::SyncJournalFileRecord> records;
+    for (size_t i = 0; i < n; ++i)
+        records.push_back(makeRecord(tree[i], int(i)));
+
+    measure("fromSyncJournalFileRecord", shape, n, rounds, [] {}, [&] {
+        for (const auto &record : records)
+            sink = csync_file_stat_t::fromSyncJournalFileRecord(record)->size;
+    });
+
+    // _csync_detect_update of an unchanged local tree, against a journal
+    QTemporaryDir dir;
+    OCC::SyncJournalDb db(dir.path() + QStringLiteral("/.sync_bench.db"));
+    for (const auto &record : records)
+        db.setFileRecord(record);
+    db.commit(QStringLiteral("bench"));
+
+    CSYNC ctx(dir.path().toUtf8().constData(), &db);
+    ctx.exclude_traversal_fn = excludes.csyncTraversalMatchFun();
+    ctx.current = LOCAL_REPLICA;
+
+    measure("_csync_detect_update", shape, n, rounds, [&] {
+        ctx.current_fs = nullptr;
+        ctx.local.files.clear();
+        stats.clear();
+        for (size_t i = 0; i < n; ++i)
+            stats.push_back(makeFileStat(tree[i], int(i)));
+    }, [&] {
+        for (auto &fs : stats)
+            _csync_detect_update(&ctx, std::move(fs));
+    });
+
+    // csync_rename_adjust_parent_path with a few directory renames
+    int renames = 0;
+    for (const auto &entry : tree) {
+        if (entry.type != ItemTypeDirectory)
+            continue;
+        csync_rename_record(&ctx, entry.path, entry.path + "_renamed");
+        if (++renames == 16)
+            break;
+    }
+
+    measure("csync_rename_adjust_parent_path", shape, n, rounds, [] {}, [&] {
+        size_t renamed = 0;
+        for (const auto &entry : tree)
+            renamed += csync_rename_adjust_parent_path(&ctx, entry.path).size();
+        sink = renamed;
+    });
+    ctx.renames.folder_renamed_to.clear();
+    ctx.renames.folder_renamed_from.clear();
+
+    // _csync_merge_algorithm_visitor: every tenth file changed locally,
+    // every tenth file changed remotely, the rest unchanged.
+    ctx.local.files.clear();
+    ctx.remote.files.clear();
+    for (size_t i = 0; i < n; ++i) {
+        ctx.local.files[tree[i].path] = makeFileStat(tree[i], int(i));
+        ctx.remote.files[tree[i].path] = makeFileStat(tree[i], int(i));
+    }
+
+    measure("_csync_merge_algorithm_visitor", shape, 2 * n, rounds, [&] {
+        for (size_t i = 0; i < n; ++i) {
+            const auto localInstruction = i % 10 == 0 ? CSYNC_INSTRUCTION_EVAL : CSYNC_INSTRUCTION_NONE;
+            const auto remoteInstruction = i % 10 == 5 ? CSYNC_INSTRUCTION_EVAL : CSYNC_INSTRUCTION_NONE;
+            ctx.local.files.findFile(tree[i].path)->instruction = localInstruction;
+            ctx.remote.files.findFile(tree[i].path)->instruction = remoteInstruction;
+        }
+    }, [&] {
+        ctx.current = LOCAL_REPLICA;
+        csync_reconcile_updates(&ctx);
+        ctx.current = REMOTE_REPLICA;
+        csync_reconcile_updates(&ctx);
+    });
+
+    ctx.local.files.clear();
+    ctx.remote.files.clear();
+    db.close();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QLoggingCategory::setFilterRules(QStringLiteral("*.info=false\n*.debug=false"));
+
+    const QByteArray shapeArg = argc > 1 ? QByteArray(argv[1]) : QByteArray("all");
+    const int files = argc > 2 ? atoi(argv[2]) : 10000;
+    const int rounds = argc > 3 ? atoi(argv[3]) : 5;
+    if (files <= 0 || rounds <= 0) {
+        fprintf(stderr, "Usage: %s [flat|deep|wide|unicode|all] [number of files] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    bool ran = false;
+    for (auto shape : { Shape::Flat, Shape::Deep, Shape::Wide, Shape::Unicode }) {
+        if (shapeArg != "all" && shapeArg != shapeName(shape))
+            continue;
+        printf("# %s tree, %d files, %d rounds\n", shapeName(shape), files, rounds);
+        benchShape(shape, files, rounds);
+        ran = true;
+    }
+    if (!ran) {
+        fprintf(stderr, "Unknown shape %s\n", shapeArg.constData());
+        return 1;
+    }
+    return 0;
+}
@@ -34,6 +34,18 @@ static void check_csync_instruction_str(void **state)
   assert_string_equal(str, "ERROR!");
 }
 
+static void check_csync_httpdate_parse(void **state)
+{
+  (void) state; /* unused */
+
+  assert_int_equal(oc_httpdate_parse("Thu, 01 Jan 1970 00:00:00 GMT"), 0);
+  assert_int_equal(oc_httpdate_parse("Sun, 06 Nov 1994 08:49:37 GMT"), 784111777);
+  assert_int_equal(oc_httpdate_parse("Fri, 06 Feb 2015 13:49:55 GMT"), 1423230595);
+  assert_int_equal(oc_httpdate_parse("Tue, 29 Feb 2000 23:59:59 GMT"), 951868799);
+  /* Not fixed width, handled by the generic parser */
+  assert_int_equal(oc_httpdate_parse("Sun, 6 Nov 1994 08:49:37 GMT"), 784111777);
+}
+
 static void check_csync_memstat(void **state)
 {
   (void) state; /* unused */
@@ -45,6 +57,7 @@ int torture_run_tests(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(check_csync_instruction_str),
+        cmocka_unit_test(check_csync_httpdate_parse),
         cmocka_unit_test(check_csync_memstat),
     };
 
@@ -0,0 +1,110 @@
+/*
+ * Test vectors are taken from the wyhash README
+ * by Wang Yi, Public Domain.
+ *
+ * See https://github.com/wangyi-fudan/wyhash
+ */
+#include <string.h>
+
+#include "torture.h"
+
+#include "common/c_wyhash.h"
+
+#define MAXLEN 70
+
+/* The phash values in existing journals depend on these, they must never change */
+static void check_c_wyhash64_vectors(void **state)
+{
+  static const char *keys[] = {
+    "",
+    "a",
+    "abc",
+    "message digest",
+    "abcdefghijklmnopqrstuvwxyz",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+    "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+  };
+  static const uint64_t expected[] = {
+    0x0409638ee2bde459ull,
+    0xa8412d091b5fe0a9ull,
+    0x32dd92e4b2915153ull,
+    0x8619124089a3a16bull,
+    0x7a43afb61d7f5f40ull,
+    0xff42329b90e50d58ull,
+    0xc39cab13b115aad3ull,
+  };
+  uint64_t i = 0;
+
+  (void) state; /* unused */
+
+  for (i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+    assert_true(c_wyhash64(keys[i], strlen(keys[i]), i) == expected[i]);
+  }
+}
+
+static void check_c_wyhash64_alignment_problems(void **state)
+{
+  uint8_t buf[MAXLEN+20];
+  uint8_t *b = NULL;
+  uint8_t q[] = "This is the time for all good men to come to the aid of their country";
+  uint8_t qq[] = "xThis is the time for all good men to come to the aid of their country";
+  uint8_t qqq[] = "xxThis is the time for all good men to come to the aid of their country";
+  uint8_t qqqq[] = "xxxThis is the time for all good men to come to the aid of their country";
+  uint64_t test = 0;
+  uint64_t ref = 0;
+  uint64_t x = 0;
+  uint64_t y = 0;
+  uint64_t h = 0;
+  uint64_t i = 0;
+  uint64_t j = 0;
+
+  (void) state; /* unused */
+
+  test = c_wyhash64(q, sizeof(q)-1, 0);
+  assert_true(test == c_wyhash64(qq+1, sizeof(q)-1, 0));
+  assert_true(test == c_wyhash64(qqq+2, sizeof(q)-1, 0));
+  assert_true(test == c_wyhash64(qqqq+3, sizeof(q)-1, 0));
+  for (h=0, b=buf+1; h<8; ++h, ++b) {
+    for (i=0; i<MAXLEN; ++i) {
+      for (j=0; j<i; ++j) *(b+j)=0;
+
+      /* the bytes around the key must not be read */
+      ref = c_wyhash64(b, i, 1);
+      *(b+i)=(uint8_t)~0;
+      *(b-1)=(uint8_t)~0;
+      x = c_wyhash64(b, i, 1);
+      y = c_wyhash64(b, i, 1);
+      assert_false((ref != x) || (ref != y));
+    }
+  }
+}
+
+static void check_c_wyhash64_lengths(void **state)
+{
+  uint8_t buf[MAXLEN];
+  uint64_t hashes[MAXLEN];
+  uint64_t i = 0;
+  uint64_t j = 0;
+
+  (void) state; /* unused */
+
+  /* keys of zeros only differ by their length */
+  memset(buf, 0, sizeof(buf));
+  for (i=0; i<MAXLEN; ++i) {
+    hashes[i] = c_wyhash64(buf, i, 0);
+    for (j=0; j<i; ++j) {
+      assert_false(hashes[i] == hashes[j]);
+    }
+  }
+}
+
+int torture_run_tests(void)
+{
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(check_c_wyhash64_vectors),
+      cmocka_unit_test(check_c_wyhash64_alignment_problems),
+      cmocka_unit_test(check_c_wyhash64_lengths),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -11,11 +11,17 @@
 #include "logger.h"
 #include "filesystem.h"
 #include "syncengine.h"
+#include "syncrecorder.h"
 #include "common/syncjournaldb.h"
+#include "csync/vio/csync_vio_local.h"
 
 #include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QNetworkReply>
 #include <QMap>
+#include <QQueue>
 #include <QtTest>
 #include <memory>
 
@@ -792,6 +798,70 @@ public:
     }
 };
 
+// A reply from a recording, see SyncReplay
+class FakeReplayReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    struct Recorded
+    {
+        int status = 0;
+        int error = 0;
+        QList<QPair<QByteArray, QByteArray>> headers;
+        QByteArray body;
+        qint64 size = 0; // of the filler contents when there is no body
+        qint64 duration = 0;
+    };
+
+    FakeReplayReply(const Recorded &recorded, int delayMs, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
+        : QNetworkReply{parent}
+        , _recorded(recorded)
+        , _payload(recorded.body)
+        , _fillerSize(recorded.body.isEmpty() ? recorded.size : 0)
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+        QTimer::singleShot(delayMs, this, &FakeReplayReply::respond);
+    }
+
+    void respond() {
+        for (const auto &header : _recorded.headers)
+            setRawHeader(header.first, header.second);
+        setHeader(QNetworkRequest::ContentLengthHeader, _payload.size() + _fillerSize);
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, _recorded.status);
+        if (_recorded.error != NoError)
+            setError(static_cast<NetworkError>(_recorded.error), "Replayed error");
+        setFinished(true);
+        emit metaDataChanged();
+        if (bytesAvailable())
+            emit readyRead();
+        emit finished();
+    }
+
+    void abort() override { }
+
+    qint64 bytesAvailable() const override { return _payload.size() + _fillerSize + QIODevice::bytesAvailable(); }
+    qint64 readData(char *data, qint64 maxlen) override {
+        if (!_payload.isEmpty()) {
+            qint64 len = std::min(qint64{_payload.size()}, maxlen);
+            memcpy(data, _payload.constData(), len);
+            _payload.remove(0, len);
+            return len;
+        }
+        qint64 len = std::min(_fillerSize, maxlen);
+        std::fill_n(data, len, 'R');
+        _fillerSize -= len;
+        return len;
+    }
+
+private:
+    Recorded _recorded;
+    QByteArray _payload;
+    qint64 _fillerSize;
+};
+
 class FakeQNAM : public QNetworkAccessManager
 {
 public:
@@ -815,6 +885,7 @@ public:
     void setOverride(const Override &override) { _override = override; }
 
 protected:
+    friend class FakePoolQNAM;
     QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
                                          QIODevice *outgoingData = 0) {
         if (_override) {
@@ -852,14 +923,42 @@ protected:
     }
 };
 
+// Another QNAM on the same fake server, like the ones in the account's QNAM pool.
+// The replies are its children, as with a real QNAM.
+class FakePoolQNAM : public QNetworkAccessManager
+{
+    QPointer<FakeQNAM> _server;
+
+public:
+    FakePoolQNAM(FakeQNAM *server) : _server{server} { }
+
+protected:
+    QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
+                                         QIODevice *outgoingData = 0) override {
+        Q_ASSERT(_server);
+        auto reply = _server->createRequest(op, request, outgoingData);
+        reply->setParent(this);
+        return reply;
+    }
+};
+
 class FakeCredentials : public OCC::AbstractCredentials
 {
     QNetworkAccessManager *_qnam;
+    mutable bool _qnamHandedOut = false;
 public:
     FakeCredentials(QNetworkAccessManager *qnam) : _qnam{qnam} { }
     virtual QString authType() const { return "test"; }
     virtual QString user() const { return "admin"; }
-    virtual QNetworkAccessManager *createQNAM() const { return _qnam; }
+    // The given QNAM first, then a distinct one per call that fills the account's QNAM pool
+    virtual QNetworkAccessManager *createQNAM() const {
+        auto fakeQnam = dynamic_cast<FakeQNAM *>(_qnam);
+        if (!_qnamHandedOut || !fakeQnam) {
+            _qnamHandedOut = true;
+            return _qnam;
+        }
+        return new FakePoolQNAM{fakeQnam};
+    }
     virtual bool ready() const { return true; }
     virtual void fetchFromKeychain() { }
     virtual void askFromUser() { }
@@ -1016,6 +1115,195 @@ private:
     }
 };
 
+/**
+ * Replays a recording made with OWNCLOUD_SYNC_RECORDING_DIR, see OCC::SyncRecorder
+ *
+ * populate() recreates the journal and the local tree of the recording in a
+ * FakeFolder, files get filler contents of the recorded size. The server of the
+ * folder then answers the recorded requests with the recorded replies, in order
+ * for each verb and path. Requests that weren't recorded, like uploads to a new
+ * transfer id, succeed when they change something and get a 404 otherwise.
+ *
+ * The SyncReplay must outlive the syncs of the folder.
+ */
+class SyncReplay
+{
+public:
+    bool load(const QString &fileName) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Could not open" << fileName << file.errorString();
+            return false;
+        }
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine().trimmed();
+            if (line.isEmpty())
+                continue;
+            const QJsonObject entry = QJsonDocument::fromJson(line).object();
+            const QString kind = entry.value("kind").toString();
+            if (kind == "session") {
+                if (entry.value("version").toInt() > OCC::SyncRecorder::formatVersion) {
+                    qWarning() << "Unsupported recording version" << entry.value("version").toInt();
+                    return false;
+                }
+                _session = entry;
+            } else if (kind == "journal") {
+                _journal.append(entry);
+            } else if (kind == "local") {
+                _local.append(entry);
+            } else if (kind == "request") {
+                FakeReplayReply::Recorded recorded;
+                recorded.status = entry.value("status").toInt();
+                recorded.error = entry.value("error").toInt();
+                recorded.body = entry.value("body").toString().toUtf8();
+                recorded.size = entry.value("bytesReceived").toVariant().toLongLong();
+                recorded.duration = entry.value("duration").toVariant().toLongLong();
+                const QJsonObject headers = entry.value("replyHeaders").toObject();
+                for (auto it = headers.begin(); it != headers.end(); ++it) {
+                    // Contents are filler, so are the lengths
+                    if (it.key() == "OC-Checksum" || it.key() == "Content-Length")
+                        continue;
+                    recorded.headers.append({ it.key().toLatin1(), it.value().toString().toUtf8() });
+                }
+                const QByteArray verb = entry.value("verb").toString().toLatin1();
+                _replies[requestKey(verb, entry.value("path").toString())].enqueue(recorded);
+                _requestCount++;
+            }
+        }
+        if (_session.isEmpty()) {
+            qWarning() << "No session in" << fileName;
+            return false;
+        }
+        return true;
+    }
+
+    /// Delay the replies by the recorded durations
+    void setTiming(bool timing) { _timing = timing; }
+
+    void populate(FakeFolder &folder) {
+        const QString localPath = folder.localPath();
+        QHash<QString, quint64> inodes; // recorded inode -> new inode
+        for (const auto &entry : _local) {
+            const QString path = localPath + entry.value("path").toString();
+            const int type = entry.value("type").toInt();
+            if (type == ItemTypeDirectory) {
+                QDir().mkpath(path);
+            } else if (type == ItemTypeFile) {
+                QDir().mkpath(QFileInfo(path).path());
+                QFile file(path);
+                file.open(QFile::WriteOnly);
+                file.resize(entry.value("size").toVariant().toLongLong());
+                file.close();
+                OCC::FileSystem::setModTime(path, entry.value("mtime").toVariant().toLongLong());
+            } else {
+                qWarning() << "Not replaying the symbolic link" << path;
+                continue;
+            }
+            csync_file_stat_t stat;
+            if (csync_vio_local_stat(path.toUtf8().constData(), &stat) == 0)
+                inodes.insert(entry.value("inode").toString(), stat.inode);
+        }
+
+        auto &journal = folder.syncJournal();
+        for (const auto &entry : _journal) {
+            OCC::SyncJournalFileRecord rec;
+            rec._path = entry.value("path").toString().toUtf8();
+            rec._type = static_cast<ItemType>(entry.value("type").toInt());
+            rec._inode = inodes.value(entry.value("inode").toString(), 0);
+            rec._modtime = entry.value("mtime").toVariant().toLongLong();
+            rec._fileSize = entry.value("size").toVariant().toLongLong();
+            rec._etag = entry.value("etag").toString().toUtf8();
+            rec._fileId = entry.value("fileId").toString().toUtf8();
+            rec._remotePerm = OCC::RemotePermissions(entry.value("permissions").toString());
+            rec._checksumHeader = entry.value("checksum").toString().toUtf8();
+            rec._serverHasIgnoredFiles = entry.value("serverHasIgnoredFiles").toBool();
+            rec._e2eMangledName = entry.value("e2eMangledName").toString().toUtf8();
+            journal.setFileRecord(rec);
+        }
+        QStringList blackList;
+        for (const auto &path : _session.value("selectiveSyncBlackList").toArray())
+            blackList.append(path.toString());
+        journal.setSelectiveSyncList(OCC::SyncJournalDb::SelectiveSyncBlackList, blackList);
+
+        auto account = folder.syncEngine().account();
+        _accountPath = account->url().path(QUrl::FullyEncoded);
+        if (!_accountPath.endsWith('/'))
+            _accountPath += '/';
+        _davPath = account->davUrl().path(QUrl::FullyEncoded).mid(_accountPath.size());
+        _recordedDavPath = _session.value("davPath").toString();
+        QString remotePath = _session.value("remotePath").toString();
+        remotePath.remove(QRegularExpression("^/+|/+$"));
+        if (!remotePath.isEmpty())
+            _recordedDavPath += QString::fromLatin1(QUrl::toPercentEncoding(remotePath, "/")) + '/';
+
+        folder.setServerOverride([this](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) {
+            return reply(op, request);
+        });
+    }
+
+    int requestCount() const { return _requestCount; }
+    int unmatchedCount() const { return _unmatchedCount; }
+
+private:
+    static QString requestKey(const QByteArray &verb, QString path) {
+        while (path.endsWith('/'))
+            path.chop(1);
+        return QString::fromLatin1(verb) + ' ' + path;
+    }
+
+    QNetworkReply *reply(QNetworkAccessManager::Operation op, const QNetworkRequest &request) {
+        QByteArray verb = request.attribute(QNetworkRequest::CustomVerbAttribute).toByteArray();
+        if (verb.isEmpty()) {
+            verb = op == QNetworkAccessManager::GetOperation ? "GET"
+                : op == QNetworkAccessManager::PutOperation ? "PUT"
+                : op == QNetworkAccessManager::DeleteOperation ? "DELETE"
+                : op == QNetworkAccessManager::HeadOperation ? "HEAD" : "POST";
+        }
+        QString path = request.url().path(QUrl::FullyEncoded).mid(_accountPath.size());
+        if (path.startsWith(_davPath) || path == _davPath.left(_davPath.size() - 1))
+            path = _recordedDavPath + path.mid(_davPath.size());
+
+        auto it = _replies.find(requestKey(verb, path));
+        if (it == _replies.end() || it->isEmpty()) {
+            qWarning() << "Not in the recording:" << verb << path;
+            _unmatchedCount++;
+            FakeReplayReply::Recorded recorded;
+            if (verb == "PUT" || verb == "MKCOL" || verb == "MOVE" || verb == "DELETE" || verb == "PROPPATCH") {
+                recorded.status = verb == "DELETE" ? 204 : 201;
+                recorded.headers = {
+                    { "ETag", generateEtag().toLatin1() },
+                    { "OC-FileId", generateFileId() },
+                    { "X-OC-MTime", "accepted" }
+                };
+            } else {
+                recorded.status = 404;
+                recorded.error = QNetworkReply::ContentNotFoundError;
+            }
+            return new FakeReplayReply(recorded, 0, op, request, nullptr);
+        }
+
+        FakeReplayReply::Recorded recorded = it->dequeue();
+        if (verb == "PROPFIND") {
+            // The hrefs are absolute paths on the recorded server
+            recorded.body.replace(
+                QByteArray(_session.value("accountPath").toString().toUtf8() + _recordedDavPath.toUtf8()),
+                QByteArray(_accountPath.toUtf8() + _davPath.toUtf8()));
+        }
+        return new FakeReplayReply(recorded, _timing ? recorded.duration : 0, op, request, nullptr);
+    }
+
+    QJsonObject _session;
+    QList<QJsonObject> _journal;
+    QList<QJsonObject> _local;
+    QHash<QString, QQueue<FakeReplayReply::Recorded>> _replies;
+    QString _accountPath;
+    QString _davPath;
+    QString _recordedDavPath; // including the remote path
+    bool _timing = false;
+    int _requestCount = 0;
+    int _unmatchedCount = 0;
+};
+
 /* Return the FileInfo for a conflict file for the specified relative filename */
 inline const FileInfo *findConflict(FileInfo &dir, const QString &filename)
 {
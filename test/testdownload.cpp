@@ -9,6 +9,11 @@
 #include "syncenginetestutils.h"
 #include <syncengine.h>
 #include <owncloudpropagator.h>
+#include "filesystem.h"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
 
 using namespace OCC;
 
@@ -242,6 +247,50 @@ private slots:
         QCOMPARE(getItem(completeSpy, "A/resendme")->_status, SyncFileItem::NormalError);
         QVERIFY(getItem(completeSpy, "A/resendme")->_errorString.contains(serverMessage));
     }
+
+    void testSmallDownloadWithoutTmpFile_data()
+    {
+        QTest::addColumn<bool>("procAvailable");
+        QTest::newRow("anonymous file") << true;
+        QTest::newRow("no /proc") << false;
+    }
+
+    void testSmallDownloadWithoutTmpFile()
+    {
+        QFETCH(bool, procAvailable);
+
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        const int fd = FileSystem::openAnonymousFile(fakeFolder.localPath() + "A");
+        if (fd == -1)
+            QSKIP("No anonymous files in this directory");
+#ifdef Q_OS_UNIX
+        ::close(fd);
+#endif
+
+        fakeFolder.remoteModifier().insert("A/small", 100);
+        fakeFolder.remoteModifier().appendByte("A/a1"); // replaces an existing file
+
+        auto tmpFiles = [&]() {
+            return QDir(fakeFolder.localPath() + "A").entryList({ ".*.~*" }, QDir::Files | QDir::Hidden);
+        };
+        QStringList tmpFilesDuringDownload;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation)
+                tmpFilesDuringDownload += tmpFiles();
+            return nullptr;
+        });
+
+        // Where /proc is missing the anonymous file can't be opened, the named one is used instead
+        if (!procAvailable)
+            qputenv("OWNCLOUD_PROC_FD_DIR", fakeFolder.localPath().toUtf8() + "no-proc");
+        const bool synced = fakeFolder.syncOnce();
+        qunsetenv("OWNCLOUD_PROC_FD_DIR");
+        QVERIFY(synced);
+
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(tmpFilesDuringDownload.isEmpty(), procAvailable);
+        QVERIFY(tmpFiles().isEmpty());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestDownload)
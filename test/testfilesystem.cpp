@@ -70,6 +70,70 @@ private slots:
         QCOMPARE(sSum, sum);
     }
 
+    void testTrashCollisions()
+    {
+#if defined Q_OS_UNIX && !defined Q_OS_MAC
+        QTemporaryDir dataHome;
+        qputenv("XDG_DATA_HOME", dataHome.path().toLocal8Bit());
+        QDir(dataHome.path()).mkpath("Trash/files/a");
+
+        QDir(_root.path()).mkpath("trash1");
+        QDir(_root.path()).mkpath("trash2/a");
+        QVERIFY(writeRandomFile(_root.path() + "/trash1/a"));
+
+        {
+            Trash trash;
+            QString error;
+            QVERIFY(trash.move(_root.path() + "/trash1/a", &error));
+            QVERIFY(trash.move(_root.path() + "/trash2/a", &error));
+            QVERIFY(!trash.move(_root.path() + "/trash2/missing", &error));
+        }
+        qunsetenv("XDG_DATA_HOME");
+
+        QVERIFY(QFileInfo(dataHome.path() + "/Trash/files/a.1").isFile());
+        QVERIFY(QFileInfo(dataHome.path() + "/Trash/files/a.2").isDir());
+        QFile info(dataHome.path() + "/Trash/info/a.2.trashinfo");
+        QVERIFY(info.open(QIODevice::ReadOnly));
+        QVERIFY(info.readAll().contains("Path=" + QUrl::toPercentEncoding(_root.path() + "/trash2/a", "~_-./")));
+        QVERIFY(!QFileInfo::exists(dataHome.path() + "/Trash/info/a.trashinfo"));
+#else
+        QSKIP("Moving to the trash is only implemented on linux");
+#endif
+    }
+
+    void testTrashInfoReservesName()
+    {
+#if defined Q_OS_UNIX && !defined Q_OS_MAC
+        QTemporaryDir dataHome;
+        qputenv("XDG_DATA_HOME", dataHome.path().toLocal8Bit());
+        QDir(_root.path()).mkpath("trash3");
+        QVERIFY(writeRandomFile(_root.path() + "/trash3/b"));
+        QVERIFY(writeRandomFile(_root.path() + "/trash3/c"));
+
+        Trash trash;
+        QString error;
+        QVERIFY(trash.move(_root.path() + "/trash3/b", &error));
+        // The info file exists as soon as the file is in the trash
+        QVERIFY(QFileInfo(dataHome.path() + "/Trash/files/b").isFile());
+        QVERIFY(QFileInfo(dataHome.path() + "/Trash/info/b.trashinfo").isFile());
+
+        // Another process reserved "c" after the trash was listed
+        QFile reserved(dataHome.path() + "/Trash/info/c.trashinfo");
+        QVERIFY(reserved.open(QIODevice::WriteOnly));
+        reserved.close();
+        QVERIFY(trash.move(_root.path() + "/trash3/c", &error));
+        qunsetenv("XDG_DATA_HOME");
+
+        QVERIFY(!QFileInfo::exists(dataHome.path() + "/Trash/files/c"));
+        QVERIFY(QFileInfo(dataHome.path() + "/Trash/files/c.1").isFile());
+        QCOMPARE(QFileInfo(dataHome.path() + "/Trash/info/c.trashinfo").size(), qint64(0));
+        QFile info(dataHome.path() + "/Trash/info/c.1.trashinfo");
+        QVERIFY(info.open(QIODevice::ReadOnly));
+        QVERIFY(info.readAll().contains("Path=" + QUrl::toPercentEncoding(_root.path() + "/trash3/c", "~_-./")));
+#else
+        QSKIP("Moving to the trash is only implemented on linux");
+#endif
+    }
 };
 
 QTEST_APPLESS_MAIN(TestFileSystem)
@@ -119,6 +119,12 @@ public:
     }
 
 private slots:
+    void initTestCase()
+    {
+        // The subfolders may still be registered in the background
+        QTRY_VERIFY(_watcher->isInitialScanDone());
+    }
+
     void init()
     {
         _pathChangedSpy->clear();
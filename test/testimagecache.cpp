@@ -0,0 +1,190 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+
+#include "syncenginetestutils.h"
+#include "imagecache.h"
+
+using namespace OCC;
+
+// Answers with the image, or with a 304 if the etag matches
+class FakeImageReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    FakeImageReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+        const QByteArray &etag, const QByteArray &data, QObject *parent)
+        : QNetworkReply{ parent }
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+        if (!etag.isEmpty() && request.rawHeader("If-None-Match") == etag) {
+            setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 304);
+        } else {
+            setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+            setRawHeader("ETag", etag);
+            _payload = data;
+        }
+        QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond()
+    {
+        emit metaDataChanged();
+        if (bytesAvailable())
+            emit readyRead();
+        setFinished(true);
+        emit finished();
+    }
+
+    void abort() override { }
+    qint64 bytesAvailable() const override { return _payload.size() + QIODevice::bytesAvailable(); }
+
+    qint64 readData(char *data, qint64 maxlen) override
+    {
+        qint64 len = qMin(qint64{ _payload.size() }, maxlen);
+        std::copy(_payload.cbegin(), _payload.cbegin() + len, data);
+        _payload.remove(0, static_cast<int>(len));
+        return len;
+    }
+
+private:
+    QByteArray _payload;
+};
+
+class TestImageCache : public QObject
+{
+    Q_OBJECT
+
+    struct Image
+    {
+        QByteArray etag;
+        QByteArray data;
+    };
+    QHash<QUrl, Image> _serverImages;
+    QVector<QByteArray> _ifNoneMatchHeaders;
+    FakeQNAM *_qnam = nullptr;
+
+    // Fetches the image like the jobs do, unless the cached entry is fresh
+    QByteArray fetch(const QUrl &url, const ImageCache::Entry &cached)
+    {
+        auto cache = ImageCache::instance();
+        if (cache->isFresh(cached))
+            return cached.data;
+
+        QNetworkRequest request(url);
+        cache->prepareRequest(request, cached);
+        QScopedPointer<QNetworkReply> reply(_qnam->get(request));
+        QTest::qWaitFor([&] { return reply->isFinished(); }, 5000);
+        return cache->handleReply(url, reply.data(), cached);
+    }
+
+    QByteArray fetch(const QUrl &url) { return fetch(url, ImageCache::instance()->lookup(url)); }
+
+    static ImageCache::Entry stale(ImageCache::Entry entry)
+    {
+        entry.validatedAt -= 60 * 60 * 1000;
+        return entry;
+    }
+
+    static QString cacheFile(const QUrl &url)
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/images/")
+            + QString::fromLatin1(QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex());
+    }
+
+    static void setValidatedSecsAgo(const QUrl &url, int secs)
+    {
+        QFile file(cacheFile(url));
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-secs), QFileDevice::FileModificationTime));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/images")).removeRecursively();
+        // Read by the cache when it is first used, in MiB
+        qputenv("OWNCLOUD_IMAGE_CACHE_SIZE", "1");
+
+        _qnam = new FakeQNAM(FileInfo());
+        _qnam->setParent(this);
+        _qnam->setOverride([this](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            _ifNoneMatchHeaders.append(request.rawHeader("If-None-Match"));
+            const auto image = _serverImages.value(request.url());
+            return new FakeImageReply(op, request, image.etag, image.data, _qnam);
+        });
+    }
+
+    void init()
+    {
+        _ifNoneMatchHeaders.clear();
+    }
+
+    void testNotModifiedReusesCachedData()
+    {
+        const QUrl url(QStringLiteral("http://localhost/avatar/admin/128"));
+        _serverImages[url] = { "\"v1\"", "avatar v1" };
+
+        QCOMPARE(fetch(url), QByteArray("avatar v1"));
+        QCOMPARE(_ifNoneMatchHeaders, QVector<QByteArray>({ QByteArray() }));
+
+        // Fresh entries don't need a request
+        QCOMPARE(fetch(url), QByteArray("avatar v1"));
+        QCOMPARE(_ifNoneMatchHeaders.size(), 1);
+
+        // Stale ones are revalidated, a 304 keeps the cached data
+        auto cached = ImageCache::instance()->lookup(url);
+        QVERIFY(!ImageCache::instance()->isFresh(stale(cached)));
+        QCOMPARE(fetch(url, stale(cached)), QByteArray("avatar v1"));
+        QCOMPARE(_ifNoneMatchHeaders.size(), 2);
+        QCOMPARE(_ifNoneMatchHeaders.last(), QByteArray("\"v1\""));
+        QVERIFY(ImageCache::instance()->isFresh(ImageCache::instance()->lookup(url)));
+
+        // The image changed on the server
+        _serverImages[url] = { "\"v2\"", "avatar v2" };
+        QCOMPARE(fetch(url, stale(cached)), QByteArray("avatar v2"));
+        QCOMPARE(ImageCache::instance()->lookup(url).data, QByteArray("avatar v2"));
+        QCOMPARE(ImageCache::instance()->lookup(url).etag, QByteArray("\"v2\""));
+    }
+
+    void testEvictsLeastRecentlyValidated()
+    {
+        QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/images")).removeRecursively();
+
+        QVector<QUrl> urls;
+        for (int i = 0; i < 4; ++i) {
+            urls.append(QUrl(QStringLiteral("http://localhost/thumbnail/%1").arg(i)));
+            _serverImages[urls[i]] = { QByteArray::number(i), QByteArray(300 * 1024, char('a' + i)) };
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            QCOMPARE(fetch(urls[i]).size(), 300 * 1024);
+            setValidatedSecsAgo(urls[i], 300 - i * 100);
+        }
+
+        // Revalidating the oldest entry makes it the most recent one
+        QCOMPARE(fetch(urls[0], stale(ImageCache::instance()->lookup(urls[0]))).size(), 300 * 1024);
+        QCOMPARE(_ifNoneMatchHeaders.last(), QByteArray("0"));
+
+        // Going over the limit evicts the least recently validated entries
+        QCOMPARE(fetch(urls[3]).size(), 300 * 1024);
+        QVERIFY(ImageCache::instance()->lookup(urls[0]).isValid());
+        QVERIFY(!ImageCache::instance()->lookup(urls[1]).isValid());
+        QVERIFY(!ImageCache::instance()->lookup(urls[2]).isValid());
+        QVERIFY(ImageCache::instance()->lookup(urls[3]).isValid());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestImageCache)
+#include "testimagecache.moc"
@@ -0,0 +1,122 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/iogovernor.h"
+
+using namespace OCC;
+
+static const qint64 msecs = 1000 * 1000;
+
+// A governor on a fake clock that only moves while the caller sleeps
+class FakeClockGovernor
+{
+public:
+    FakeClockGovernor(qint64 maxBytesPerSecond, qint64 maxOperationsPerSecond)
+        : governor(maxBytesPerSecond, maxOperationsPerSecond,
+              [this] { return now; },
+              [this](qint64 nsecs) {
+                  sleeps.append(nsecs);
+                  now += nsecs;
+              })
+    {
+    }
+
+    qint64 now = 0;
+    QVector<qint64> sleeps;
+    IoGovernor governor;
+};
+
+class TestIoGovernor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testUnlimited()
+    {
+        FakeClockGovernor fake(0, 0);
+        fake.governor.acquire(1000LL * 1000 * 1000, 1000);
+        QVERIFY(fake.sleeps.isEmpty());
+
+        auto stats = fake.governor.takeStats();
+        QCOMPARE(stats.bytes, 1000LL * 1000 * 1000);
+        QCOMPARE(stats.operations, 1000LL);
+        QCOMPARE(stats.throttledMsecs, 0LL);
+    }
+
+    void testBurstCap()
+    {
+        // 1 byte per µs, the burst is worth 100ms
+        FakeClockGovernor fake(1000 * 1000, 0);
+
+        fake.governor.acquire(100 * 1000, 0);
+        QVERIFY(fake.sleeps.isEmpty());
+        fake.governor.acquire(1, 0);
+        QCOMPARE(fake.sleeps, QVector<qint64>({ 1000 }));
+
+        // Being idle does not save up more than the burst
+        fake.sleeps.clear();
+        fake.now += 10 * 1000 * msecs;
+        fake.governor.acquire(100 * 1000, 0);
+        QVERIFY(fake.sleeps.isEmpty());
+        fake.governor.acquire(100 * 1000, 0);
+        QCOMPARE(fake.sleeps, QVector<qint64>({ 100 * msecs }));
+    }
+
+    void testRefillRate()
+    {
+        FakeClockGovernor fake(1000 * 1000, 0);
+        fake.governor.acquire(100 * 1000, 0);
+
+        // Half of the burst is back after 50ms
+        fake.now += 50 * msecs;
+        fake.governor.acquire(50 * 1000, 0);
+        QVERIFY(fake.sleeps.isEmpty());
+        fake.governor.acquire(50 * 1000, 0);
+        QCOMPARE(fake.sleeps, QVector<qint64>({ 50 * msecs }));
+
+        // Sustained reads run at the configured rate
+        const qint64 start = fake.now;
+        for (int i = 0; i < 100; ++i)
+            fake.governor.acquire(10 * 1000, 0);
+        QCOMPARE(fake.now - start, 1000 * msecs);
+        QCOMPARE(fake.governor.takeStats().throttledMsecs, 50LL + 1000);
+    }
+
+    void testAcquireMoreThanBurst()
+    {
+        FakeClockGovernor fake(1000 * 1000, 0);
+
+        // Allowed in one go, the caller waits for everything beyond the burst
+        fake.governor.acquire(1000 * 1000, 0);
+        QCOMPARE(fake.sleeps, QVector<qint64>({ 900 * msecs }));
+
+        // The burst is used up afterwards, the next caller waits for its own share
+        fake.governor.acquire(1, 0);
+        QCOMPARE(fake.sleeps, QVector<qint64>({ 900 * msecs, 1000 }));
+    }
+
+    void testOperationsBudget()
+    {
+        // 10ms per operation, the burst is worth 10 operations
+        FakeClockGovernor fake(0, 100);
+        for (int i = 0; i < 10; ++i)
+            fake.governor.acquire(0);
+        QVERIFY(fake.sleeps.isEmpty());
+        fake.governor.acquire(0);
+        QCOMPARE(fake.sleeps, QVector<qint64>({ 10 * msecs }));
+
+        // The stricter of both budgets applies
+        FakeClockGovernor both(1000 * 1000, 100);
+        both.governor.acquire(200 * 1000, 1);
+        QCOMPARE(both.sleeps, QVector<qint64>({ 100 * msecs }));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestIoGovernor)
+#include "testiogovernor.moc"
@@ -424,6 +424,40 @@ private slots:
         QVERIFY(fakeFolder.syncOnce());
     }
 
+    /**
+     * Small transfers use the free slots next to the large ones, also in other directories
+     */
+    void testTransferClasses()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        const int largeSize = 200 * 1024;
+        for (int i = 0; i < 6; ++i)
+            fakeFolder.localModifier().insert(QString("A/large%1").arg(i), largeSize);
+        for (int i = 0; i < 6; ++i)
+            fakeFolder.localModifier().insert(QString("B/small%1").arg(i), 10);
+
+        int runningLarge = 0, runningSmall = 0;
+        int maxLarge = 0, maxSmallNextToLarge = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::PutOperation)
+                return nullptr;
+            const QByteArray payload = outgoingData->readAll();
+            int &running = payload.size() >= largeSize ? runningLarge : runningSmall;
+            ++running;
+            maxLarge = qMax(maxLarge, runningLarge);
+            if (runningLarge > 0)
+                maxSmallNextToLarge = qMax(maxSmallNextToLarge, runningSmall);
+            auto reply = new DelayedReply<FakePutReply>(50, fakeFolder.remoteModifier(), op, request, payload, &fakeFolder.syncEngine());
+            QObject::connect(reply, &QNetworkReply::finished, [&running] { --running; });
+            return reply;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(maxLarge, 3);
+        QVERIFY(maxSmallNextToLarge > 0);
+    }
+
     /**
      * Checks whether subsequent large uploads are skipped after a 507 error
      */
@@ -606,6 +640,189 @@ private slots:
         QCOMPARE(fakeFolder.syncEngine().lastLocalDiscoveryStyle(), LocalDiscoveryStyle::FilesystemOnly);
     }
 
+    // Subtrees unchanged on both sides are not loaded but keep their journal entries
+    void testLocalDiscoveryUnchangedSubtrees()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.localModifier().mkdir("B/X");
+        fakeFolder.localModifier().insert("B/X/x1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), SIGNAL(itemCompleted(const SyncFileItemPtr &)));
+        fakeFolder.localModifier().appendByte("A/a1");
+        fakeFolder.remoteModifier().appendByte("C/c1");
+        fakeFolder.remoteModifier().insert("B/X/x2");
+
+        fakeFolder.syncEngine().setLocalDiscoveryOptions(LocalDiscoveryStyle::DatabaseAndFilesystem, { "A/a1" });
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "A/a1"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "C/c1"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "B/X/x2"));
+        QVERIFY(!itemDidComplete(completeSpy, "S/s1"));
+
+        for (const auto &path : { "A/a2", "B/b1", "B/X/x1", "C/c2", "S/s1", "S/s2" }) {
+            SyncJournalFileRecord record;
+            QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray(path), &record));
+            QVERIFY2(record.isValid(), path);
+        }
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    // A scoped sync leaves everything outside of the scope alone
+    void testSyncScope()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.localModifier().mkdir("A/X");
+        fakeFolder.localModifier().insert("A/X/x1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        fakeFolder.localModifier().insert("A/X/x2");
+        fakeFolder.remoteModifier().appendByte("A/X/x1");
+        fakeFolder.localModifier().insert("A/a3");
+        fakeFolder.remoteModifier().insert("B/b3");
+        fakeFolder.remoteModifier().remove("C/c1");
+        fakeFolder.remoteModifier().appendByte("A/a1");
+
+        fakeFolder.syncEngine().setSyncScope({ "A/X" });
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(fakeFolder.syncEngine().lastSyncWasScoped());
+        QVERIFY(fakeFolder.currentRemoteState().find("A/X/x2"));
+        QCOMPARE(fakeFolder.currentLocalState().find("A/X/x1")->size, fakeFolder.currentRemoteState().find("A/X/x1")->size);
+        QVERIFY(!fakeFolder.currentRemoteState().find("A/a3"));
+        QVERIFY(!fakeFolder.currentLocalState().find("B/b3"));
+        QVERIFY(fakeFolder.currentLocalState().find("C/c1"));
+        QVERIFY(fakeFolder.currentLocalState().find("A/a1")->size != fakeFolder.currentRemoteState().find("A/a1")->size);
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A"), &record));
+        QCOMPARE(record._etag, QByteArray("_invalid_"));
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("C/c1"), &record));
+        QVERIFY(record.isValid());
+
+        // The next sync catches up with the rest
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(!fakeFolder.syncEngine().lastSyncWasScoped());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testDownloadOnly()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        SyncOptions syncOptions;
+        syncOptions._syncMode = SyncMode::DownloadOnly;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        int nUpload = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) {
+            auto verb = request.attribute(QNetworkRequest::CustomVerbAttribute);
+            if (op == QNetworkAccessManager::PutOperation || op == QNetworkAccessManager::DeleteOperation
+                || verb == "MKCOL" || verb == "MOVE")
+                ++nUpload;
+            return nullptr;
+        });
+
+        fakeFolder.localModifier().insert("A/a3");
+        fakeFolder.localModifier().mkdir("A/Y");
+        fakeFolder.localModifier().insert("A/Y/y1");
+        fakeFolder.localModifier().appendByte("B/b1");
+        fakeFolder.localModifier().remove("C/c1");
+        fakeFolder.localModifier().rename("C/c2", "C/c3");
+        fakeFolder.localModifier().appendByte("S/s1");
+        fakeFolder.remoteModifier().appendByte("S/s1");
+        fakeFolder.remoteModifier().insert("B/b3");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nUpload, 0);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(fakeFolder.currentLocalState().find("B/b3"));
+        QVERIFY(!fakeFolder.currentLocalState().find("A/Y"));
+    }
+
+    void testUploadOnly()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        SyncOptions syncOptions;
+        syncOptions._syncMode = SyncMode::UploadOnly;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        QStringList listed;
+        int nGET = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "PROPFIND")
+                listed.append(request.url().path());
+            if (op == QNetworkAccessManager::GetOperation)
+                ++nGET;
+            return nullptr;
+        });
+
+        fakeFolder.localModifier().insert("A/a3");
+        fakeFolder.localModifier().setContents("B/b1", 'L');
+        fakeFolder.remoteModifier().appendByte("B/b1");
+        fakeFolder.localModifier().remove("C/c1");
+        fakeFolder.remoteModifier().remove("A/a2");
+        fakeFolder.remoteModifier().insert("S/s3");
+        fakeFolder.remoteModifier().appendByte("S/s1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nGET, 0);
+        auto remote = fakeFolder.currentRemoteState();
+        auto local = fakeFolder.currentLocalState();
+        QVERIFY(remote.find("A/a3"));
+        QCOMPARE(remote.find("B/b1")->size, local.find("B/b1")->size);
+        QCOMPARE(remote.find("B/b1")->contentChar, 'L');
+        QVERIFY(!remote.find("C/c1"));
+        QVERIFY(local.find("A/a2"));
+        QVERIFY(!local.find("S/s3"));
+        QVERIFY(local.find("S/s1")->size != remote.find("S/s1")->size);
+        // S has no local changes, its remote side is read from the db
+        for (const auto &path : listed)
+            QVERIFY(!path.endsWith("/S"));
+
+        // The skipped remote changes are picked up by a two-way sync
+        fakeFolder.syncEngine().setSyncOptions(SyncOptions());
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(fakeFolder.currentLocalState().find("S/s3"));
+    }
+
+    void testRecordAndReplay()
+    {
+        QTemporaryDir recordingDir;
+        QString recording;
+        FileInfo expected;
+        {
+            FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+            fakeFolder.remoteModifier().insert("A/a3", 30);
+            fakeFolder.remoteModifier().appendByte("B/b1");
+            fakeFolder.remoteModifier().remove("C/c1");
+            fakeFolder.localModifier().insert("S/s3");
+            qputenv("OWNCLOUD_SYNC_RECORDING_DIR", recordingDir.path().toLocal8Bit());
+            QVERIFY(fakeFolder.syncOnce());
+            qunsetenv("OWNCLOUD_SYNC_RECORDING_DIR");
+            expected = fakeFolder.currentLocalState();
+
+            const auto files = QDir(recordingDir.path()).entryList({ "sync-*.jsonl" });
+            QCOMPARE(files.size(), 1);
+            recording = recordingDir.path() + '/' + files.first();
+        }
+
+        SyncReplay replay;
+        QVERIFY(replay.load(recording));
+        QVERIFY(replay.requestCount() > 0);
+        FakeFolder fakeFolder{ FileInfo{} };
+        replay.populate(fakeFolder);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(replay.unmatchedCount(), 0);
+
+        auto local = fakeFolder.currentLocalState();
+        QCOMPARE(local.find("A/a3")->size, 30);
+        QCOMPARE(local.find("B/b1")->size, expected.find("B/b1")->size);
+        QVERIFY(!local.find("C/c1"));
+        QVERIFY(local.find("S/s3"));
+    }
+
     void testLocalDiscoveryDecision()
     {
         FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
@@ -638,6 +855,44 @@ private slots:
         QVERIFY(!engine.shouldDiscoverLocally(""));
     }
 
+    // Unchanged files are spilled to the journal when over the memory budget
+    void testDiscoveryMemoryBudget()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        QVERIFY(fakeFolder.syncOnce());
+
+        SyncOptions syncOptions;
+        syncOptions._discoveryMemoryBudget = 1;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), SIGNAL(itemCompleted(const SyncFileItemPtr &)));
+        fakeFolder.localModifier().appendByte("A/a1");
+        fakeFolder.localModifier().remove("A/a2");
+        fakeFolder.remoteModifier().appendByte("B/b1");
+        fakeFolder.remoteModifier().remove("B/b2");
+        fakeFolder.remoteModifier().rename("C/c1", "C/c3");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "A/a1"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "A/a2"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "B/b1"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "B/b2"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "C/c3"));
+        QVERIFY(!itemDidComplete(completeSpy, "S/s1"));
+
+        // The records of the spilled files survive the journal cleanup
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("S/s1"), &record));
+        QVERIFY(record.isValid());
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("A/a2"), &record));
+        QVERIFY(!record.isValid());
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("S/s1"), &record));
+        QVERIFY(record.isValid());
+    }
+
     void testDiscoveryHiddenFile()
     {
         FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
@@ -664,6 +919,45 @@ private slots:
         QVERIFY(fakeFolder.currentRemoteState().find("B/.hidden"));
     }
 
+    // A folder is removed on the server and one file in it can't be removed
+    // locally: that file and its parents keep their records, the rest goes.
+    void testLocalRemovePartialFailure()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.remoteModifier().mkdir("A/sub");
+        fakeFolder.remoteModifier().insert("A/sub/s1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        auto hasRecord = [&](const QString &path) {
+            SyncJournalFileRecord rec;
+            fakeFolder.syncJournal().getFileRecord(path, &rec);
+            return rec.isValid();
+        };
+
+        fakeFolder.remoteModifier().remove("A");
+        // Read only, so A/sub/s1 can't be removed
+        QFile(fakeFolder.localPath() + "A/sub/").setPermissions(QFile::Permissions(0x5555));
+        QVERIFY(!fakeFolder.syncOnce());
+        QFile(fakeFolder.localPath() + "A/sub/").setPermissions(QFile::Permissions(0x7777));
+
+        QVERIFY(!QFileInfo::exists(fakeFolder.localPath() + "A/a1"));
+        QVERIFY(!QFileInfo::exists(fakeFolder.localPath() + "A/a2"));
+        QVERIFY(QFileInfo::exists(fakeFolder.localPath() + "A/sub/s1"));
+        QVERIFY(hasRecord("A"));
+        QVERIFY(hasRecord("A/sub"));
+        QVERIFY(hasRecord("A/sub/s1"));
+        QVERIFY(!hasRecord("A/a1"));
+        QVERIFY(!hasRecord("A/a2"));
+
+        // The next sync removes what is left
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(!QFileInfo::exists(fakeFolder.localPath() + "A"));
+        QVERIFY(!hasRecord("A"));
+        QVERIFY(!hasRecord("A/sub/s1"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void testNoLocalEncoding()
     {
         auto utf8Locale = QTextCodec::codecForLocale();
@@ -260,6 +260,26 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    void warningStatusKeptInUnchangedSubtree() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.syncEngine().excludedFiles().addManualExclude("B/b1");
+        fakeFolder.localModifier().appendByte("B/b1");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("B/b1"), SyncFileStatus(SyncFileStatus::StatusWarning));
+
+        // B is not walked at all, its warning must survive
+        StatusPushSpy statusSpy(fakeFolder.syncEngine());
+        fakeFolder.localModifier().appendByte("A/a1");
+        fakeFolder.syncEngine().setLocalDiscoveryOptions(LocalDiscoveryStyle::DatabaseAndFilesystem, { "A/a1" });
+        fakeFolder.scheduleSync();
+        fakeFolder.execUntilBeforePropagation();
+        QVERIFY(fakeFolder.syncEngine().unchangedSubtrees().contains("B"));
+        QCOMPARE(statusSpy.statusOf("B/b1"), SyncFileStatus(SyncFileStatus::StatusNone));
+        fakeFolder.execUntilFinished();
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("B/b1"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("B"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+    }
+
     void warningStatusForExcludedFile_CasePreserving() {
         FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
         fakeFolder.syncEngine().excludedFiles().addManualExclude("B");
@@ -10,6 +10,7 @@
 
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
+#include "common/c_jhash.h"
 
 using namespace OCC;
 
@@ -270,6 +271,98 @@ private slots:
         QCOMPARE(getEtag("foodir/sub"), initialEtag);
     }
 
+    void testGetSubdirectories()
+    {
+        auto makeEntry = [&](const QByteArray &path, ItemType type) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = type;
+            record._etag = "etag";
+            _db.setFileRecord(record);
+        };
+
+        makeEntry("subdirs", ItemTypeDirectory);
+        makeEntry("subdirs/a", ItemTypeDirectory);
+        makeEntry("subdirs/a/deeper", ItemTypeDirectory);
+        makeEntry("subdirs/b", ItemTypeDirectory);
+        makeEntry("subdirs/file", ItemTypeFile);
+        makeEntry("subdirs-2", ItemTypeDirectory);
+        makeEntry("subdirs-2/c", ItemTypeDirectory);
+
+        bool onlyDirectories = true;
+        auto list = [&](const QByteArray &path) {
+            QByteArrayList result;
+            _db.getSubdirectories(path, [&](const SyncJournalFileRecord &rec) {
+                onlyDirectories &= rec._type == ItemTypeDirectory;
+                result.append(rec._path);
+            });
+            return result;
+        };
+
+        auto subs = list("subdirs");
+        std::sort(subs.begin(), subs.end());
+        QCOMPARE(subs, QByteArrayList() << "subdirs/a" << "subdirs/b");
+        QCOMPARE(list("subdirs/a"), QByteArrayList() << "subdirs/a/deeper");
+        QVERIFY(list("subdirs/b").isEmpty());
+
+        auto root = list("");
+        QVERIFY(root.contains("subdirs"));
+        QVERIFY(root.contains("subdirs-2"));
+        QVERIFY(!root.contains("subdirs/a"));
+        QVERIFY(onlyDirectories);
+    }
+
+    void testGetSubdirectoriesOfLargeTree()
+    {
+        auto makeEntry = [&](const QByteArray &path, ItemType type) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = type;
+            record._etag = "etag";
+            _db.setFileRecord(record);
+        };
+
+        // Deep subtrees, and siblings that sort between a folder and its contents
+        QByteArrayList expected;
+        for (int i = 0; i < 20; ++i) {
+            const QByteArray dir = "large/" + QByteArray::number(i);
+            makeEntry(dir, ItemTypeDirectory);
+            makeEntry(dir + "-x", ItemTypeDirectory);
+            makeEntry(dir + ".txt", ItemTypeFile);
+            expected << dir << dir + "-x";
+            QByteArray deep = dir;
+            for (int depth = 0; depth < 50; ++depth) {
+                deep += "/d";
+                makeEntry(deep, ItemTypeDirectory);
+                makeEntry(deep + "/file", ItemTypeFile);
+            }
+        }
+        makeEntry("large", ItemTypeDirectory);
+        makeEntry("large0", ItemTypeDirectory);
+        makeEntry("large0/a", ItemTypeDirectory);
+
+        bool ok = true;
+        auto list = [&](const QByteArray &path) {
+            QByteArrayList result;
+            ok &= _db.getSubdirectories(path, [&](const SyncJournalFileRecord &rec) {
+                result.append(rec._path);
+            });
+            return result;
+        };
+
+        std::sort(expected.begin(), expected.end());
+        QCOMPARE(list("large"), expected);
+        QCOMPARE(list("large/3/d/d"), QByteArrayList() << "large/3/d/d/d");
+        QVERIFY(list("large/3.txt").isEmpty());
+
+        auto root = list("");
+        QVERIFY(root.contains("large"));
+        QVERIFY(root.contains("large0"));
+        QVERIFY(!root.contains("large/0"));
+        QVERIFY(!root.contains("large0/a"));
+        QVERIFY(ok);
+    }
+
     void testRecursiveDelete()
     {
         auto makeEntry = [&](const QByteArray &path) {
@@ -320,6 +413,188 @@ private slots:
         QVERIFY(checkElements());
     }
 
+    void testPHashMigration()
+    {
+        const QString dbPath = _tempDir.path() + "/phash.db";
+        const QByteArrayList paths = { "foo", "foo/bar", "foo/bar/some file.txt" };
+        {
+            SyncJournalDb db(dbPath);
+            for (const auto &path : paths) {
+                SyncJournalFileRecord record;
+                record._path = path;
+                QVERIFY(db.setFileRecord(record));
+            }
+            db.close();
+        }
+
+        // Turn it into a journal written by an older client
+        sqlite3 *raw = nullptr;
+        QCOMPARE(sqlite3_open(dbPath.toUtf8().constData(), &raw), SQLITE_OK);
+        for (const auto &path : paths) {
+            auto legacy = static_cast<qint64>(c_jhash64((uint8_t *)path.data(), path.size(), 0));
+            auto sql = QByteArray("UPDATE metadata SET phash=") + QByteArray::number(legacy)
+                + " WHERE path='" + path + "';";
+            QCOMPARE(sqlite3_exec(raw, sql.constData(), nullptr, nullptr, nullptr), SQLITE_OK);
+        }
+        QCOMPARE(sqlite3_exec(raw, "UPDATE version SET phashVersion = NULL;", nullptr, nullptr, nullptr), SQLITE_OK);
+        sqlite3_close(raw);
+
+        // Opening it rehashes all records
+        {
+            SyncJournalDb db(dbPath);
+            for (const auto &path : paths) {
+                SyncJournalFileRecord record;
+                QVERIFY(db.getFileRecord(path, &record));
+                QVERIFY(record.isValid());
+            }
+            db.close();
+        }
+
+        QCOMPARE(sqlite3_open(dbPath.toUtf8().constData(), &raw), SQLITE_OK);
+        sqlite3_stmt *stmt = nullptr;
+        QCOMPARE(sqlite3_prepare_v2(raw, "SELECT phash, path FROM metadata;", -1, &stmt, nullptr), SQLITE_OK);
+        int rows = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto path = QByteArray(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
+            QCOMPARE(sqlite3_column_int64(stmt, 0), SyncJournalDb::getPHash(path));
+            ++rows;
+        }
+        sqlite3_finalize(stmt);
+        QCOMPARE(sqlite3_prepare_v2(raw, "SELECT phashVersion FROM version;", -1, &stmt, nullptr), SQLITE_OK);
+        QCOMPARE(sqlite3_step(stmt), SQLITE_ROW);
+        QCOMPARE(sqlite3_column_int(stmt, 0), 1);
+        sqlite3_finalize(stmt);
+        sqlite3_close(raw);
+        QCOMPARE(rows, paths.size());
+    }
+
+    void testMetadataLayoutMigration()
+    {
+        // A journal as created by older clients
+        const QString dbPath = _tempDir.path() + "/layout.db";
+        sqlite3 *raw = nullptr;
+        QCOMPARE(sqlite3_open(dbPath.toUtf8().constData(), &raw), SQLITE_OK);
+        QCOMPARE(sqlite3_exec(raw, "CREATE TABLE metadata(phash INTEGER(8), pathlen INTEGER, path VARCHAR(4096),"
+                                   " inode INTEGER, uid INTEGER, gid INTEGER, mode INTEGER, modtime INTEGER(8),"
+                                   " type INTEGER, md5 VARCHAR(32), PRIMARY KEY(phash));",
+                     nullptr, nullptr, nullptr),
+            SQLITE_OK);
+        const QByteArray path = "dir/file";
+        auto legacy = static_cast<qint64>(c_jhash64((uint8_t *)path.data(), path.size(), 0));
+        auto sql = "INSERT INTO metadata (phash, pathlen, path, inode, type, md5) VALUES ("
+            + QByteArray::number(legacy) + ", 8, '" + path + "', 1234, 0, 'etag');";
+        QCOMPARE(sqlite3_exec(raw, sql.constData(), nullptr, nullptr, nullptr), SQLITE_OK);
+        sqlite3_close(raw);
+
+        {
+            SyncJournalDb db(dbPath);
+            SyncJournalFileRecord record;
+            QVERIFY(db.getFileRecord(path, &record));
+            QVERIFY(record.isValid());
+            QCOMPARE(record._inode, quint64(1234));
+            QVERIFY(db.getFileRecordByInode(1234, &record));
+            QCOMPARE(record._path, path);
+            db.close();
+        }
+
+        const QString freshPath = _tempDir.path() + "/fresh.db";
+        {
+            SyncJournalDb db(freshPath);
+            SyncJournalFileRecord record;
+            QVERIFY(db.getFileRecord(path, &record));
+            db.close();
+        }
+
+        // The upgraded journal has the same columns and indexes as a new one
+        auto describe = [](const QString &file) {
+            sqlite3 *db = nullptr;
+            QByteArrayList result;
+            if (sqlite3_open(file.toUtf8().constData(), &db) != SQLITE_OK)
+                return result;
+            const char *queries[] = {
+                "PRAGMA table_info('metadata');",
+                "SELECT name, sql FROM sqlite_master WHERE type='index' AND tbl_name='metadata' ORDER BY name;",
+            };
+            for (auto sql : queries) {
+                sqlite3_stmt *stmt = nullptr;
+                if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                    continue;
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    QByteArray row;
+                    for (int i = 0; i < sqlite3_column_count(stmt); ++i)
+                        row += QByteArray(reinterpret_cast<const char *>(sqlite3_column_text(stmt, i))) + '|';
+                    result.append(row);
+                }
+                sqlite3_finalize(stmt);
+            }
+            sqlite3_close(db);
+            return result;
+        };
+        const auto upgraded = describe(dbPath);
+        QVERIFY(upgraded.size() > 3);
+        QCOMPARE(upgraded, describe(freshPath));
+
+        QCOMPARE(sqlite3_open(dbPath.toUtf8().constData(), &raw), SQLITE_OK);
+        sqlite3_stmt *stmt = nullptr;
+        QCOMPARE(sqlite3_prepare_v2(raw, "SELECT sql FROM sqlite_master WHERE name='metadata';", -1, &stmt, nullptr), SQLITE_OK);
+        QCOMPARE(sqlite3_step(stmt), SQLITE_ROW);
+        auto schema = QByteArray(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+        sqlite3_finalize(stmt);
+        sqlite3_close(raw);
+        if (sqlite3_libversion_number() >= 3008002)
+            QVERIFY(schema.toUpper().contains("WITHOUT ROWID"));
+    }
+
+    void testPHashDowngrade()
+    {
+        const QString dbPath = _tempDir.path() + "/downgrade.db";
+        {
+            SyncJournalDb db(dbPath);
+            SyncJournalFileRecord record;
+            record._path = "foo";
+            record._etag = "new";
+            QVERIFY(db.setFileRecord(record));
+            record._path = "other";
+            QVERIFY(db.setFileRecord(record));
+            db.close();
+        }
+
+        // An older client opens the journal: it records its own version, does
+        // not find "foo" under the new hash and inserts it again.
+        sqlite3 *raw = nullptr;
+        QCOMPARE(sqlite3_open(dbPath.toUtf8().constData(), &raw), SQLITE_OK);
+        QCOMPARE(sqlite3_exec(raw, "UPDATE version SET major=2, minor=5, patch=0, custom='';", nullptr, nullptr, nullptr), SQLITE_OK);
+        for (const QByteArray path : { "foo", "bar" }) {
+            auto legacy = static_cast<qint64>(c_jhash64((uint8_t *)path.data(), path.size(), 0));
+            auto sql = QByteArray("INSERT INTO metadata (phash, pathlen, path, md5) VALUES (")
+                + QByteArray::number(legacy) + ", " + QByteArray::number(path.size()) + ", '" + path + "', 'old');";
+            QCOMPARE(sqlite3_exec(raw, sql.constData(), nullptr, nullptr, nullptr), SQLITE_OK);
+        }
+        sqlite3_close(raw);
+
+        {
+            SyncJournalDb db(dbPath);
+            SyncJournalFileRecord record;
+            QVERIFY(db.getFileRecord(QByteArrayLiteral("foo"), &record));
+            QVERIFY(record.isValid());
+            QCOMPARE(record._etag, QByteArray("old"));
+            QVERIFY(db.getFileRecord(QByteArrayLiteral("bar"), &record));
+            QVERIFY(record.isValid());
+            QVERIFY(db.getFileRecord(QByteArrayLiteral("other"), &record));
+            QVERIFY(record.isValid());
+            QCOMPARE(record._etag, QByteArray("new"));
+            db.close();
+        }
+
+        QCOMPARE(sqlite3_open(dbPath.toUtf8().constData(), &raw), SQLITE_OK);
+        sqlite3_stmt *stmt = nullptr;
+        QCOMPARE(sqlite3_prepare_v2(raw, "SELECT COUNT(*) FROM metadata WHERE path='foo';", -1, &stmt, nullptr), SQLITE_OK);
+        QCOMPARE(sqlite3_step(stmt), SQLITE_ROW);
+        QCOMPARE(sqlite3_column_int(stmt, 0), 1);
+        sqlite3_finalize(stmt);
+        sqlite3_close(raw);
+    }
+
 private:
     SyncJournalDb _db;
 };
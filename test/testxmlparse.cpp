@@ -613,6 +613,86 @@ private slots:
         QVERIFY(_subdirs.size() == 1);
     }
 
+    void testTypedEntries() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/oc/remote.php/webdav/sharefolder/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004213ocobzus5kn6s</oc:id>"
+              "<oc:permissions>RDNVCK</oc:permissions>"
+              "<oc:size>121780</oc:size>"
+              "<oc:data-fingerprint></oc:data-fingerprint>"
+              "<d:getetag>\"5527beb0400b0\"</d:getetag>"
+              "<d:resourcetype>"
+              "<d:collection/>"
+              "</d:resourcetype>"
+              "<d:getlastmodified>Fri, 06 Feb 2015 13:49:55 GMT</d:getlastmodified>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/oc/remote.php/webdav/sharefolder/quitte.pdf</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004215ocobzus5kn6s</oc:id>"
+              "<oc:permissions>RDNVW</oc:permissions>"
+              "<d:getetag>\"2fa2f0d9ed49ea0c3e409d49e652dea0\"</d:getetag>"
+              "<d:resourcetype/>"
+              "<d:getlastmodified>Fri, 06 Feb 2015 13:49:55 GMT</d:getlastmodified>"
+              "<d:getcontentlength>121780</d:getcontentlength>"
+              "<oc:checksums><oc:checksum>SHA1:abc MD5:def</oc:checksum></oc:checksums>"
+              "<oc:share-types><oc:share-type>0</oc:share-type></oc:share-types>"
+              "<oc:favorite>1</oc:favorite>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:downloadURL/>"
+              "<oc:dDC/>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 404 Not Found</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "</d:multistatus>";
+
+        LsColXMLParser parser;
+        QMap<QString, LsColEntry> entries;
+        connect(&parser, &LsColXMLParser::directoryListingEntry, this,
+            [&](const QString &name, const LsColEntry &entry) { entries.insert(name, entry); });
+
+        QHash <QString, ExtraFolderInfo> sizes;
+        QVERIFY(parser.parse( testXml, &sizes, "/oc/remote.php/webdav/sharefolder" ));
+        QCOMPARE(entries.size(), 2);
+
+        const auto dir = entries.value("/oc/remote.php/webdav/sharefolder");
+        QVERIFY(dir.hasResourceType);
+        QVERIFY(dir.isCollection);
+        QCOMPARE(dir.size, qint64(121780));
+        QCOMPARE(dir.fileId, QByteArray("00004213ocobzus5kn6s"));
+        QCOMPARE(dir.remotePerm, RemotePermissions("RDNVCK"));
+        QVERIFY(dir.hasDataFingerprint);
+        QVERIFY(dir.dataFingerprint.isEmpty());
+        QVERIFY(!dir.isShared);
+
+        const auto file = entries.value("/oc/remote.php/webdav/sharefolder/quitte.pdf");
+        QVERIFY(file.hasResourceType);
+        QVERIFY(!file.isCollection);
+        QVERIFY(file.hasContentLength);
+        QCOMPARE(file.contentLength, qint64(121780));
+        QVERIFY(file.hasEtag);
+        QCOMPARE(file.etag, QByteArray("\"2fa2f0d9ed49ea0c3e409d49e652dea0\""));
+        QCOMPARE(file.modtime, time_t(1423230595));
+        QCOMPARE(file.checksums, QByteArray("SHA1:abc MD5:def"));
+        QVERIFY(file.isShared);
+        QVERIFY(file.downloadUrl.isEmpty()); // 404 propstat
+        QCOMPARE(file.otherProperties.value("favorite"), QString("1"));
+        QVERIFY(!file.hasDataFingerprint);
+    }
+
 };
 
     QTEST_GUILESS_MAIN(TestXmlParse)